@@ -0,0 +1,104 @@
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#include "costAttribution.hpp"
+
+using namespace std;
+
+// Replacement of the global allocation functions which reports every allocation to the object cost attribution.
+// Only linked into 3D_object_tracking, the tools and benchmarks keep the allocator of the C++ runtime.
+
+// malloc with the standard new_handler loop: retry as long as a handler frees memory, bad_alloc without a handler
+static void *allocate(size_t size)
+{
+    size = size > 0 ? size : 1;
+    while (true)
+    {
+        void *p = malloc(size);
+        if (p != nullptr)
+        {
+            countAllocation(size);
+            return p;
+        }
+        new_handler handler = get_new_handler();
+        if (handler == nullptr)
+        {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void *allocateNoThrow(size_t size) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (const bad_alloc &)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void *operator new(size_t size, const nothrow_t &) noexcept { return allocateNoThrow(size); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return allocateNoThrow(size); }
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const nothrow_t &) noexcept { free(p); }
+
+#ifdef __cpp_aligned_new
+// over-aligned types (C++17), from the same heap so that every pointer is released by free
+static void *allocateAligned(size_t size, align_val_t alignment)
+{
+    size_t align = max((size_t)alignment, sizeof(void *));
+    size = size > 0 ? size : 1;
+    while (true)
+    {
+        void *p = nullptr;
+        if (posix_memalign(&p, align, size) == 0)
+        {
+            countAllocation(size);
+            return p;
+        }
+        new_handler handler = get_new_handler();
+        if (handler == nullptr)
+        {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void *allocateAlignedNoThrow(size_t size, align_val_t alignment) noexcept
+{
+    try
+    {
+        return allocateAligned(size, alignment);
+    }
+    catch (const bad_alloc &)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new(size_t size, align_val_t alignment) { return allocateAligned(size, alignment); }
+void *operator new[](size_t size, align_val_t alignment) { return allocateAligned(size, alignment); }
+void *operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept { return allocateAlignedNoThrow(size, alignment); }
+void *operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept { return allocateAlignedNoThrow(size, alignment); }
+
+void operator delete(void *p, align_val_t) noexcept { free(p); }
+void operator delete[](void *p, align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept { free(p); }
+void operator delete(void *p, align_val_t, const nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, align_val_t, const nothrow_t &) noexcept { free(p); }
+#endif
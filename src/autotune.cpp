@@ -0,0 +1,378 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "matching2D.hpp"
+#include "objectDetection2D.hpp"
+#include "lidarData.hpp"
+#include "camFusion.hpp"
+#include "pipeline.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+struct TuneResult { // evaluation of one configuration on the reference sequence
+    PipelineConfig config;
+    string label;
+    double latencyMs = 0.0;  // mean processing time per frame
+    double ttcError = 0.0;   // mean absolute TTC error [s] of Lidar and camera against the reference
+    int nValid = 0;          // no. of frames with a finite camera TTC for the object in front
+};
+
+struct StageCache { // intermediate results shared by all configurations with the same upstream settings
+    map<int, vector<vector<BoundingBox>>> detections;          // per YOLO input size
+    map<int, double> detectionTime;                            // mean time per frame [s]
+    map<string, vector<vector<cv::KeyPoint>>> keypoints;       // per detector and keypoint budget
+    map<string, double> keypointTime;
+    map<string, vector<vector<cv::KeyPoint>>> descKeypoints;   // per detector, budget and descriptor (extractors may drop keypoints)
+    map<string, vector<cv::Mat>> descriptors;
+    map<string, double> descriptorTime;
+};
+
+static const double MAX_TTC_ERROR = 10.0; // error assigned to missing or invalid estimates [s]
+static const float REFERENCE_MAX_Y = 1.5;  // crop of the Lidar reference, inside the crop of every sampled configuration
+static const float REFERENCE_MIN_Z = -1.3;
+
+static string keypointKey(const PipelineConfig &config)
+{
+    return config.detectorType + "/" + (config.bLimitKpts ? to_string(config.maxKeypoints) : "all");
+}
+
+static double elapsedSince(double t)
+{
+    return ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+}
+
+// run the per-frame stages whose results are cached, unless they are cached already
+static void fillCache(const PipelineConfig &config, const vector<DataFrame> &recorded, StageCache &cache)
+{
+    size_t nFrames = recorded.size();
+    if (cache.detections.count(config.yoloInputSize) == 0)
+    {
+        auto &detections = cache.detections[config.yoloInputSize];
+        double t = (double)cv::getTickCount();
+        for (auto &rec : recorded)
+        {
+            cv::Mat img = rec.cameraImg;
+            detections.emplace_back();
+            detectObjects(img, detections.back(), config.confThreshold, config.nmsThreshold, config.yoloBasePath, config.yoloClassesFile,
+                          config.yoloModelConfiguration, config.yoloModelWeights, false, config.yoloInputSize, config.yoloClassMapFile);
+        }
+        cache.detectionTime[config.yoloInputSize] = elapsedSince(t) / nFrames;
+    }
+
+    string kptKey = keypointKey(config);
+    if (cache.keypoints.count(kptKey) == 0)
+    {
+        auto &keypoints = cache.keypoints[kptKey];
+        double t = (double)cv::getTickCount();
+        for (auto &rec : recorded)
+        {
+            cv::Mat img = rec.cameraImg;
+            keypoints.emplace_back();
+            detectFrameKeypoints(config, img, keypoints.back());
+        }
+        cache.keypointTime[kptKey] = elapsedSince(t) / nFrames;
+    }
+
+    string descKey = kptKey + "/" + config.descriptorType;
+    if (cache.descriptors.count(descKey) == 0)
+    {
+        vector<vector<cv::KeyPoint>> keypoints = cache.keypoints[kptKey];
+        vector<cv::Mat> descriptors(nFrames);
+        double t = (double)cv::getTickCount();
+        for (size_t i = 0; i < nFrames; ++i)
+        {
+            cv::Mat img = recorded[i].cameraImg;
+            double descTime;
+            descKeypoints(keypoints[i], img, descriptors[i], descTime, config.descriptorType);
+        }
+        cache.descriptorTime[descKey] = elapsedSince(t) / nFrames;
+        cache.descKeypoints[descKey] = keypoints;
+        cache.descriptors[descKey] = descriptors;
+    }
+}
+
+// Run the configuration over the whole sequence and collect Lidar and camera TTC of the object in front (the box with the
+// most Lidar points in the ego lane) for every frame. Cached stages are charged with their measured time.
+static void evaluateConfig(const PipelineConfig &config, const vector<DataFrame> &recorded, StageCache &cache,
+                           vector<double> &ttcLidar, vector<double> &ttcCamera, double &latencyMs)
+{
+    fillCache(config, recorded, cache);
+    string kptKey = keypointKey(config), descKey = kptKey + "/" + config.descriptorType;
+    size_t nFrames = recorded.size();
+    ttcLidar.assign(nFrames, NAN);
+    ttcCamera.assign(nFrames, NAN);
+
+    PipelineState state;
+    DataFrame prevFrame;
+    double t = (double)cv::getTickCount();
+    for (size_t i = 0; i < nFrames; ++i)
+    {
+        DataFrame frame;
+        frame.cameraImg = recorded[i].cameraImg;
+        frame.lidarPoints = recorded[i].lidarPoints;
+        frame.boundingBoxes = cache.detections[config.yoloInputSize][i];
+        frame.keypoints = cache.descKeypoints[descKey][i];
+        frame.descriptors = cache.descriptors[descKey][i];
+
+        cropLidarPoints(frame.lidarPoints, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ, config.minR);
+        cv::Mat P_rect_00 = config.P_rect_00, R_rect_00 = config.R_rect_00, RT = config.RT;
+        clusterLidarWithROI(frame.boundingBoxes, frame.lidarPoints, config.shrinkFactor, P_rect_00, R_rect_00, RT, keepLidarPoints(config));
+
+        if (i > 0)
+        {
+            vector<TTCResult> results;
+            processFramePair(config, prevFrame, frame, state, i, results);
+
+            auto front = max_element(frame.boundingBoxes.begin(), frame.boundingBoxes.end(),
+                                     [](const BoundingBox &a, const BoundingBox &b) { return a.lidarSummary.count < b.lidarSummary.count; });
+            for (auto &result : results)
+            {
+                if (front != frame.boundingBoxes.end() && result.trackID == front->trackID)
+                {
+                    ttcLidar[i] = result.ttcLidar;
+                    ttcCamera[i] = result.ttcCamera;
+                }
+            }
+        }
+        prevFrame = std::move(frame);
+    }
+
+    double perFrame = elapsedSince(t) / nFrames + cache.detectionTime[config.yoloInputSize] + cache.keypointTime[kptKey] + cache.descriptorTime[descKey];
+    latencyMs = 1000.0 * perFrame;
+}
+
+static double ttcError(double ttc, double reference)
+{
+    return std::isfinite(ttc) ? min(fabs(ttc - reference), MAX_TTC_ERROR) : MAX_TTC_ERROR;
+}
+
+// reference TTC per frame from a CSV file with "frameIndex,ttc" lines
+static bool loadReference(const string &filename, size_t nFrames, vector<double> &reference)
+{
+    ifstream file(filename);
+    if (!file)
+    {
+        return false;
+    }
+    reference.assign(nFrames, NAN);
+    string line;
+    while (getline(file, line))
+    {
+        stringstream ss(line);
+        size_t frameIdx;
+        char sep;
+        double ttc;
+        if (ss >> frameIdx >> sep >> ttc && frameIdx < nFrames)
+        {
+            reference[frameIdx] = ttc;
+        }
+    }
+    return true;
+}
+
+// Lidar TTC of the vehicle ahead from the exact median distance of all ego-lane points within a fixed crop. Boxes, keypoints
+// and ICP are not involved, so no sampled parameter and not the default configuration biases the reference.
+static void lidarReference(const PipelineConfig &base, const vector<DataFrame> &recorded, vector<double> &reference)
+{
+    reference.assign(recorded.size(), NAN);
+    vector<LidarPoint> prevPoints;
+    for (size_t i = 0; i < recorded.size(); ++i)
+    {
+        vector<LidarPoint> points = recorded[i].lidarPoints;
+        cropLidarPoints(points, base.minX, base.maxX, REFERENCE_MAX_Y, REFERENCE_MIN_Z, base.maxZ, base.minR);
+        if (!prevPoints.empty() && !points.empty())
+        {
+            computeTTCLidar(prevPoints, points, base.sensorFrameRate, reference[i]);
+        }
+        prevPoints = std::move(points);
+    }
+}
+
+static string describeConfig(const PipelineConfig &config)
+{
+    ostringstream label;
+    label << config.detectorType << "," << config.descriptorType << "," << config.matcherType << "," << config.selectorType << ","
+          << (config.bLimitKpts ? config.maxKeypoints : 0) << "," << config.minDistRatio << "," << config.shrinkFactor << ","
+          << config.minZ << "," << config.maxY << "," << config.yoloInputSize;
+    return label.str();
+}
+
+// draw a random configuration from the search space
+static PipelineConfig sampleConfig(const PipelineConfig &base, mt19937 &rng)
+{
+    static const vector<string> detectors{"SHITOMASI", "HARRIS", "FAST", "BRISK", "ORB", "AKAZE", "SIFT"};
+    static const vector<string> descriptors{"BRISK", "BRIEF", "ORB", "FREAK", "AKAZE", "SIFT"};
+    static const vector<string> binaryMatchers{"MAT_BF", "MAT_FLANN"};
+    static const vector<string> floatMatchers{"MAT_BF", "MAT_FLANN", "MAT_GEMM"}; // the GEMM matcher only handles float (SIFT) descriptors
+    static const vector<string> selectors{"SEL_NN", "SEL_KNN"};
+    static const vector<int> budgets{0, 1000, 300};
+    static const vector<double> distRatios{0.7, 0.8, 0.9};
+    static const vector<float> shrinkFactors{0.05, 0.10, 0.15};
+    static const vector<float> minZs{-1.5, -1.3};     // REFERENCE_MIN_Z and REFERENCE_MAX_Y must stay inside all crops
+    static const vector<float> maxYs{1.5, 2.0};
+    static const vector<int> yoloSizes{320, 416, 608};
+
+    auto pick = [&rng](size_t n) { return uniform_int_distribution<size_t>(0, n - 1)(rng); };
+
+    PipelineConfig config = base;
+    while (true)
+    {
+        config.detectorType = detectors[pick(detectors.size())];
+        config.descriptorType = descriptors[pick(descriptors.size())];
+        // AKAZE descriptors need AKAZE keypoints, ORB descriptors fail on SIFT keypoints
+        bool bValid = (config.descriptorType != "AKAZE" || config.detectorType == "AKAZE") &&
+                      (config.descriptorType != "ORB" || config.detectorType != "SIFT");
+        if (bValid)
+        {
+            break;
+        }
+    }
+    const vector<string> &matchers = config.descriptorType == "SIFT" ? floatMatchers : binaryMatchers;
+    config.matcherType = matchers[pick(matchers.size())];
+    config.selectorType = selectors[pick(selectors.size())];
+    int budget = budgets[pick(budgets.size())];
+    config.bLimitKpts = budget > 0;
+    config.maxKeypoints = budget;
+    config.minDistRatio = distRatios[pick(distRatios.size())];
+    config.shrinkFactor = shrinkFactors[pick(shrinkFactors.size())];
+    config.minZ = minZs[pick(minZs.size())];
+    config.maxY = maxYs[pick(maxYs.size())];
+    config.yoloInputSize = yoloSizes[pick(yoloSizes.size())];
+    return config;
+}
+
+/* AUTOTUNER: searches detector, matcher and TTC parameters for the best latency / TTC error trade-off */
+// usage: autotune [no. of sampled configurations] [reference TTC csv]
+int main(int argc, const char *argv[])
+{
+    string dataPath = "../";
+    PipelineConfig base = createDefaultConfig(dataPath);
+    base.bLidarICP = false;                  // median Lidar TTC, so the crop and shrink parameters are what is tuned
+    base.bReuseStatic = false;
+    base.fusionPolicy.validationPeriod = 1;  // camera TTC for every object and frame
+    setLogLevel(LOG_LEVEL_ERROR);
+
+    int nSamples = argc > 1 ? stoi(argv[1]) : 150;
+    vector<double> latencyBudgets{50, 100, 200, 500}; // [ms]
+
+    // preload the reference sequence
+    vector<DataFrame> recorded(base.frameFiles.size());
+    for (size_t i = 0; i < recorded.size(); ++i)
+    {
+        loadFrame(base, i, recorded[i]);
+    }
+
+    StageCache cache;
+    vector<double> reference;
+    if (argc > 2 && loadReference(argv[2], recorded.size(), reference))
+    {
+        cout << "Reference TTC from " << argv[2] << endl;
+    }
+    else
+    { // without ground truth, the exact median Lidar TTC of the ego lane is the reference
+        if (argc > 2)
+        {
+            cerr << "Cannot read reference TTC " << argv[2] << endl;
+            return 1;
+        }
+        lidarReference(base, recorded, reference);
+        cout << "Reference TTC from the median distance of the ego-lane Lidar points" << endl;
+    }
+
+    // evaluate the default configuration and random samples of the search space
+    mt19937 rng(42);
+    vector<TuneResult> results;
+    map<string, bool> evaluated;
+    for (int n = 0; n <= nSamples; ++n)
+    {
+        TuneResult result;
+        result.config = n == 0 ? base : sampleConfig(base, rng);
+        result.label = describeConfig(result.config);
+        if (evaluated[result.label])
+        {
+            continue;
+        }
+        evaluated[result.label] = true;
+
+        vector<double> ttcLidar, ttcCamera;
+        try
+        {
+            evaluateConfig(result.config, recorded, cache, ttcLidar, ttcCamera, result.latencyMs);
+        }
+        catch (const cv::Exception &e)
+        {
+            LOG_WARN("Skipping " << result.label << " : " << e.what());
+            continue;
+        }
+
+        int nFrames = 0;
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            if (std::isfinite(reference[i]))
+            {
+                result.ttcError += 0.5 * (ttcError(ttcLidar[i], reference[i]) + ttcError(ttcCamera[i], reference[i]));
+                result.nValid += std::isfinite(ttcCamera[i]);
+                ++nFrames;
+            }
+        }
+        result.ttcError = nFrames > 0 ? result.ttcError / nFrames : MAX_TTC_ERROR;
+        results.push_back(result);
+        cout << "[" << n << "/" << nSamples << "] " << result.label << " : " << result.latencyMs << " ms, error " << result.ttcError << " s" << endl;
+    }
+
+    // Pareto frontier: no other configuration is both faster and more accurate
+    sort(results.begin(), results.end(), [](const TuneResult &a, const TuneResult &b) { return a.latencyMs < b.latencyMs; });
+    vector<const TuneResult *> frontier;
+    for (auto &result : results)
+    {
+        if (frontier.empty() || result.ttcError < frontier.back()->ttcError)
+        {
+            frontier.push_back(&result);
+        }
+    }
+
+    ofstream csv("../autotune.csv");
+    csv << "detectorType,descriptorType,matcherType,selectorType,maxKeypoints,minDistRatio,shrinkFactor,minZ,maxY,yoloInputSize,latency_ms,TTC_error,validCameraTTC,pareto" << endl;
+    for (auto &result : results)
+    {
+        bool bPareto = find(frontier.begin(), frontier.end(), &result) != frontier.end();
+        csv << result.label << "," << result.latencyMs << "," << result.ttcError << "," << result.nValid << "," << bPareto << endl;
+    }
+
+    cout << endl << "Pareto frontier (latency [ms] / TTC error [s]) :" << endl;
+    for (auto result : frontier)
+    {
+        cout << fixed << setprecision(1) << setw(8) << result->latencyMs << setprecision(3) << setw(8) << result->ttcError << "  " << result->label << endl;
+    }
+
+    // the frontier is sorted by latency with decreasing error, so the last entry within the budget is the most accurate
+    cout << endl << "Recommended configuration per latency budget :" << endl;
+    for (double budget : latencyBudgets)
+    {
+        const TuneResult *best = nullptr;
+        for (auto result : frontier)
+        {
+            if (result->latencyMs <= budget)
+            {
+                best = result;
+            }
+        }
+        cout << setprecision(0) << setw(6) << budget << " ms : " << (best != nullptr ? best->label : string("none within budget")) << endl;
+    }
+
+    flushLog();
+    return 0;
+}
@@ -0,0 +1,213 @@
+
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "boxMatching.hpp"
+#include "matching2D.hpp"
+
+using namespace std;
+
+// intersection over union of two image regions
+double computeIoU(const cv::Rect &roi1, const cv::Rect &roi2)
+{
+    double intersection = (roi1 & roi2).area();
+    double unionArea = roi1.area() + roi2.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+// predict where a bounding box of the previous frame will appear in the current frame (constant image-space velocity and scale rate)
+cv::Rect predictBoundingBox(const BoundingBox &boundingBox)
+{
+    float width = boundingBox.roi.width * boundingBox.scaleRate;
+    float height = boundingBox.roi.height * boundingBox.scaleRate;
+    float cx = boundingBox.roi.x + boundingBox.roi.width / 2.0f + boundingBox.velocity.x;
+    float cy = boundingBox.roi.y + boundingBox.roi.height / 2.0f + boundingBox.velocity.y;
+    return cv::Rect(cvRound(cx - width / 2.0f), cvRound(cy - height / 2.0f), cvRound(width), cvRound(height));
+}
+
+// cheap one-to-one association of bounding boxes based on the overlap between predicted previous and current boxes
+void associateBoxesIoU(std::vector<BoundingBox> &prevBoxes, std::vector<BoundingBox> &currBoxes, std::map<int, int> &bbAssociations, double minIoU)
+{
+    // collect all candidate pairs which overlap sufficiently
+    struct Candidate { double iou; int prevIdx, currIdx; };
+    vector<Candidate> candidates;
+    for (int i = 0; i < (int)prevBoxes.size(); ++i)
+    {
+        cv::Rect predicted = predictBoundingBox(prevBoxes[i]);
+        for (int j = 0; j < (int)currBoxes.size(); ++j)
+        {
+            if (prevBoxes[i].classID != currBoxes[j].classID)
+            {
+                continue;
+            }
+            double iou = computeIoU(predicted, currBoxes[j].roi);
+            if (iou >= minIoU)
+            {
+                candidates.push_back({iou, i, j});
+            }
+        }
+    }
+
+    // greedily assign pairs in order of decreasing overlap
+    sort(candidates.begin(), candidates.end(), [](const Candidate &c1, const Candidate &c2) { return c1.iou > c2.iou; });
+    vector<bool> prevUsed(prevBoxes.size(), false), currUsed(currBoxes.size(), false);
+    for (auto &candidate : candidates)
+    {
+        if (prevUsed[candidate.prevIdx] || currUsed[candidate.currIdx])
+        {
+            continue;
+        }
+        prevUsed[candidate.prevIdx] = currUsed[candidate.currIdx] = true;
+        bbAssociations[prevBoxes[candidate.prevIdx].boxID] = currBoxes[candidate.currIdx].boxID;
+    }
+}
+
+// propagate track identities along the matched bounding boxes and update the motion model of each track
+void updateTracks(std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame, int &nextTrackID)
+{
+    float alpha = 0.5f; // weight of the newest measurement in the smoothed motion model
+
+    for (auto &bbMatch : bbBestMatches)
+    {
+        auto prevBB = find_if(prevFrame.boundingBoxes.begin(), prevFrame.boundingBoxes.end(), [&](const BoundingBox &bb) { return bb.boxID == bbMatch.first; });
+        auto currBB = find_if(currFrame.boundingBoxes.begin(), currFrame.boundingBoxes.end(), [&](const BoundingBox &bb) { return bb.boxID == bbMatch.second; });
+        if (prevBB == prevFrame.boundingBoxes.end() || currBB == currFrame.boundingBoxes.end())
+        {
+            continue;
+        }
+
+        if (prevBB->trackID < 0)
+        {
+            prevBB->trackID = nextTrackID++;
+        }
+        currBB->trackID = prevBB->trackID;
+
+        cv::Point2f prevCenter(prevBB->roi.x + prevBB->roi.width / 2.0f, prevBB->roi.y + prevBB->roi.height / 2.0f);
+        cv::Point2f currCenter(currBB->roi.x + currBB->roi.width / 2.0f, currBB->roi.y + currBB->roi.height / 2.0f);
+        float scale = prevBB->roi.area() > 0 ? std::sqrt((float)currBB->roi.area() / prevBB->roi.area()) : 1.0f;
+        currBB->velocity = alpha * (currCenter - prevCenter) + (1 - alpha) * prevBB->velocity;
+        currBB->scaleRate = alpha * scale + (1 - alpha) * prevBB->scaleRate;
+    }
+
+    // boxes without a partner start a new track
+    for (auto &bb : currFrame.boundingBoxes)
+    {
+        if (bb.trackID < 0)
+        {
+            bb.trackID = nextTrackID++;
+        }
+    }
+}
+
+// indices of all keypoints enclosed by the given bounding box
+static vector<int> keypointsInBox(const std::vector<cv::KeyPoint> &keypoints, const cv::Rect &roi)
+{
+    vector<int> indices;
+    for (int i = 0; i < (int)keypoints.size(); ++i)
+    {
+        if (roi.contains(keypoints[i].pt))
+        {
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+// gather the descriptor rows of a keypoint subset into a separate matrix
+static cv::Mat selectDescriptors(const cv::Mat &descriptors, const vector<int> &indices)
+{
+    cv::Mat subset;
+    for (int idx : indices)
+    {
+        subset.push_back(descriptors.row(idx));
+    }
+    return subset;
+}
+
+// match a subset of source descriptors against a subset of reference descriptors and map the results back to frame indices
+static void matchSubsets(DataFrame &prevFrame, DataFrame &currFrame, const vector<int> &prevIndices, const vector<int> &currIndices,
+                         std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, double &matchTime, std::string selectorType,
+                         double minDistRatio)
+{
+    if (prevIndices.empty() || currIndices.empty())
+    {
+        return;
+    }
+
+    cv::Mat descPrev = selectDescriptors(prevFrame.descriptors, prevIndices);
+    cv::Mat descCurr = selectDescriptors(currFrame.descriptors, currIndices);
+
+    vector<cv::DMatch> subMatches;
+    double subMatchTime = 0.0;
+    matchDescriptors(prevFrame.keypoints, currFrame.keypoints, descPrev, descCurr, subMatches, descriptorType, matcherType, subMatchTime, selectorType, minDistRatio);
+    matchTime += subMatchTime;
+
+    for (auto &match : subMatches)
+    {
+        match.queryIdx = prevIndices[match.queryIdx];
+        match.trainIdx = currIndices[match.trainIdx];
+        matches.push_back(match);
+    }
+}
+
+// Hierarchical matching: associate bounding boxes first, then match descriptors only between keypoints of associated box pairs.
+// Boxes without an association fall back to matching their keypoints against the whole other frame.
+void matchDescriptorsByBox(DataFrame &prevFrame, DataFrame &currFrame, std::vector<cv::DMatch> &matches, std::string descriptorType,
+                           std::string matcherType, double &matchTime, std::string selectorType, double minIoU, double minDistRatio)
+{
+    map<int, int> bbAssociations;
+    associateBoxesIoU(prevFrame.boundingBoxes, currFrame.boundingBoxes, bbAssociations, minIoU);
+
+    matchTime = 0.0;
+    vector<cv::DMatch> boxMatches;
+    vector<bool> prevAssociated(prevFrame.boundingBoxes.size(), false), currAssociated(currFrame.boundingBoxes.size(), false);
+    for (auto &bbAssociation : bbAssociations)
+    {
+        // boxIDs are the zero-based position of each box within its frame
+        prevAssociated[bbAssociation.first] = currAssociated[bbAssociation.second] = true;
+        vector<int> prevIndices = keypointsInBox(prevFrame.keypoints, prevFrame.boundingBoxes[bbAssociation.first].roi);
+        vector<int> currIndices = keypointsInBox(currFrame.keypoints, currFrame.boundingBoxes[bbAssociation.second].roi);
+        matchSubsets(prevFrame, currFrame, prevIndices, currIndices, boxMatches, descriptorType, matcherType, matchTime, selectorType, minDistRatio);
+    }
+
+    // unassociated boxes are matched against the full frame
+    vector<int> allPrev(prevFrame.keypoints.size()), allCurr(currFrame.keypoints.size());
+    iota(allPrev.begin(), allPrev.end(), 0);
+    iota(allCurr.begin(), allCurr.end(), 0);
+    for (size_t i = 0; i < prevAssociated.size(); ++i)
+    {
+        if (!prevAssociated[i])
+        {
+            vector<int> prevIndices = keypointsInBox(prevFrame.keypoints, prevFrame.boundingBoxes[i].roi);
+            matchSubsets(prevFrame, currFrame, prevIndices, allCurr, boxMatches, descriptorType, matcherType, matchTime, selectorType, minDistRatio);
+        }
+    }
+    for (size_t i = 0; i < currAssociated.size(); ++i)
+    {
+        if (!currAssociated[i])
+        {
+            vector<int> currIndices = keypointsInBox(currFrame.keypoints, currFrame.boundingBoxes[i].roi);
+            matchSubsets(prevFrame, currFrame, allPrev, currIndices, boxMatches, descriptorType, matcherType, matchTime, selectorType, minDistRatio);
+        }
+    }
+
+    // overlapping boxes may match the same source keypoint several times, keep the best match only
+    vector<int> bestMatch(prevFrame.keypoints.size(), -1);
+    for (int i = 0; i < (int)boxMatches.size(); ++i)
+    {
+        int &best = bestMatch[boxMatches[i].queryIdx];
+        if (best < 0 || boxMatches[i].distance < boxMatches[best].distance)
+        {
+            best = i;
+        }
+    }
+    for (int best : bestMatch)
+    {
+        if (best >= 0)
+        {
+            matches.push_back(boxMatches[best]);
+        }
+    }
+}
@@ -0,0 +1,20 @@
+
+#ifndef boxMatching_hpp
+#define boxMatching_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <opencv2/core.hpp>
+#include "dataStructures.h"
+
+double computeIoU(const cv::Rect &roi1, const cv::Rect &roi2);
+cv::Rect predictBoundingBox(const BoundingBox &boundingBox);
+void associateBoxesIoU(std::vector<BoundingBox> &prevBoxes, std::vector<BoundingBox> &currBoxes, std::map<int, int> &bbAssociations, double minIoU);
+void updateTracks(std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame, int &nextTrackID);
+
+void matchDescriptorsByBox(DataFrame &prevFrame, DataFrame &currFrame, std::vector<cv::DMatch> &matches, std::string descriptorType,
+                           std::string matcherType, double &matchTime, std::string selectorType, double minIoU=0.3, double minDistRatio=0.8);
+
+#endif /* boxMatching_hpp */
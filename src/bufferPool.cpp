@@ -0,0 +1,373 @@
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <sys/mman.h>
+
+#include "bufferPool.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+static HugePageMode globalMode = HUGE_PAGES_OFF;
+
+static size_t roundToHugePage(size_t size)
+{
+    return (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+// block size for a request: whole huge pages, rounded to one of four classes per doubling so that matrices of similar
+// size share blocks while at most a quarter of a block stays unused
+static size_t sizeClass(size_t size)
+{
+    size_t pages = roundToHugePage(size) / HUGE_PAGE_SIZE;
+    size_t step = 1;
+    while (step * 8 <= pages)
+    {
+        step *= 2;
+    }
+    return (pages + step - 1) / step * step * HUGE_PAGE_SIZE;
+}
+
+std::string hugePageModeName(HugePageMode mode)
+{
+    switch (mode)
+    {
+    case HUGE_PAGES_TRANSPARENT:
+        return "transparent";
+    case HUGE_PAGES_EXPLICIT:
+        return "explicit";
+    default:
+        return "off";
+    }
+}
+
+// Allocate with the requested page mode, falling back from explicit to transparent to regular pages.
+// Sizes are multiples of 2 MB for both huge page modes.
+void *allocateHugePages(size_t size, HugePageMode mode, HugePageMode &obtained)
+{
+    size = roundToHugePage(size);
+
+#ifdef MAP_HUGETLB
+    if (mode == HUGE_PAGES_EXPLICIT)
+    {
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED)
+        {
+            obtained = HUGE_PAGES_EXPLICIT;
+            return data;
+        }
+        static bool bWarned = false;
+        if (!bWarned)
+        {
+            LOG_WARN("No explicit huge pages available (vm.nr_hugepages), falling back to transparent huge pages");
+            bWarned = true;
+        }
+        mode = HUGE_PAGES_TRANSPARENT;
+    }
+#endif
+
+    if (mode == HUGE_PAGES_TRANSPARENT)
+    { // over-allocate and trim, so the block starts on a 2 MB boundary and can be backed by huge pages entirely
+        size_t mapSize = size + HUGE_PAGE_SIZE;
+        char *raw = (char *)mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED)
+        {
+            char *data = (char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+            if (data > raw)
+            {
+                munmap(raw, data - raw);
+            }
+            if (raw + mapSize > data + size)
+            {
+                munmap(data + size, raw + mapSize - (data + size));
+            }
+#ifdef MADV_HUGEPAGE
+            if (madvise(data, size, MADV_HUGEPAGE) == 0)
+            {
+                obtained = HUGE_PAGES_TRANSPARENT;
+                return data;
+            }
+#endif
+            obtained = HUGE_PAGES_OFF;
+            return data;
+        }
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    obtained = HUGE_PAGES_OFF;
+    return data != MAP_FAILED ? data : nullptr;
+}
+
+void freeHugePages(void *data, size_t size)
+{
+    if (data != nullptr)
+    {
+        munmap(data, roundToHugePage(size));
+    }
+}
+
+// Advise transparent huge pages for the 2 MB aligned interior of an existing buffer (e.g. the storage of a point cloud vector)
+// if huge pages are enabled. Only pages which have not been touched yet are affected immediately.
+void adviseHugePages(void *data, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+    if (globalMode == HUGE_PAGES_OFF || data == nullptr)
+    {
+        return;
+    }
+    uintptr_t begin = ((uintptr_t)data + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    uintptr_t end = ((uintptr_t)data + size) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if (end > begin)
+    {
+        madvise((void *)begin, end - begin, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+void setHugePageMode(HugePageMode mode)
+{
+    globalMode = mode;
+}
+
+HugePageMode getHugePageMode()
+{
+    return globalMode;
+}
+
+// back all large matrices created from now on by a huge page pool
+HugePageBufferPool *enableHugePageMats(HugePageMode mode)
+{
+    setHugePageMode(mode);
+    if (mode == HUGE_PAGES_OFF)
+    {
+        cv::Mat::setDefaultAllocator(nullptr);
+        return nullptr;
+    }
+    // one pool per mode, living until the end of the program like the matrices using it
+    static map<HugePageMode, HugePageBufferPool *> pools;
+    static map<HugePageMode, HugePageMatAllocator *> allocators;
+    if (pools.count(mode) == 0)
+    {
+        pools[mode] = new HugePageBufferPool(mode);
+        allocators[mode] = new HugePageMatAllocator(pools[mode]);
+    }
+    cv::Mat::setDefaultAllocator(allocators[mode]);
+    return pools[mode];
+}
+
+// look up the mapping containing the given address in /proc/self/smaps
+bool queryPageReport(const void *addr, PageReport &report)
+{
+    ifstream smaps("/proc/self/smaps");
+    string line;
+    bool bInMapping = false;
+    while (getline(smaps, line))
+    {
+        uintptr_t start, end;
+        char dash;
+        stringstream header(line);
+        if (line.find(':') == string::npos || line.find(':') > line.find(' '))
+        { // mapping header "start-end perms offset dev inode path"
+            header >> hex >> start >> dash >> end;
+            if (bInMapping)
+            {
+                return true;
+            }
+            bInMapping = !header.fail() && (uintptr_t)addr >= start && (uintptr_t)addr < end;
+            continue;
+        }
+        if (!bInMapping)
+        {
+            continue;
+        }
+
+        string key;
+        size_t valueKb;
+        stringstream field(line);
+        field >> key >> valueKb;
+        if (key == "Size:")
+        {
+            report.mappingSize = valueKb << 10;
+        }
+        else if (key == "AnonHugePages:")
+        {
+            report.anonHugeBytes = valueKb << 10;
+        }
+        else if (key == "KernelPageSize:")
+        {
+            report.kernelPageSize = valueKb << 10;
+        }
+    }
+    return bInMapping;
+}
+
+HugePageBufferPool::~HugePageBufferPool()
+{
+    for (auto &block : blocks)
+    {
+        freeHugePages(block.second.data, block.second.size);
+    }
+}
+
+void *HugePageBufferPool::acquire(size_t size)
+{
+    size = sizeClass(size);
+    lock_guard<mutex> lock(mtx);
+    auto &sameSize = freeBlocks[size];
+    if (!sameSize.empty())
+    {
+        void *data = sameSize.back();
+        sameSize.pop_back();
+        idleBytes -= size;
+        return data;
+    }
+
+    PoolBlock block;
+    block.size = size;
+    block.data = allocateHugePages(size, mode, block.mode);
+    if (block.data == nullptr && idleBytes > 0)
+    { // idle blocks of other sizes may hold the memory (e.g. the reserved huge pages), retry without them
+        trimLocked(0);
+        block.data = allocateHugePages(size, mode, block.mode);
+    }
+    if (block.data != nullptr)
+    {
+        blocks[block.data] = block;
+    }
+    return block.data;
+}
+
+void HugePageBufferPool::release(void *data, size_t size)
+{
+    size = sizeClass(size);
+    lock_guard<mutex> lock(mtx);
+    freeBlocks[size].push_back(data);
+    idleBytes += size;
+    if (idleBytes > maxIdleBytes)
+    {
+        trimLocked(maxIdleBytes);
+    }
+}
+
+void HugePageBufferPool::trim(size_t maxIdle)
+{
+    lock_guard<mutex> lock(mtx);
+    trimLocked(maxIdle);
+}
+
+// unmap idle blocks, largest first, until at most maxIdle bytes are kept
+void HugePageBufferPool::trimLocked(size_t maxIdle)
+{
+    for (auto it = freeBlocks.rbegin(); it != freeBlocks.rend() && idleBytes > maxIdle; ++it)
+    {
+        auto &idle = it->second;
+        while (!idle.empty() && idleBytes > maxIdle)
+        {
+            PoolBlock &block = blocks[idle.back()];
+            freeHugePages(block.data, block.size);
+            idleBytes -= block.size;
+            blocks.erase(idle.back());
+            idle.pop_back();
+        }
+    }
+}
+
+// page sizes actually obtained for all blocks of the pool
+void HugePageBufferPool::printReport() const
+{
+    lock_guard<mutex> lock(mtx);
+    size_t total = 0, hugeBytes = 0;
+    map<string, int> modes;
+    for (auto &entry : blocks)
+    {
+        const PoolBlock &block = entry.second;
+        PageReport report;
+        if (queryPageReport(block.data, report))
+        { // explicit huge pages do not show up as AnonHugePages
+            hugeBytes += report.kernelPageSize >= HUGE_PAGE_SIZE ? block.size : min(report.anonHugeBytes, block.size);
+        }
+        total += block.size;
+        ++modes[hugePageModeName(block.mode)];
+    }
+
+    cout << "Buffer pool (" << hugePageModeName(mode) << " requested) : " << blocks.size() << " blocks, " << (total >> 20) << " MB ("
+         << (idleBytes >> 20) << " MB idle), " << (hugeBytes >> 20) << " MB backed by 2 MB pages";
+    for (auto &m : modes)
+    {
+        cout << ", " << m.second << " x " << m.first;
+    }
+    cout << endl;
+}
+
+cv::UMatData *HugePageMatAllocator::allocate(int dims, const int *sizes, int type, void *data0, size_t *step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+    // same layout rules as the standard allocator
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data0 && step[i] != CV_AUTOSTEP)
+            {
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    // allocatorFlags_ marks blocks from the pool, large matrices fall back to the heap if the pool cannot map memory
+    uchar *data = (uchar *)data0;
+    bool bPooled = false;
+    if (data == nullptr && total >= minSize)
+    {
+        data = (uchar *)pool->acquire(total);
+        bPooled = data != nullptr;
+    }
+    if (data == nullptr)
+    {
+        data = (uchar *)cv::fastMalloc(total);
+    }
+    cv::UMatData *u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    u->allocatorFlags_ = bPooled ? 1 : 0;
+    if (data0)
+    {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    return u;
+}
+
+bool HugePageMatAllocator::allocate(cv::UMatData *u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const
+{
+    return u != nullptr;
+}
+
+void HugePageMatAllocator::deallocate(cv::UMatData *u) const
+{
+    if (u == nullptr)
+    {
+        return;
+    }
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        if (u->allocatorFlags_ & 1)
+        {
+            pool->release(u->origdata, u->size);
+        }
+        else
+        {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = nullptr;
+    }
+    delete u;
+}
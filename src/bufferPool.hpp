@@ -0,0 +1,80 @@
+
+#ifndef bufferPool_hpp
+#define bufferPool_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <string>
+#include <opencv2/core.hpp>
+
+enum HugePageMode {
+    HUGE_PAGES_OFF,         // regular 4 KB pages
+    HUGE_PAGES_TRANSPARENT, // 2 MB aligned memory advised for transparent huge pages (MADV_HUGEPAGE)
+    HUGE_PAGES_EXPLICIT     // reserved huge pages (MAP_HUGETLB), see /proc/sys/vm/nr_hugepages
+};
+
+struct PageReport { // page sizes backing a mapping, taken from /proc/self/smaps
+    size_t mappingSize = 0;    // [bytes]
+    size_t anonHugeBytes = 0;  // bytes backed by transparent huge pages
+    size_t kernelPageSize = 0; // page size of the mapping, 2 MB for explicit huge pages [bytes]
+};
+
+struct PoolBlock {
+    void *data;
+    size_t size;
+    HugePageMode mode;         // mode actually obtained, after fallbacks
+};
+
+// Pool of large buffers for images, descriptors and point clouds. Blocks are rounded up to a size class (multiples of 2 MB,
+// four classes per doubling), allocated with the requested huge page mode (falling back to transparent and then to regular
+// pages) and kept for reuse when released, as long as the idle blocks stay below maxIdleBytes.
+class HugePageBufferPool
+{
+public:
+    explicit HugePageBufferPool(HugePageMode mode=HUGE_PAGES_TRANSPARENT, size_t maxIdleBytes=size_t(256) << 20) : mode(mode), maxIdleBytes(maxIdleBytes) {}
+    ~HugePageBufferPool();
+
+    void *acquire(size_t size);      // nullptr if no memory could be mapped
+    void release(void *data, size_t size);
+    void trim(size_t maxIdle=0);     // unmap idle blocks until at most maxIdle bytes are kept
+    HugePageMode requestedMode() const { return mode; }
+    void printReport() const;
+
+private:
+    void trimLocked(size_t maxIdle);
+
+    HugePageMode mode;
+    size_t maxIdleBytes;
+    size_t idleBytes = 0;
+    mutable std::mutex mtx;
+    std::map<void *, PoolBlock> blocks;               // all mapped blocks, in use or idle
+    std::map<size_t, std::vector<void *>> freeBlocks; // idle blocks per size class
+};
+
+// cv::Mat allocator serving large matrices from a huge page pool and small ones, or large ones the pool cannot map, from the standard heap
+class HugePageMatAllocator : public cv::MatAllocator
+{
+public:
+    HugePageMatAllocator(HugePageBufferPool *pool, size_t minSize=1 << 20) : pool(pool), minSize(minSize) {}
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+private:
+    HugePageBufferPool *pool;
+    size_t minSize;            // smaller matrices are not worth a 2 MB block
+};
+
+void *allocateHugePages(size_t size, HugePageMode mode, HugePageMode &obtained);
+void freeHugePages(void *data, size_t size);
+void adviseHugePages(void *data, size_t size);
+void setHugePageMode(HugePageMode mode);
+HugePageMode getHugePageMode();
+HugePageBufferPool *enableHugePageMats(HugePageMode mode);
+bool queryPageReport(const void *addr, PageReport &report);
+std::string hugePageModeName(HugePageMode mode);
+
+#endif /* bufferPool_hpp */
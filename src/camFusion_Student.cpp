@@ -7,56 +7,65 @@
 
 #include "camFusion.hpp"
 #include "dataStructures.h"
+#include "boxMatching.hpp"
+#include "fusionKernels.hpp"
 
 using namespace std;
 
-// Create groups of Lidar points whose projection into the camera falls into the same bounding box
-void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT)
+// Create groups of Lidar points whose projection into the camera falls into the same bounding box. The per-box summaries
+// are accumulated in the same pass; point copies are only made if requested.
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT,
+                         bool bKeepPoints)
 {
-    // loop over all Lidar points and associate them to a 2D bounding box
-    cv::Mat X(4, 1, cv::DataType<double>::type);
-    cv::Mat Y(3, 1, cv::DataType<double>::type);
+    // project all Lidar points with the combined projection matrix
+    cv::Matx<FusionScalar, 3, 4> projection = combineProjection<FusionScalar>(P_rect_xx, R_rect_xx, RT);
+    vector<cv::Point_<FusionScalar>> imgPoints;
+    projectLidarPoints(lidarPoints, projection, imgPoints);
+
+    // assign each point to the bounding box enclosing it, points enclosed by several boxes are dropped
+    vector<cv::Rect> rois;
+    rois.reserve(boundingBoxes.size());
+    for (auto &box : boundingBoxes)
+    {
+        rois.push_back(box.roi);
+    }
+    vector<int> boxIndices;
+    assignPointsToBoxes(imgPoints, rois, (FusionScalar)shrinkFactor, boxIndices);
 
-    for (auto it1 = lidarPoints.begin(); it1 != lidarPoints.end(); ++it1)
+    vector<cv::Point3d> sums(boundingBoxes.size());
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
     {
-        // assemble vector for matrix-vector-multiplication
-        X.at<double>(0, 0) = it1->x;
-        X.at<double>(1, 0) = it1->y;
-        X.at<double>(2, 0) = it1->z;
-        X.at<double>(3, 0) = 1;
-
-        // project Lidar point into camera
-        Y = P_rect_xx * R_rect_xx * RT * X;
-        cv::Point pt;
-        pt.x = Y.at<double>(0, 0) / Y.at<double>(0, 2); // pixel coordinates
-        pt.y = Y.at<double>(1, 0) / Y.at<double>(0, 2);
-
-        vector<vector<BoundingBox>::iterator> enclosingBoxes; // pointers to all bounding boxes which enclose the current Lidar point
-        for (vector<BoundingBox>::iterator it2 = boundingBoxes.begin(); it2 != boundingBoxes.end(); ++it2)
+        if (boxIndices[i] < 0)
         {
-            // shrink current bounding box slightly to avoid having too many outlier points around the edges
-            cv::Rect smallerBox;
-            smallerBox.x = (*it2).roi.x + shrinkFactor * (*it2).roi.width / 2.0;
-            smallerBox.y = (*it2).roi.y + shrinkFactor * (*it2).roi.height / 2.0;
-            smallerBox.width = (*it2).roi.width * (1 - shrinkFactor);
-            smallerBox.height = (*it2).roi.height * (1 - shrinkFactor);
-
-            // check wether point is within current bounding box
-            if (smallerBox.contains(pt))
-            {
-                enclosingBoxes.push_back(it2);
-            }
-
-        } // eof loop over all bounding boxes
-
-        // check wether point has been enclosed by one or by multiple boxes
-        if (enclosingBoxes.size() == 1)
+            continue;
+        }
+        BoundingBox &box = boundingBoxes[boxIndices[i]];
+        const LidarPoint &pt = lidarPoints[i];
+        LidarBoxSummary &summary = box.lidarSummary;
+        ++summary.count;
+        summary.minX = min(summary.minX, (float)pt.x);
+        summary.maxX = max(summary.maxX, (float)pt.x);
+        summary.minY = min(summary.minY, (float)pt.y);
+        summary.maxY = max(summary.maxY, (float)pt.y);
+        sums[boxIndices[i]] += cv::Point3d(pt.x, pt.y, pt.z);
+        int bin = min(max((int)(pt.x / LidarBoxSummary::HISTOGRAM_BIN_WIDTH), 0), LidarBoxSummary::HISTOGRAM_BINS - 1);
+        ++summary.xHistogram[bin];
+        sketchInsert(summary.xSketch, pt.x);
+        if (bKeepPoints)
         {
-            // add Lidar point to bounding box
-            enclosingBoxes[0]->lidarPoints.push_back(*it1);
+            box.lidarPoints.push_back(pt);
         }
+    }
 
-    } // eof loop over all Lidar points
+    for (size_t b = 0; b < boundingBoxes.size(); ++b)
+    {
+        LidarBoxSummary &summary = boundingBoxes[b].lidarSummary;
+        if (summary.count > 0)
+        {
+            summary.centroid = cv::Point3f(sums[b] / summary.count);
+        }
+        finalizeSketch(summary.xSketch);
+    }
 }
 
 void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize, cv::Size imageSize, bool bWait)
@@ -70,30 +79,38 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
         cv::RNG rng(it1->boxID);
         cv::Scalar currColor = cv::Scalar(rng.uniform(0, 150), rng.uniform(0, 150), rng.uniform(0, 150));
 
-        // plot Lidar points into top view image
-        int top = 1e8, left = 1e8, bottom = 0.0, right = 0.0;
-        float xwmin = 1e8, ywmin = 1e8, ywmax = -1e8;
-        for (auto it2 = it1->lidarPoints.begin(); it2 != it1->lidarPoints.end(); ++it2)
+        // top-view coordinates of world positions in m with x facing forward and y facing left from sensor
+        auto topviewY = [&](float xw) { return (int)((-xw * imageSize.height / worldSize.height) + imageSize.height); };
+        auto topviewX = [&](float yw) { return (int)((-yw * imageSize.width / worldSize.width) + imageSize.width / 2); };
+
+        const LidarBoxSummary &summary = it1->lidarSummary;
+        if (summary.count == 0)
+        {
+            continue;
+        }
+        int top = topviewY(summary.maxX), bottom = topviewY(summary.minX);
+        int left = topviewX(summary.maxY), right = topviewX(summary.minY);
+
+        if (!it1->lidarPoints.empty())
+        {
+            // draw individual points
+            for (auto it2 = it1->lidarPoints.begin(); it2 != it1->lidarPoints.end(); ++it2)
+            {
+                cv::circle(topviewImg, cv::Point(topviewX((*it2).y), topviewY((*it2).x)), 4, currColor, -1);
+            }
+        }
+        else
         {
-            // world coordinates
-            float xw = (*it2).x; // world position in m with x facing forward from sensor
-            float yw = (*it2).y; // world position in m with y facing left from sensor
-            xwmin = xwmin < xw ? xwmin : xw;
-            ywmin = ywmin < yw ? ywmin : yw;
-            ywmax = ywmax > yw ? ywmax : yw;
-
-            // top-view coordinates
-            int y = (-xw * imageSize.height / worldSize.height) + imageSize.height;
-            int x = (-yw * imageSize.width / worldSize.width) + imageSize.width / 2;
-
-            // find enclosing rectangle
-            top = top < y ? top : y;
-            left = left < x ? left : x;
-            bottom = bottom > y ? bottom : y;
-            right = right > x ? right : x;
-            
-            // draw individual point
-            cv::circle(topviewImg, cv::Point(x, y), 4, currColor, -1);
+            // without point copies, draw the forward distance histogram across the lateral extent
+            for (int bin = 0; bin < LidarBoxSummary::HISTOGRAM_BINS; ++bin)
+            {
+                if (summary.xHistogram[bin] > 0)
+                {
+                    int y = topviewY((bin + 0.5f) * LidarBoxSummary::HISTOGRAM_BIN_WIDTH);
+                    int thickness = min(1 + summary.xHistogram[bin] / 10, 20);
+                    cv::line(topviewImg, cv::Point(left, y), cv::Point(right, y), currColor, thickness);
+                }
+            }
         }
 
         // draw enclosing rectangle
@@ -101,16 +118,16 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
 
         // augment object with some key data
         char str1[200], str2[200];
-        sprintf(str1, "id=%d, #pts=%d, #cls=%d", it1->boxID, (int)it1->lidarPoints.size(), it1->classID);
+        sprintf(str1, "id=%d, #pts=%d, #cls=%d", it1->boxID, summary.count, it1->classID);
         putText(topviewImg, str1, cv::Point2f(left - 250, bottom + 50), cv::FONT_ITALIC, 2, currColor);
-        sprintf(str2, "xmin=%2.2f m, yw=%2.2f m", xwmin, ywmax - ywmin);
+        sprintf(str2, "xmin=%2.2f m, yw=%2.2f m", summary.minX, summary.maxY - summary.minY);
         putText(topviewImg, str2, cv::Point2f(left - 250, bottom + 125), cv::FONT_ITALIC, 2, currColor);
     }
 
     // plot distance markers
     float lineSpacing = 2.0; // gap between distance markers
     int nMarkers = floor(worldSize.height / lineSpacing);
-    for (size_t i = 0; i < nMarkers; ++i)
+    for (int i = 0; i < nMarkers; ++i)
     {
         int y = (-(i * lineSpacing) * imageSize.height / worldSize.height) + imageSize.height;
         cv::line(topviewImg, cv::Point(0, y), cv::Point(imageSize.width, y), cv::Scalar(255, 0, 0));
@@ -147,124 +164,234 @@ void clusterKptMatchesWithROI(BoundingBox &boundingBox, std::vector<cv::KeyPoint
 
 }
 
-// Compute time-to-collision (TTC) based on keypoint correspondences in successive images
-void computeTTCCamera(std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr,
-                      std::vector<cv::DMatch> kptMatches, double frameRate, double &TTC, cv::Mat *visImg)
+// uniform grid over the image area covered by bounding boxes, each cell lists the boxes overlapping it
+struct BoxGrid
 {
-    std::vector<double>distRatios;
-    for (auto it1 = kptMatches.begin(); it1 != kptMatches.end()-1; ++it1)
-    {
-        cv::KeyPoint keyCurrOuter = kptsCurr[it1->trainIdx];
-        cv::KeyPoint keyPrevOuter = kptsPrev[it1->queryIdx];
+    cv::Rect bounds;
+    int cellSize, cols, rows;
+    std::vector<std::vector<int>> cells;
 
-        for (auto it2 = kptMatches.begin() + 1; it2 != kptMatches.end(); ++it2)
+    BoxGrid(std::vector<BoundingBox> &boundingBoxes, int cellSize_) : cellSize(cellSize_), cols(0), rows(0)
+    {
+        for (auto &bb : boundingBoxes)
         {
-            double minDist = 100.0;
-            cv::KeyPoint keyCurrInner = kptsCurr[it2->trainIdx];
-            cv::KeyPoint keyPrevInner = kptsPrev[it2->queryIdx];
+            bounds = bounds.area() > 0 ? (bounds | bb.roi) : bb.roi;
+        }
+        if (bounds.area() <= 0)
+        {
+            return;
+        }
 
-            double distCurr = cv::norm(keyCurrOuter.pt - keyCurrInner.pt);
-            double distPrev = cv::norm(keyPrevOuter.pt - keyPrevInner.pt);
-            if (distPrev > std::numeric_limits<double>::epsilon() && distCurr >= minDist)
+        cols = (bounds.width + cellSize - 1) / cellSize;
+        rows = (bounds.height + cellSize - 1) / cellSize;
+        cells.resize(cols * rows);
+        for (int i = 0; i < (int)boundingBoxes.size(); ++i)
+        {
+            cv::Rect roi = boundingBoxes[i].roi & bounds;
+            if (roi.area() <= 0)
+            {
+                continue;
+            }
+            int c0 = (roi.x - bounds.x) / cellSize, c1 = (roi.x + roi.width - 1 - bounds.x) / cellSize;
+            int r0 = (roi.y - bounds.y) / cellSize, r1 = (roi.y + roi.height - 1 - bounds.y) / cellSize;
+            for (int r = r0; r <= r1; ++r)
             {
-                double distRatio = distCurr/distPrev;
-                distRatios.push_back(distRatio);
+                for (int c = c0; c <= c1; ++c)
+                {
+                    cells[r * cols + c].push_back(i);
+                }
             }
+        }
+    }
 
+    // candidate boxes for a given pixel (empty if outside all boxes), callers test the same pixel against the boxes
+    const std::vector<int> *candidates(const cv::Point &pt) const
+    {
+        if (cells.empty() || !bounds.contains(pt))
+        {
+            return nullptr;
+        }
+        int c = std::min((pt.x - bounds.x) / cellSize, cols - 1);
+        int r = std::min((pt.y - bounds.y) / cellSize, rows - 1);
+        return &cells[r * cols + c];
+    }
+};
+
+// associate all bounding boxes of a frame with the keypoint matches they contain in a single pass over all matches
+void clusterKptMatchesWithROIs(std::vector<BoundingBox> &boundingBoxes, std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches, KptMatchPartition &partition)
+{
+    int cellSize = 32; // grid cell size in [px]
+    BoxGrid grid(boundingBoxes, cellSize);
+
+    size_t nBoxes = boundingBoxes.size();
+    std::vector<size_t> counts(nBoxes, 0);
+    std::vector<double> sumDist(nBoxes, 0.0);
+
+    // first pass: count matches per box
+    for (auto &match : kptMatches)
+    {
+        cv::Point pt = kptsCurr[match.trainIdx].pt; // rounded like Rect::contains rounds a Point2f
+        auto boxes = grid.candidates(pt);
+        if (boxes == nullptr)
+        {
+            continue;
+        }
+        for (int i : *boxes)
+        {
+            if (boundingBoxes[i].roi.contains(pt))
+            {
+                ++counts[i];
+                sumDist[i] += match.distance;
+            }
         }
     }
 
-    if(distRatios.size() == 0)
+    partition.offsets.assign(nBoxes + 1, 0);
+    for (size_t i = 0; i < nBoxes; ++i)
+    {
+        partition.offsets[i + 1] = partition.offsets[i] + counts[i];
+    }
+
+    // second pass: scatter matches into the span of every enclosing box
+    partition.matches.resize(partition.offsets[nBoxes]);
+    std::vector<size_t> fill(partition.offsets.begin(), partition.offsets.end() - 1);
+    for (auto &match : kptMatches)
     {
-        TTC = NAN;
-        return;
+        cv::Point pt = kptsCurr[match.trainIdx].pt;
+        auto boxes = grid.candidates(pt);
+        if (boxes == nullptr)
+        {
+            continue;
+        }
+        for (int i : *boxes)
+        {
+            if (boundingBoxes[i].roi.contains(pt))
+            {
+                partition.matches[fill[i]++] = match;
+            }
+        }
     }
-    std::sort(distRatios.begin(), distRatios.end());
-    int medIdx = floor(distRatios.size()/2);
-    double medDistRatio = distRatios.size()%2 == 0 ? (distRatios[medIdx-1] + distRatios[medIdx])/2.0 : distRatios[medIdx];
-    double dT = 1.0/frameRate;
-    TTC = -dT/(1-medDistRatio);
 
+    // apply the same distance filter as clusterKptMatchesWithROI to each span and compact the spans
+    size_t out = 0;
+    for (size_t i = 0; i < nBoxes; ++i)
+    {
+        size_t begin = partition.offsets[i], end = partition.offsets[i + 1];
+        double meanDist = counts[i] > 0 ? sumDist[i] / counts[i] : 0.0;
+        partition.offsets[i] = out;
+        for (size_t k = begin; k < end; ++k)
+        {
+            if (!(partition.matches[k].distance < 0.7 * meanDist))
+            {
+                partition.matches[out++] = partition.matches[k];
+            }
+        }
+    }
+    partition.offsets[nBoxes] = out;
+    partition.matches.resize(out);
+}
 
+// Compute time-to-collision (TTC) based on keypoint correspondences in successive images
+void computeTTCCamera(std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr,
+                      std::vector<cv::DMatch> kptMatches, double frameRate, double &TTC, cv::Mat *visImg)
+{
+    TTC = computeTTCCameraT<FusionScalar>(kptsPrev, kptsCurr, kptMatches, frameRate);
 }
 
+// Compute time-to-collision (TTC) from the median distance of the Lidar points on the preceding vehicle
 void computeTTCLidar(std::vector<LidarPoint> &lidarPointsPrev,
                      std::vector<LidarPoint> &lidarPointsCurr, double frameRate, double &TTC)
 {
-    std::vector<double> currDistances, prevDistances;
-    std::sort(lidarPointsCurr.begin(), lidarPointsCurr.end(), [](auto lidPt1, auto lidPt2) { return lidPt1.x < lidPt2.x; });
-
-    std::sort(lidarPointsPrev.begin(), lidarPointsPrev.end(), [](auto lidPt1, auto lidPt2) { return lidPt1.x < lidPt2.x; });
-
-    int medCurrIdx = floor(lidarPointsCurr.size() / 2);
-    int medPrevidx = floor(lidarPointsPrev.size() / 2);
-
-    double medCurrX = lidarPointsCurr.size() % 2 == 0 ? (lidarPointsCurr[medCurrIdx - 1].x + lidarPointsCurr[medCurrIdx].x) / 2.0 : lidarPointsCurr[medCurrIdx].x;
-    double medPrevX = lidarPointsPrev.size() % 2 == 0 ? (lidarPointsPrev[medPrevidx - 1].x + lidarPointsPrev[medPrevidx].x) / 2.0 : lidarPointsPrev[medPrevidx].x;
+    TTC = computeTTCLidarT<FusionScalar>(lidarPointsPrev, lidarPointsCurr, frameRate);
+}
 
+// Same estimate from the median forward distances held by the quantile sketches of both boxes, no sorting of points
+void computeTTCLidar(const QuantileSketch &xSketchPrev, const QuantileSketch &xSketchCurr, double frameRate, double &TTC)
+{
+    double medPrevX = sketchQuantile(xSketchPrev, 0.5);
+    double medCurrX = sketchQuantile(xSketchCurr, 0.5);
     double dT = 1.0 / frameRate;
     TTC = dT * medCurrX / (medPrevX - medCurrX);
-    // TTC = dT * lidarPointsCurr[0].x / (lidarPointsPrev[0].x - lidarPointsCurr[0].x);
 }
 
-void matchBoundingBoxes(std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame)
+// Associate bounding boxes between previous and current frame. Keypoint votes and the overlap between the motion-predicted
+// previous box and the current box are fused into one score; boxes with too few keypoint votes are associated by overlap alone.
+// Boxes of different classes are never associated.
+void matchBoundingBoxes(std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame, int minKptVotes, double minIoU)
 {
-    std::multimap<int, int> bboxIdMap;
-    int currId = -1;
-    int prevId = -1;
-    int prevMaxId = 0;
+    size_t nPrev = prevFrame.boundingBoxes.size(), nCurr = currFrame.boundingBoxes.size();
+
+    // count keypoint matches connecting each pair of boxes
+    std::vector<std::vector<int>> votes(nPrev, std::vector<int>(nCurr, 0));
+    std::vector<int> currVotes(nCurr, 0);
     for (auto it = matches.begin(); it != matches.end(); ++it)
     {
-        cv::KeyPoint currKeypoint = currFrame.keypoints[it->trainIdx];
-        cv::KeyPoint prevKeypoint = prevFrame.keypoints[it->queryIdx];
+        const cv::Point2f &currPt = currFrame.keypoints[it->trainIdx].pt;
+        const cv::Point2f &prevPt = prevFrame.keypoints[it->queryIdx].pt;
 
-        for (auto bbox : currFrame.boundingBoxes)
+        int currIdx = -1, prevIdx = -1;
+        for (size_t i = 0; i < nCurr && currIdx < 0; ++i)
         {
-            if (bbox.roi.contains(currKeypoint.pt))
+            if (currFrame.boundingBoxes[i].roi.contains(currPt))
             {
-                currId = bbox.boxID;
-                break;
+                currIdx = i;
             }
         }
-        for (auto bbox : prevFrame.boundingBoxes)
+        for (size_t i = 0; i < nPrev && prevIdx < 0; ++i)
         {
-            if (bbox.roi.contains(prevKeypoint.pt))
+            if (prevFrame.boundingBoxes[i].roi.contains(prevPt))
             {
-                prevId = bbox.boxID;
-                break;
+                prevIdx = i;
             }
         }
-        bboxIdMap.insert(std::make_pair(currId, prevId));
 
-        prevMaxId = std::max(prevMaxId, prevId);
-    }
-
-    std::vector<int> currFrameBboxIds;
-    for (auto &bbox : currFrame.boundingBoxes)
-    {
-        currFrameBboxIds.push_back(bbox.boxID);
+        if (currIdx >= 0 && prevIdx >= 0)
+        {
+            ++votes[prevIdx][currIdx];
+            ++currVotes[currIdx];
+        }
     }
 
-    for (int cid : currFrameBboxIds)
+    // fuse keypoint votes and predicted overlap into one assignment score
+    double kptWeight = 0.5; // weight of the keypoint votes when they are sufficient
+    struct Candidate { double score; int prevIdx, currIdx; };
+    std::vector<Candidate> candidates;
+    for (size_t p = 0; p < nPrev; ++p)
     {
-        auto prevMatchedIds = bboxIdMap.equal_range(cid);
-
-        
-        std::vector<int> countMaxId(prevMaxId + 1, 0);
-
-        
-        for (auto it = prevMatchedIds.first; it != prevMatchedIds.second; it++)
+        cv::Rect predicted = predictBoundingBox(prevFrame.boundingBoxes[p]);
+        for (size_t c = 0; c < nCurr; ++c)
         {
-            if (it->second != -1)
+            // only boxes of the same class are associated, like in associateBoxesIoU (a car never continues a truck or person track)
+            if (prevFrame.boundingBoxes[p].classID != currFrame.boundingBoxes[c].classID)
             {
-                
-                countMaxId[it->second] += 1;
+                continue;
             }
-        } 
+            double iou = computeIoU(predicted, currFrame.boundingBoxes[c].roi);
+            iou = iou >= minIoU ? iou : 0.0;
 
-        int pid = std::distance(countMaxId.begin(), std::max_element(countMaxId.begin(), countMaxId.end()));
-        bbBestMatches.insert(std::make_pair(pid, cid));
+            double score = iou;
+            if (currVotes[c] >= minKptVotes)
+            {
+                double kptScore = (double)votes[p][c] / currVotes[c];
+                score = kptWeight * kptScore + (1 - kptWeight) * iou;
+            }
+            if (score > 0.0)
+            {
+                candidates.push_back({score, (int)p, (int)c});
+            }
+        }
     }
 
-
+    // greedy one-to-one assignment in order of decreasing score
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &c1, const Candidate &c2) { return c1.score > c2.score; });
+    std::vector<bool> prevUsed(nPrev, false), currUsed(nCurr, false);
+    for (auto &candidate : candidates)
+    {
+        if (prevUsed[candidate.prevIdx] || currUsed[candidate.currIdx])
+        {
+            continue;
+        }
+        prevUsed[candidate.prevIdx] = currUsed[candidate.currIdx] = true;
+        bbBestMatches.insert(std::make_pair(prevFrame.boundingBoxes[candidate.prevIdx].boxID, currFrame.boundingBoxes[candidate.currIdx].boxID));
+    }
 }
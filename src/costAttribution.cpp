@@ -0,0 +1,136 @@
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "costAttribution.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+// heap allocations of the calling thread during active probes, reported by the replaced global operator new;
+// executables without allocCounter.cpp report no allocations
+static thread_local size_t threadAllocBytes = 0;
+static thread_local size_t threadAllocCount = 0;
+static thread_local int threadActiveProbes = 0;
+
+void countAllocation(size_t size)
+{
+    if (threadActiveProbes > 0)
+    {
+        threadAllocBytes += size;
+        ++threadAllocCount;
+    }
+}
+
+static const char *kKernelNames[] = {"lidar_ttc", "lidar_icp", "camera_ttc"};
+
+CostProbe startCostProbe(bool bEnabled)
+{
+    CostProbe probe;
+    if (!bEnabled)
+    {
+        return probe;
+    }
+    probe.bActive = true;
+    ++threadActiveProbes;
+    probe.allocBytes = threadAllocBytes;
+    probe.allocCount = threadAllocCount;
+    probe.ticks = (double)cv::getTickCount();
+    return probe;
+}
+
+// add time and allocations since the probe was started to the given kernel of the object
+void stopCostProbe(const CostProbe &probe, ObjectCost &cost, CostKernel kernel)
+{
+    if (!probe.bActive)
+    {
+        return;
+    }
+    --threadActiveProbes;
+    cost.kernelMs[kernel] += 1000.0 * ((double)cv::getTickCount() - probe.ticks) / cv::getTickFrequency();
+    cost.allocBytes += threadAllocBytes - probe.allocBytes;
+    cost.allocCount += threadAllocCount - probe.allocCount;
+}
+
+double objectCostMs(const ObjectCost &cost)
+{
+    double total = 0.0;
+    for (int k = 0; k < COST_KERNELS; ++k)
+    {
+        total += cost.kernelMs[k];
+    }
+    return total;
+}
+
+static bool moreExpensive(const ObjectCost &a, const ObjectCost &b)
+{
+    return objectCostMs(a) > objectCostMs(b);
+}
+
+void recordObjectCost(CostAttribution &attribution, const ObjectCost &cost)
+{
+    ++attribution.nObjects;
+    attribution.totalMs += objectCostMs(cost);
+
+    // keep the topK most expensive objects, the cheapest of them on top of the heap
+    vector<ObjectCost> &top = attribution.top;
+    if ((int)top.size() < attribution.topK)
+    {
+        top.push_back(cost);
+        push_heap(top.begin(), top.end(), moreExpensive);
+    }
+    else if (!top.empty() && objectCostMs(cost) > objectCostMs(top.front()))
+    {
+        pop_heap(top.begin(), top.end(), moreExpensive);
+        top.back() = cost;
+        push_heap(top.begin(), top.end(), moreExpensive);
+    }
+}
+
+static vector<ObjectCost> sortedTopCosts(const CostAttribution &attribution)
+{
+    vector<ObjectCost> sorted = attribution.top;
+    sort(sorted.begin(), sorted.end(), moreExpensive);
+    return sorted;
+}
+
+void printTopCosts(const CostAttribution &attribution)
+{
+    vector<ObjectCost> sorted = sortedTopCosts(attribution);
+    cout << "Object cost : " << attribution.nObjects << " objects, " << attribution.totalMs << " ms in TTC kernels, top " << sorted.size() << " :" << endl;
+    for (auto &cost : sorted)
+    {
+        cout << "  frame " << cost.frameIndex << " track " << cost.trackID << " : " << objectCostMs(cost) << " ms (Lidar " << cost.kernelMs[COST_LIDAR_TTC]
+             << ", ICP " << cost.kernelMs[COST_LIDAR_ICP] << ", camera " << cost.kernelMs[COST_CAMERA_TTC] << "), " << cost.nLidarPoints << " pts, "
+             << cost.nMatches << " matches, " << cost.nPairs << " pairs, " << cost.allocCount << " allocs / " << (cost.allocBytes >> 10) << " KB" << endl;
+    }
+}
+
+// one line per object, most expensive first
+bool writeTopCosts(const CostAttribution &attribution, const std::string &filename)
+{
+    ofstream file(filename);
+    if (!file)
+    {
+        LOG_ERROR("Cannot write object costs to " << filename);
+        return false;
+    }
+    file << "frame,track,box,lidar_points,matches,pairs";
+    for (int k = 0; k < COST_KERNELS; ++k)
+    {
+        file << "," << kKernelNames[k] << "_ms";
+    }
+    file << ",total_ms,alloc_count,alloc_bytes" << endl;
+    for (auto &cost : sortedTopCosts(attribution))
+    {
+        file << cost.frameIndex << "," << cost.trackID << "," << cost.boxID << "," << cost.nLidarPoints << "," << cost.nMatches << "," << cost.nPairs;
+        for (int k = 0; k < COST_KERNELS; ++k)
+        {
+            file << "," << cost.kernelMs[k];
+        }
+        file << "," << objectCostMs(cost) << "," << cost.allocCount << "," << cost.allocBytes << endl;
+    }
+    return true;
+}
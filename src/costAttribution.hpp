@@ -0,0 +1,47 @@
+
+#ifndef costAttribution_hpp
+#define costAttribution_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// per-kernel cost of the TTC computation for one object
+enum CostKernel { COST_LIDAR_TTC, COST_LIDAR_ICP, COST_CAMERA_TTC, COST_KERNELS };
+
+struct ObjectCost { // work done for one tracked object in one frame
+    int frameIndex = -1;
+    int trackID = -1;
+    int boxID = -1;
+    int nLidarPoints = 0;
+    int nMatches = 0;                     // keypoint matches enclosed by the box
+    long long nPairs = 0;                 // match pairs evaluated by the camera TTC
+    double kernelMs[COST_KERNELS] = {};
+    size_t allocBytes = 0;                // heap memory allocated by the kernels
+    size_t allocCount = 0;
+};
+
+struct CostProbe { // start of a measured kernel call
+    bool bActive = false;                 // false if attribution is disabled, stopping the probe records nothing
+    double ticks = 0.0;
+    size_t allocBytes = 0, allocCount = 0;
+};
+
+struct CostAttribution { // most expensive objects of a run
+    bool bEnabled = false;
+    int topK = 10;
+    std::vector<ObjectCost> top;          // min-heap on total time, at most topK entries
+    int nObjects = 0;
+    double totalMs = 0.0;
+};
+
+CostProbe startCostProbe(bool bEnabled=true);
+void stopCostProbe(const CostProbe &probe, ObjectCost &cost, CostKernel kernel);
+void countAllocation(size_t size); // called by the global operator new of allocCounter.cpp, counts only while a probe is active
+double objectCostMs(const ObjectCost &cost);
+void recordObjectCost(CostAttribution &attribution, const ObjectCost &cost);
+void printTopCosts(const CostAttribution &attribution);
+bool writeTopCosts(const CostAttribution &attribution, const std::string &filename);
+
+#endif /* costAttribution_hpp */
@@ -4,26 +4,60 @@
 
 #include <vector>
 #include <map>
+#include <array>
+#include <cstdint>
 #include <opencv2/core.hpp>
 
-struct LidarPoint { // single lidar point in space
-    double x,y,z,r; // x,y,z in [m], r is point reflectivity
+#include "quantileSketch.hpp"
+#include "stageTrace.hpp"
+
+// precision of Lidar points and of the projection, clustering and TTC kernels, selected per deployment (see FUSION_SCALAR in CMakeLists.txt)
+#ifdef FUSION_SCALAR_FLOAT
+typedef float FusionScalar;
+#else
+typedef double FusionScalar;
+#endif
+
+template <typename T>
+struct LidarPointT { // single lidar point in space
+    T x,y,z,r; // x,y,z in [m], r is point reflectivity
+};
+typedef LidarPointT<FusionScalar> LidarPoint;
+
+struct LidarBoxSummary { // compact statistics of the Lidar points of one box, accumulated while the points are assigned
+    static const int HISTOGRAM_BINS = 64;
+    static constexpr float HISTOGRAM_BIN_WIDTH = 0.5f; // [m], the last bin collects all points beyond the range
+
+    int count = 0;
+    float minX = 1e8, maxX = -1e8; // forward distance [m]
+    float minY = 1e8, maxY = -1e8; // lateral extent [m]
+    cv::Point3f centroid; // mean position [m]
+    std::array<uint16_t, HISTOGRAM_BINS> xHistogram{}; // no. of points per forward distance bin
+    QuantileSketch xSketch; // distribution of the forward distance for robust quantiles
 };
 
 struct BoundingBox { // bounding box around a classified object (contains both 2D and 3D data)
     
     int boxID; // unique identifier for this bounding box
-    int trackID; // unique identifier for the track to which this bounding box belongs
+    int trackID = -1; // unique identifier for the track to which this bounding box belongs
     
     cv::Rect roi; // 2D region-of-interest in image coordinates
+    cv::Point2f velocity; // smoothed image-space motion of the roi center in [px/frame], used to predict the box in the next frame
+    float scaleRate = 1.0f; // smoothed relative change of the roi size per frame
     int classID; // ID based on class file provided to YOLO framework
     double confidence; // classification trust
 
-    std::vector<LidarPoint> lidarPoints; // Lidar 3D points which project into 2D image roi
+    std::vector<LidarPoint> lidarPoints; // Lidar 3D points which project into 2D image roi, only filled on request
+    LidarBoxSummary lidarSummary; // statistics of the Lidar points which project into 2D image roi
     std::vector<cv::KeyPoint> keypoints; // keypoints enclosed by 2D roi
     std::vector<cv::DMatch> kptMatches; // keypoint matches enclosed by 2D roi
 };
 
+struct KptMatchPartition { // keypoint matches bucketed by enclosing bounding box, all boxes share one match array
+    std::vector<cv::DMatch> matches; // matches of all boxes, grouped by box position within the frame
+    std::vector<size_t> offsets; // matches of the i-th box are in [offsets[i], offsets[i+1])
+};
+
 struct DataFrame { // represents the available sensor information at the same time instance
     
     cv::Mat cameraImg; // camera image
@@ -31,10 +65,14 @@ struct DataFrame { // represents the available sensor information at the same ti
     std::vector<cv::KeyPoint> keypoints; // 2D keypoints within camera image
     cv::Mat descriptors; // keypoint descriptors
     std::vector<cv::DMatch> kptMatches; // keypoint matches between previous and current frame
+    KptMatchPartition boxKptMatches; // keypoint matches partitioned into the bounding boxes of this frame
     std::vector<LidarPoint> lidarPoints;
 
     std::vector<BoundingBox> boundingBoxes; // ROI around detected objects in 2D image coordinates
     std::map<int,int> bbMatches; // bounding box matches between previous and current frame
+    int featureEngine = -1; // index of the feature engine which computed keypoints and descriptors, -1 for the configured detector/descriptor
+    bool bStatic = false; // frame is near-identical to its predecessor and reuses its detections, keypoints and descriptors
+    FrameTrace trace; // time spent in each pipeline stage
 };
 
 #endif /* dataStructures_h */
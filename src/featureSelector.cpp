@@ -0,0 +1,121 @@
+
+#include <iostream>
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "featureSelector.hpp"
+#include "matching2D.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+// create detectors and extractors of all engines once, so switching does not pay for their construction
+void initFeatureSelector(const FeatureSelectorPolicy &policy, FeatureSelectorState &state)
+{
+    state.engines.clear();
+    for (auto &types : policy.engines)
+    {
+        FeatureEngine engine;
+        engine.detectorType = types.first;
+        engine.descriptorType = types.second;
+        engine.detector = createKeypointDetector(types.first);
+        engine.extractor = createDescriptorExtractor(types.second);
+        state.engines.push_back(engine);
+    }
+    state.current = max(0, min(policy.initialEngine, (int)state.engines.size() - 1));
+    state.poorFrames = state.goodFrames = state.framesSinceSwitch = state.switches = 0;
+}
+
+void computeEngineFeatures(FeatureEngine &engine, cv::Mat &img, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors)
+{
+    double t = (double)cv::getTickCount();
+
+    cv::Mat imgGray;
+    cv::cvtColor(img, imgGray, cv::COLOR_BGR2GRAY);
+    keypoints.clear();
+    engine.detector->detect(imgGray, keypoints);
+    engine.extractor->compute(img, keypoints, descriptors);
+
+    t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+    engine.meanTime = engine.meanTime > 0.0 ? 0.8 * engine.meanTime + 0.2 * t : t;
+}
+
+// fraction of all descriptor matches of a frame pair that agree with a fundamental matrix fitted by RANSAC (1 px);
+// unlike the share of matches inside object boxes it also drops for wrong matches within a box
+double matchInlierRatio(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr, const std::vector<cv::DMatch> &matches)
+{
+    if (matches.size() < 8)
+    {
+        return 0.0;
+    }
+    vector<cv::Point2f> prevPts, currPts;
+    for (auto &match : matches)
+    {
+        prevPts.push_back(kptsPrev[match.queryIdx].pt);
+        currPts.push_back(kptsCurr[match.trainIdx].pt);
+    }
+    vector<uchar> inliers;
+    cv::Mat F = cv::findFundamentalMat(prevPts, currPts, cv::FM_RANSAC, 1.0, 0.99, inliers);
+    if (F.empty())
+    {
+        return 0.0;
+    }
+    return (double)count(inliers.begin(), inliers.end(), 1) / matches.size();
+}
+
+// Decide on the engine for the next frame: poor frames move to a more expensive engine, a long run of good frames
+// to a cheaper one. Switches require a streak of frames and a minimum dwell time, so single outliers do not cause flapping.
+void updateFeatureSelector(const FeatureSelectorPolicy &policy, FeatureSelectorState &state, const FeatureSignals &signals, int frameIndex)
+{
+    ++state.framesSinceSwitch;
+
+    string reason;
+    if (signals.nMatches < policy.minMatches)
+    {
+        reason = "few matches";
+    }
+    else if (signals.inlierRatio < policy.minInlierRatio)
+    {
+        reason = "low inlier ratio";
+    }
+    else if (std::isfinite(signals.ttcInconsistency) && signals.ttcInconsistency > policy.maxTTCInconsistency)
+    {
+        reason = "inconsistent TTC";
+    }
+
+    bool bGood = signals.nMatches >= policy.goodMatches && signals.inlierRatio >= policy.goodInlierRatio &&
+                 (!std::isfinite(signals.ttcInconsistency) || signals.ttcInconsistency <= policy.goodTTCInconsistency);
+    state.poorFrames = reason.empty() ? 0 : state.poorFrames + 1;
+    state.goodFrames = bGood ? state.goodFrames + 1 : 0;
+
+    int next = state.current;
+    if (state.framesSinceSwitch >= policy.minDwellFrames)
+    {
+        if (state.poorFrames >= policy.upgradeFrames && state.current + 1 < (int)state.engines.size())
+        {
+            next = state.current + 1;
+        }
+        else if (state.goodFrames >= policy.downgradeFrames && state.current > 0)
+        {
+            next = state.current - 1;
+            reason = "good quality";
+        }
+    }
+
+    FeatureEngine &engine = state.engines[state.current];
+    if (next == state.current)
+    {
+        LOG_DEBUG("Frame " << frameIndex << " : keeping " << engine.detectorType << "/" << engine.descriptorType << " (" << signals.nMatches
+                  << " matches, inlier ratio " << signals.inlierRatio << ", TTC inconsistency " << signals.ttcInconsistency << ")");
+        return;
+    }
+
+    FeatureEngine &nextEngine = state.engines[next];
+    LOG_INFO("Frame " << frameIndex << " : switching " << engine.detectorType << "/" << engine.descriptorType << " -> "
+             << nextEngine.detectorType << "/" << nextEngine.descriptorType << " (" << reason << " : " << signals.nMatches << " matches, inlier ratio "
+             << signals.inlierRatio << ", TTC inconsistency " << signals.ttcInconsistency << ", " << 1000 * engine.meanTime << " ms per frame)");
+    state.current = next;
+    state.poorFrames = state.goodFrames = state.framesSinceSwitch = 0;
+    ++state.switches;
+}
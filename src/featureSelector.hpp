@@ -0,0 +1,63 @@
+
+#ifndef featureSelector_hpp
+#define featureSelector_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <utility>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "dataStructures.h"
+
+struct FeatureSelectorPolicy { // switches between feature engines based on per-frame quality signals
+
+    // detector / descriptor combinations, ordered from cheapest to most expensive
+    std::vector<std::pair<std::string, std::string>> engines{{"FAST", "BRIEF"}, {"ORB", "ORB"}, {"AKAZE", "AKAZE"}, {"SIFT", "SIFT"}};
+    int initialEngine = 2;
+
+    // a frame is poor if any signal is below (above) these limits
+    int minMatches = 100;              // no. of keypoint matches between the frames
+    double minInlierRatio = 0.5;       // fraction of matches consistent with the epipolar geometry of the frame pair (RANSAC)
+    double maxTTCInconsistency = 0.3;  // median relative difference between camera and Lidar TTC
+
+    // a frame is good if all signals are beyond these limits
+    int goodMatches = 300;
+    double goodInlierRatio = 0.7;
+    double goodTTCInconsistency = 0.1;
+
+    // hysteresis
+    int upgradeFrames = 2;             // no. of consecutive poor frames before switching to a more expensive engine
+    int downgradeFrames = 8;           // no. of consecutive good frames before switching to a cheaper engine
+    int minDwellFrames = 5;            // min. no. of frames between two switches
+};
+
+struct FeatureEngine { // preloaded detector and extractor
+    std::string detectorType, descriptorType;
+    cv::Ptr<cv::FeatureDetector> detector;
+    cv::Ptr<cv::DescriptorExtractor> extractor;
+    double meanTime = 0.0;             // smoothed time of detection and description [s]
+};
+
+struct FeatureSignals { // quality signals of one frame pair
+    int nMatches = 0;
+    double inlierRatio = 0.0;          // see matchInlierRatio
+    double ttcInconsistency = NAN;     // NAN if no object had both camera and Lidar TTC
+};
+
+struct FeatureSelectorState {
+    std::vector<FeatureEngine> engines;
+    int current = -1;                  // engine used for upcoming frames
+    int poorFrames = 0, goodFrames = 0;
+    int framesSinceSwitch = 0;
+    int switches = 0;
+};
+
+void initFeatureSelector(const FeatureSelectorPolicy &policy, FeatureSelectorState &state);
+void computeEngineFeatures(FeatureEngine &engine, cv::Mat &img, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+double matchInlierRatio(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr, const std::vector<cv::DMatch> &matches);
+void updateFeatureSelector(const FeatureSelectorPolicy &policy, FeatureSelectorState &state, const FeatureSignals &signals, int frameIndex);
+
+#endif /* featureSelector_hpp */
@@ -0,0 +1,369 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <opencv2/imgcodecs.hpp>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "frameReader.hpp"
+#include "lidarData.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+FrameReader::FrameReader(const std::vector<FrameFiles> &files_, int readaheadDepth, bool bUseIoUring, size_t bufferCapacity)
+    : files(files_), slots(max(1, readaheadDepth))
+{
+    // preallocate page-aligned buffers for all files within the readahead window
+    bufferCapacity = (bufferCapacity + 4095) & ~(size_t)4095;
+    for (auto &slot : slots)
+    {
+        for (auto &buffer : slot.buffers)
+        {
+            void *mem = nullptr;
+            if (posix_memalign(&mem, 4096, bufferCapacity) == 0)
+            {
+                buffer.fixedData = (char *)mem;
+                buffer.capacity = bufferCapacity;
+            }
+        }
+    }
+
+#ifdef HAVE_LIBURING
+    if (bUseIoUring)
+    {
+        io_uring *uring = new io_uring;
+        if (io_uring_queue_init(4 * slots.size(), uring, 0) == 0)
+        {
+            // register all buffers once, so the kernel does not have to map them for every read
+            vector<iovec> iovecs;
+            for (auto &slot : slots)
+            {
+                for (auto &buffer : slot.buffers)
+                {
+                    iovecs.push_back({buffer.fixedData, buffer.capacity});
+                }
+            }
+            if (io_uring_register_buffers(uring, iovecs.data(), iovecs.size()) == 0)
+            {
+                ring = uring;
+                bIoUring = true;
+            }
+            else
+            {
+                io_uring_queue_exit(uring);
+            }
+        }
+        if (!bIoUring)
+        {
+            delete uring;
+            LOG_WARN("io_uring unavailable, falling back to thread pool");
+        }
+    }
+#endif
+
+    if (!bIoUring)
+    {
+        int nWorkers = min<int>(2 * slots.size(), 8);
+        for (int i = 0; i < nWorkers; ++i)
+        {
+            workers.emplace_back(&FrameReader::workerLoop, this);
+        }
+    }
+
+    // fill the readahead window
+    while (nextToSubmit < files.size() && nextToSubmit < slots.size())
+    {
+        submitFrame(nextToSubmit++);
+    }
+#ifdef HAVE_LIBURING
+    if (bIoUring)
+    {
+        io_uring_submit((io_uring *)ring);
+    }
+#endif
+}
+
+FrameReader::~FrameReader()
+{
+    for (auto &slot : slots)
+    {
+        waitForSlot(slot);
+        closeSlot(slot);
+    }
+
+    {
+        lock_guard<mutex> lock(mtx);
+        bStop = true;
+    }
+    jobCond.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+#ifdef HAVE_LIBURING
+    if (bIoUring)
+    {
+        io_uring_queue_exit((io_uring *)ring);
+        delete (io_uring *)ring;
+    }
+#endif
+
+    for (auto &slot : slots)
+    {
+        for (auto &buffer : slot.buffers)
+        {
+            free(buffer.fixedData);
+        }
+    }
+}
+
+std::string FrameReader::backendName() const
+{
+    return bIoUring ? "io_uring" : "thread pool";
+}
+
+// open a file, hint the kernel about the access pattern and select the buffer to read into
+bool FrameReader::openBuffer(ReadBuffer &buffer, const std::string &filename)
+{
+    buffer.size = buffer.done = 0;
+    buffer.data = nullptr;
+    buffer.fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (buffer.fd < 0 || fstat(buffer.fd, &st) != 0 || st.st_size == 0)
+    {
+        LOG_ERROR("Cannot read " << filename);
+        return false;
+    }
+
+    buffer.size = st.st_size;
+    posix_fadvise(buffer.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(buffer.fd, 0, 0, POSIX_FADV_WILLNEED);
+
+    buffer.data = buffer.size <= buffer.capacity ? buffer.fixedData : (char *)malloc(buffer.size);
+    return buffer.data != nullptr;
+}
+
+void FrameReader::closeSlot(ReadSlot &slot)
+{
+    for (auto &buffer : slot.buffers)
+    {
+        if (buffer.fd >= 0)
+        {
+            // each frame is read once, so release its pages instead of evicting data of upcoming frames
+            posix_fadvise(buffer.fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(buffer.fd);
+            buffer.fd = -1;
+        }
+        if (buffer.data != nullptr && buffer.data != buffer.fixedData)
+        {
+            free(buffer.data);
+        }
+        buffer.data = nullptr;
+    }
+    slot.frameIdx = -1;
+}
+
+// queue the (remaining) read of one file of a slot
+void FrameReader::submitRead(int slotIdx, int which)
+{
+    ReadSlot &slot = slots[slotIdx];
+
+#ifdef HAVE_LIBURING
+    if (bIoUring)
+    {
+        ReadBuffer &buffer = slot.buffers[which];
+        io_uring *uring = (io_uring *)ring;
+        io_uring_sqe *sqe = io_uring_get_sqe(uring);
+        if (sqe == nullptr)
+        { // submission queue full, hand over what we have and retry
+            io_uring_submit(uring);
+            sqe = io_uring_get_sqe(uring);
+        }
+        if (buffer.data == buffer.fixedData)
+        {
+            io_uring_prep_read_fixed(sqe, buffer.fd, buffer.data + buffer.done, buffer.size - buffer.done, buffer.done, 2 * slotIdx + which);
+        }
+        else
+        {
+            io_uring_prep_read(sqe, buffer.fd, buffer.data + buffer.done, buffer.size - buffer.done, buffer.done);
+        }
+        io_uring_sqe_set_data(sqe, (void *)(intptr_t)(2 * slotIdx + which));
+        return;
+    }
+#endif
+
+    {
+        lock_guard<mutex> lock(mtx);
+        jobs.emplace_back(&slot, which);
+    }
+    jobCond.notify_one();
+}
+
+void FrameReader::submitFrame(size_t frameIdx)
+{
+    int slotIdx = frameIdx % slots.size();
+    ReadSlot &slot = slots[slotIdx];
+    slot.frameIdx = frameIdx;
+    slot.bFailed = false;
+
+    const string *filenames[2] = {&files[frameIdx].imgFile, &files[frameIdx].lidarFile};
+    int nOpen = 0;
+    bool bOpen[2];
+    for (int which = 0; which < 2; ++which)
+    {
+        bOpen[which] = openBuffer(slot.buffers[which], *filenames[which]);
+        slot.bFailed |= !bOpen[which];
+        nOpen += bOpen[which];
+    }
+
+    {
+        lock_guard<mutex> lock(mtx);
+        slot.pending = nOpen;
+    }
+    for (int which = 0; which < 2; ++which)
+    {
+        if (bOpen[which])
+        {
+            submitRead(slotIdx, which);
+        }
+    }
+}
+
+void FrameReader::waitForSlot(ReadSlot &slot)
+{
+#ifdef HAVE_LIBURING
+    if (bIoUring)
+    {
+        io_uring *uring = (io_uring *)ring;
+        while (slot.pending > 0)
+        {
+            io_uring_cqe *cqe;
+            if (io_uring_wait_cqe(uring, &cqe) != 0)
+            {
+                break;
+            }
+            int id = (int)(intptr_t)io_uring_cqe_get_data(cqe);
+            int res = cqe->res;
+            io_uring_cqe_seen(uring, cqe);
+
+            // completions may belong to any slot of the window
+            ReadSlot &done = slots[id / 2];
+            ReadBuffer &buffer = done.buffers[id % 2];
+            if (res > 0)
+            {
+                buffer.done += res;
+            }
+            if (res > 0 && buffer.done < buffer.size)
+            { // short read, continue where it stopped
+                submitRead(id / 2, id % 2);
+                io_uring_submit(uring);
+                continue;
+            }
+            done.bFailed |= buffer.done < buffer.size;
+            --done.pending;
+        }
+        return;
+    }
+#endif
+
+    unique_lock<mutex> lock(mtx);
+    doneCond.wait(lock, [&slot]() { return slot.pending == 0; });
+}
+
+void FrameReader::workerLoop()
+{
+    while (true)
+    {
+        pair<ReadSlot *, int> job;
+        {
+            unique_lock<mutex> lock(mtx);
+            jobCond.wait(lock, [this]() { return bStop || !jobs.empty(); });
+            if (jobs.empty())
+            {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        ReadBuffer &buffer = job.first->buffers[job.second];
+        while (buffer.done < buffer.size)
+        {
+            ssize_t res = pread(buffer.fd, buffer.data + buffer.done, buffer.size - buffer.done, buffer.done);
+            if (res <= 0)
+            {
+                break;
+            }
+            buffer.done += res;
+        }
+
+        {
+            lock_guard<mutex> lock(mtx);
+            job.first->bFailed |= buffer.done < buffer.size;
+            --job.first->pending;
+        }
+        doneCond.notify_all();
+    }
+}
+
+// Wait for the given frame, decode image and Lidar scan from the read buffers and refill the readahead window
+bool FrameReader::readFrame(size_t frameIdx, cv::Mat &img, std::vector<LidarPoint> &lidarPoints)
+{
+    if (frameIdx >= files.size())
+    {
+        return false;
+    }
+
+    ReadSlot &slot = slots[frameIdx % slots.size()];
+    if (slot.frameIdx != (long)frameIdx)
+    { // frame is outside the window (non-sequential access), restart readahead from here
+        for (auto &s : slots)
+        {
+            waitForSlot(s);
+            closeSlot(s);
+        }
+        nextToSubmit = frameIdx;
+        while (nextToSubmit < files.size() && nextToSubmit < frameIdx + slots.size())
+        {
+            submitFrame(nextToSubmit++);
+        }
+#ifdef HAVE_LIBURING
+        if (bIoUring)
+        {
+            io_uring_submit((io_uring *)ring);
+        }
+#endif
+    }
+
+    waitForSlot(slot);
+    bool bSuccess = !slot.bFailed;
+    if (bSuccess)
+    {
+        ReadBuffer &imgBuffer = slot.buffers[0], &lidarBuffer = slot.buffers[1];
+        img = cv::imdecode(cv::Mat(1, (int)imgBuffer.size, CV_8U, imgBuffer.data), cv::IMREAD_COLOR);
+        loadLidarFromBuffer(lidarPoints, lidarBuffer.data, lidarBuffer.size);
+    }
+    closeSlot(slot);
+
+    // the freed slot receives the next frame beyond the window
+    while (nextToSubmit < files.size() && nextToSubmit <= frameIdx + slots.size())
+    {
+        submitFrame(nextToSubmit++);
+    }
+#ifdef HAVE_LIBURING
+    if (bIoUring)
+    {
+        io_uring_submit((io_uring *)ring);
+    }
+#endif
+    return bSuccess && !img.empty();
+}
@@ -0,0 +1,72 @@
+
+#ifndef frameReader_hpp
+#define frameReader_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+struct FrameFiles { // files which make up one sensor frame
+    std::string imgFile;
+    std::string lidarFile;
+};
+
+struct ReadBuffer { // page-aligned buffer receiving the contents of one file
+    char *fixedData = nullptr; // preallocated (and registered) buffer
+    size_t capacity = 0;
+    char *data = nullptr;      // fixedData, or a temporary buffer for files exceeding the capacity
+    size_t size = 0;           // file size
+    size_t done = 0;           // no. of bytes read so far
+    int fd = -1;
+};
+
+struct ReadSlot { // buffers of one frame within the readahead window
+    long frameIdx = -1;
+    int pending = 0;       // no. of files still being read
+    bool bFailed = false;
+    ReadBuffer buffers[2]; // image and Lidar scan
+};
+
+// Reads upcoming frames ahead of time in batches, using io_uring with registered buffers when available
+// and a pool of pread() threads otherwise. Images and scans are decoded directly from the read buffers.
+class FrameReader
+{
+public:
+    FrameReader(const std::vector<FrameFiles> &files, int readaheadDepth=4, bool bUseIoUring=true, size_t bufferCapacity=4 << 20);
+    ~FrameReader();
+
+    bool readFrame(size_t frameIdx, cv::Mat &img, std::vector<LidarPoint> &lidarPoints);
+    std::string backendName() const;
+
+private:
+    void submitFrame(size_t frameIdx);
+    void submitRead(int slotIdx, int which);
+    void waitForSlot(ReadSlot &slot);
+    bool openBuffer(ReadBuffer &buffer, const std::string &filename);
+    void closeSlot(ReadSlot &slot);
+    void workerLoop();
+
+    std::vector<FrameFiles> files;
+    std::vector<ReadSlot> slots;
+    size_t nextToSubmit = 0;
+
+    // io_uring backend
+    bool bIoUring = false;
+    void *ring = nullptr;
+
+    // thread-pool backend
+    std::vector<std::thread> workers;
+    std::deque<std::pair<ReadSlot *, int>> jobs;
+    std::mutex mtx;
+    std::condition_variable jobCond, doneCond;
+    bool bStop = false;
+};
+
+#endif /* frameReader_hpp */
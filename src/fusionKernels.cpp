@@ -0,0 +1,195 @@
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "fusionKernels.hpp"
+#include "simdDispatch.hpp"
+
+using namespace std;
+
+// dispatch to the float or double variant of the selected SIMD kernels
+static void simdProjectPoints(const float *xyzr, size_t n, const float *P, float *uv) { simdKernels().projectPointsF(xyzr, n, P, uv); }
+static void simdProjectPoints(const double *xyzr, size_t n, const double *P, double *uv) { simdKernels().projectPointsD(xyzr, n, P, uv); }
+static void simdCropMask(const float *xyzr, size_t n, const float *limits, uint8_t *keep) { simdKernels().cropMaskF(xyzr, n, limits, keep); }
+static void simdCropMask(const double *xyzr, size_t n, const double *limits, uint8_t *keep) { simdKernels().cropMaskD(xyzr, n, limits, keep); }
+static void simdDistanceRatios(const float *outer, const float *prevX, const float *prevY, const float *currX, const float *currY, size_t n, float minDist, float eps, float *ratios)
+{
+    simdKernels().distanceRatiosF(outer, prevX, prevY, currX, currY, n, minDist, eps, ratios);
+}
+static void simdDistanceRatios(const double *outer, const double *prevX, const double *prevY, const double *currX, const double *currY, size_t n, double minDist, double eps, double *ratios)
+{
+    simdKernels().distanceRatiosD(outer, prevX, prevY, currX, currY, n, minDist, eps, ratios);
+}
+
+template <typename T>
+static T medianOfSorted(const vector<T> &values)
+{
+    size_t medIdx = values.size() / 2;
+    return values.size() % 2 == 0 ? (values[medIdx - 1] + values[medIdx]) / T(2) : values[medIdx];
+}
+
+// P_rect_xx * R_rect_xx * RT, multiplied once per frame in double and converted to the kernel precision
+template <typename T>
+cv::Matx<T, 3, 4> combineProjection(const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT)
+{
+    cv::Mat projection = P_rect_xx * R_rect_xx * RT;
+    cv::Matx<T, 3, 4> result;
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            result(r, c) = (T)projection.at<double>(r, c);
+        }
+    }
+    return result;
+}
+
+template <typename T>
+void cropLidarPointsT(vector<LidarPointT<T>> &lidarPoints, T minX, T maxX, T maxY, T minZ, T maxZ, T minR)
+{
+    static_assert(sizeof(LidarPointT<T>) == 4 * sizeof(T), "kernels read points as x, y, z, r arrays");
+    const T limits[6] = {minX, maxX, maxY, minZ, maxZ, minR};
+    vector<uint8_t> keep(lidarPoints.size());
+    simdCropMask((const T *)lidarPoints.data(), lidarPoints.size(), limits, keep.data());
+
+    vector<LidarPointT<T>> newLidarPts;
+    newLidarPts.reserve(lidarPoints.size());
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
+    {
+        if (keep[i])
+        {
+            newLidarPts.push_back(lidarPoints[i]);
+        }
+    }
+    lidarPoints = std::move(newLidarPts);
+}
+
+// pixel coordinates of all points, points behind the image plane get NAN coordinates
+template <typename T>
+void projectLidarPoints(const vector<LidarPointT<T>> &lidarPoints, const cv::Matx<T, 3, 4> &projection, vector<cv::Point_<T>> &imgPoints)
+{
+    static_assert(sizeof(cv::Point_<T>) == 2 * sizeof(T), "kernels write image points as u, v arrays");
+    imgPoints.resize(lidarPoints.size());
+    simdProjectPoints((const T *)lidarPoints.data(), lidarPoints.size(), projection.val, (T *)imgPoints.data());
+}
+
+// index of the single shrunk box enclosing each projected point, -1 for points in none or in several boxes
+template <typename T>
+void assignPointsToBoxes(const vector<cv::Point_<T>> &imgPoints, const vector<cv::Rect> &rois, T shrinkFactor, vector<int> &boxIndices)
+{
+    // shrink boxes slightly to avoid having too many outlier points around the edges;
+    // in double for both precisions, the truncated pixel edges would otherwise depend on the rounding of T
+    vector<cv::Rect> smallerBoxes(rois.size());
+    double shrink = shrinkFactor;
+    for (size_t b = 0; b < rois.size(); ++b)
+    {
+        smallerBoxes[b].x = rois[b].x + shrink * rois[b].width / 2.0;
+        smallerBoxes[b].y = rois[b].y + shrink * rois[b].height / 2.0;
+        smallerBoxes[b].width = rois[b].width * (1.0 - shrink);
+        smallerBoxes[b].height = rois[b].height * (1.0 - shrink);
+    }
+
+    boxIndices.assign(imgPoints.size(), -1);
+    for (size_t i = 0; i < imgPoints.size(); ++i)
+    {
+        if (std::isnan(imgPoints[i].x))
+        {
+            continue;
+        }
+        cv::Point pt((int)imgPoints[i].x, (int)imgPoints[i].y); // truncated to whole pixels as in the original clustering
+        int enclosing = -1;
+        for (size_t b = 0; b < smallerBoxes.size(); ++b)
+        {
+            if (smallerBoxes[b].contains(pt))
+            {
+                if (enclosing >= 0)
+                {
+                    enclosing = -1;
+                    break;
+                }
+                enclosing = b;
+            }
+        }
+        boxIndices[i] = enclosing;
+    }
+}
+
+// TTC from the median distance of the preceding vehicle, sorts both point sets by x
+template <typename T>
+T computeTTCLidarT(vector<LidarPointT<T>> &lidarPointsPrev, vector<LidarPointT<T>> &lidarPointsCurr, T frameRate)
+{
+    if (lidarPointsPrev.empty() || lidarPointsCurr.empty())
+    {
+        return numeric_limits<T>::quiet_NaN();
+    }
+    auto byX = [](const LidarPointT<T> &p1, const LidarPointT<T> &p2) { return p1.x < p2.x; };
+    sort(lidarPointsCurr.begin(), lidarPointsCurr.end(), byX);
+    sort(lidarPointsPrev.begin(), lidarPointsPrev.end(), byX);
+
+    size_t medCurrIdx = lidarPointsCurr.size() / 2;
+    size_t medPrevIdx = lidarPointsPrev.size() / 2;
+    T medCurrX = lidarPointsCurr.size() % 2 == 0 ? (lidarPointsCurr[medCurrIdx - 1].x + lidarPointsCurr[medCurrIdx].x) / T(2) : lidarPointsCurr[medCurrIdx].x;
+    T medPrevX = lidarPointsPrev.size() % 2 == 0 ? (lidarPointsPrev[medPrevIdx - 1].x + lidarPointsPrev[medPrevIdx].x) / T(2) : lidarPointsPrev[medPrevIdx].x;
+
+    T dT = T(1) / frameRate;
+    return dT * medCurrX / (medPrevX - medCurrX);
+}
+
+// TTC from the median ratio of keypoint distances between successive images
+template <typename T>
+T computeTTCCameraT(const vector<cv::KeyPoint> &kptsPrev, const vector<cv::KeyPoint> &kptsCurr, const vector<cv::DMatch> &kptMatches, T frameRate)
+{
+    if (kptMatches.size() < 2)
+    {
+        return numeric_limits<T>::quiet_NaN();
+    }
+
+    const T minDist = 100;
+
+    // matched keypoint coordinates as separate arrays, so the ratios of one outer match to all inner matches vectorize
+    size_t n = kptMatches.size();
+    vector<T> prevX(n), prevY(n), currX(n), currY(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const cv::Point2f &prev = kptsPrev[kptMatches[i].queryIdx].pt, &curr = kptsCurr[kptMatches[i].trainIdx].pt;
+        prevX[i] = prev.x;
+        prevY[i] = prev.y;
+        currX[i] = curr.x;
+        currY[i] = curr.y;
+    }
+
+    vector<T> distRatios, ratios(n - 1);
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        const T outer[4] = {prevX[i], prevY[i], currX[i], currY[i]};
+        simdDistanceRatios(outer, &prevX[1], &prevY[1], &currX[1], &currY[1], n - 1, minDist, numeric_limits<T>::epsilon(), ratios.data());
+        for (T ratio : ratios)
+        {
+            if (!std::isnan(ratio)) // invalid pairs are marked by NAN
+            {
+                distRatios.push_back(ratio);
+            }
+        }
+    }
+
+    if (distRatios.empty())
+    {
+        return numeric_limits<T>::quiet_NaN();
+    }
+    sort(distRatios.begin(), distRatios.end());
+    T medDistRatio = medianOfSorted(distRatios);
+    T dT = T(1) / frameRate;
+    return -dT / (T(1) - medDistRatio);
+}
+
+#define INSTANTIATE_FUSION_KERNELS(T) \
+    template cv::Matx<T, 3, 4> combineProjection<T>(const cv::Mat &, const cv::Mat &, const cv::Mat &); \
+    template void cropLidarPointsT<T>(vector<LidarPointT<T>> &, T, T, T, T, T, T); \
+    template void projectLidarPoints<T>(const vector<LidarPointT<T>> &, const cv::Matx<T, 3, 4> &, vector<cv::Point_<T>> &); \
+    template void assignPointsToBoxes<T>(const vector<cv::Point_<T>> &, const vector<cv::Rect> &, T, vector<int> &); \
+    template T computeTTCLidarT<T>(vector<LidarPointT<T>> &, vector<LidarPointT<T>> &, T); \
+    template T computeTTCCameraT<T>(const vector<cv::KeyPoint> &, const vector<cv::KeyPoint> &, const vector<cv::DMatch> &, T);
+
+INSTANTIATE_FUSION_KERNELS(float)
+INSTANTIATE_FUSION_KERNELS(double)
@@ -0,0 +1,32 @@
+
+#ifndef fusionKernels_hpp
+#define fusionKernels_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+// Geometry and TTC kernels templated on the scalar type of points and arithmetic.
+// Instantiated for float and double in fusionKernels.cpp; the pipeline uses the FusionScalar instantiation.
+
+template <typename T>
+cv::Matx<T, 3, 4> combineProjection(const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT);
+
+template <typename T>
+void cropLidarPointsT(std::vector<LidarPointT<T>> &lidarPoints, T minX, T maxX, T maxY, T minZ, T maxZ, T minR);
+
+template <typename T>
+void projectLidarPoints(const std::vector<LidarPointT<T>> &lidarPoints, const cv::Matx<T, 3, 4> &projection, std::vector<cv::Point_<T>> &imgPoints);
+
+template <typename T>
+void assignPointsToBoxes(const std::vector<cv::Point_<T>> &imgPoints, const std::vector<cv::Rect> &rois, T shrinkFactor, std::vector<int> &boxIndices);
+
+template <typename T>
+T computeTTCLidarT(std::vector<LidarPointT<T>> &lidarPointsPrev, std::vector<LidarPointT<T>> &lidarPointsCurr, T frameRate);
+
+template <typename T>
+T computeTTCCameraT(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr, const std::vector<cv::DMatch> &kptMatches, T frameRate);
+
+#endif /* fusionKernels_hpp */
@@ -0,0 +1,100 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "fusionPolicy.hpp"
+
+using namespace std;
+
+// interquartile range of the forward distance of a Lidar point cluster
+static double lidarSpread(const BoundingBox &bb)
+{
+    return sketchQuantile(bb.lidarSummary.xSketch, 0.75) - sketchQuantile(bb.lidarSummary.xSketch, 0.25);
+}
+
+// largest fraction of the box area covered by any other box
+static double occlusion(const BoundingBox &currBB, const std::vector<BoundingBox> &boundingBoxes)
+{
+    double maxCovered = 0.0;
+    for (auto &bb : boundingBoxes)
+    {
+        if (bb.boxID == currBB.boxID || currBB.roi.area() <= 0)
+        {
+            continue;
+        }
+        maxCovered = max(maxCovered, (double)(bb.roi & currBB.roi).area() / currBB.roi.area());
+    }
+    return maxCovered;
+}
+
+// decide whether camera TTC should be computed for the given object; Lidar TTC is always available for objects with Lidar points
+bool needCameraTTC(const FusionPolicy &policy, FusionState &state, BoundingBox &currBB, std::vector<BoundingBox> &boundingBoxes, std::string &reason)
+{
+    ++state.ttcRequests;
+    TrackFusionState &track = state.tracks[currBB.trackID];
+
+    reason.clear();
+    if (currBB.lidarSummary.count < policy.minLidarPoints)
+    {
+        reason = "few Lidar points";
+    }
+    else if (lidarSpread(currBB) > policy.maxLidarSpread)
+    {
+        reason = "high Lidar spread";
+    }
+    else if (occlusion(currBB, boundingBoxes) > policy.maxOcclusion)
+    {
+        reason = "occlusion";
+    }
+    else if (track.disagreed)
+    {
+        reason = "disagreement";
+    }
+    else if (policy.validationPeriod > 0 && track.framesSinceCamera + 1 >= policy.validationPeriod)
+    {
+        reason = "validation";
+    }
+
+    if (reason.empty())
+    {
+        return false;
+    }
+    ++state.cameraComputed;
+    ++state.reasons[reason];
+    return true;
+}
+
+// objects of a static frame reuse the keypoints of the previous frame, camera TTC is skipped for them without a policy decision
+void countStaticSkip(FusionState &state)
+{
+    ++state.ttcRequests;
+    ++state.staticSkipped;
+}
+
+// remember the outcome of the current frame for the next decision on this track
+void updateFusionState(const FusionPolicy &policy, FusionState &state, int trackID, double ttcLidar, double ttcCamera, bool bCameraComputed)
+{
+    TrackFusionState &track = state.tracks[trackID];
+    if (!bCameraComputed)
+    {
+        ++track.framesSinceCamera;
+        return;
+    }
+
+    track.framesSinceCamera = 0;
+    double relDiff = fabs(ttcLidar - ttcCamera) / max(fabs(ttcLidar), 1e-6);
+    track.disagreed = !std::isfinite(ttcCamera) || !std::isfinite(ttcLidar) || relDiff > policy.maxDisagreement;
+}
+
+void printFusionStats(const FusionState &state)
+{
+    int skipped = state.ttcRequests - state.cameraComputed;
+    cout << "Fusion policy : camera TTC computed for " << state.cameraComputed << " of " << state.ttcRequests << " objects, "
+         << skipped << " skipped (" << (state.ttcRequests > 0 ? 100.0 * skipped / state.ttcRequests : 0.0) << " % saved), "
+         << state.staticSkipped << " of them on static frames" << endl;
+    for (auto &reason : state.reasons)
+    {
+        cout << "  " << reason.first << " : " << reason.second << endl;
+    }
+}
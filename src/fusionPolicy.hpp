@@ -0,0 +1,39 @@
+
+#ifndef fusionPolicy_hpp
+#define fusionPolicy_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <string>
+
+#include "dataStructures.h"
+
+struct FusionPolicy { // decides when the expensive camera TTC is worth computing next to the Lidar TTC
+
+    int minLidarPoints = 30;         // fewer Lidar points on the object count as weak evidence
+    double maxLidarSpread = 0.25;    // interquartile range of the forward distance in [m] above which Lidar evidence is weak
+    double maxOcclusion = 0.25;      // fraction of the box covered by other boxes above which the object counts as occluded
+    double maxDisagreement = 0.3;    // relative difference between Lidar and camera TTC which counts as disagreement
+    int validationPeriod = 10;       // compute camera TTC at least every n frames per track for validation (0 = never)
+};
+
+struct TrackFusionState { // fusion history of a single track
+    bool disagreed = false;          // Lidar and camera TTC disagreed when both were last computed
+    int framesSinceCamera = 0;       // no. of frames since camera TTC was last computed
+};
+
+struct FusionState {
+    std::map<int, TrackFusionState> tracks; // fusion history per trackID
+    int ttcRequests = 0;                    // no. of objects for which a TTC has been requested
+    int cameraComputed = 0;                 // no. of camera TTC computations performed
+    int staticSkipped = 0;                  // no. of objects on static frames, skipped without a policy decision
+    std::map<std::string, int> reasons;     // no. of camera TTC computations per triggering reason
+};
+
+bool needCameraTTC(const FusionPolicy &policy, FusionState &state, BoundingBox &currBB, std::vector<BoundingBox> &boundingBoxes, std::string &reason);
+void countStaticSkip(FusionState &state);
+void updateFusionState(const FusionPolicy &policy, FusionState &state, int trackID, double ttcLidar, double ttcCamera, bool bCameraComputed);
+void printFusionStats(const FusionState &state);
+
+#endif /* fusionPolicy_hpp */
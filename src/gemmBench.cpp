@@ -0,0 +1,153 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "dataStructures.h"
+#include "matching2D.hpp"
+#include "gemmMatcher.hpp"
+#include "pipeline.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+struct MatcherComparison { // one descriptor pair matched by both matchers
+    string label;
+    int nSource = 0, nRef = 0;
+    double bfMs = 0.0, gemmMs = 0.0;
+    double agreement = 0.0;  // share of source descriptors with the same best match
+    double maxDistError = 0.0;
+};
+
+template <typename Kernel>
+static double measureMs(Kernel kernel, int repetitions)
+{
+    kernel(); // warm-up
+    double t = (double)cv::getTickCount();
+    for (int i = 0; i < repetitions; ++i)
+    {
+        kernel();
+    }
+    return 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency() / repetitions;
+}
+
+// time both matchers on one descriptor pair and count the source descriptors with the same best reference descriptor
+static MatcherComparison compareMatchers(const string &label, const cv::Mat &descSource, const cv::Mat &descRef, int nThreads, int repetitions)
+{
+    cv::Ptr<cv::DescriptorMatcher> matcher = cv::BFMatcher::create(cv::NORM_L2, false);
+    vector<vector<cv::DMatch>> bfMatches, gemmMatches;
+    double bfMs = measureMs([&]() {
+        bfMatches.clear();
+        matcher->knnMatch(descSource, descRef, bfMatches, 2);
+    }, repetitions);
+    double gemmMs = measureMs([&]() {
+        knnMatchGemm(descSource, descRef, gemmMatches, nThreads);
+    }, repetitions);
+
+    int agree = 0;
+    double maxDistError = 0.0;
+    for (size_t i = 0; i < bfMatches.size() && i < gemmMatches.size(); ++i)
+    {
+        if (!bfMatches[i].empty() && !gemmMatches[i].empty())
+        {
+            agree += bfMatches[i][0].trainIdx == gemmMatches[i][0].trainIdx;
+            maxDistError = max(maxDistError, (double)fabs(bfMatches[i][0].distance - gemmMatches[i][0].distance));
+        }
+    }
+
+    MatcherComparison comparison;
+    comparison.label = label;
+    comparison.nSource = descSource.rows;
+    comparison.nRef = descRef.rows;
+    comparison.bfMs = bfMs;
+    comparison.gemmMs = gemmMs;
+    comparison.agreement = (double)agree / max<size_t>(1, bfMatches.size());
+    comparison.maxDistError = maxDistError;
+
+    cout << "  " << left << setw(24) << label << right << fixed << setprecision(2)
+         << setw(10) << bfMs << " ms BF" << setw(10) << gemmMs << " ms GEMM" << setw(8) << bfMs / gemmMs << " x"
+         << setw(10) << setprecision(3) << 100.0 * comparison.agreement << " % same best match"
+         << ", max. distance error " << setprecision(4) << maxDistError << endl;
+    cout.unsetf(ios::fixed | ios::left);
+    return comparison;
+}
+
+/* GEMM MATCHER BENCHMARK: blocked distance-matrix kNN against cv::BFMatcher with NORM_L2 */
+// usage: gemm_bench [no. of threads, 0 = all cores] [no. of frames]
+int main(int argc, const char *argv[])
+{
+    string dataPath = "../";
+    PipelineConfig config = createDefaultConfig(dataPath);
+    setLogLevel(LOG_LEVEL_WARN);
+
+    int nThreads = argc > 1 ? stoi(argv[1]) : 0;
+    int nFrames = argc > 2 ? stoi(argv[2]) : 5;
+    int repetitions = 3;
+    vector<MatcherComparison> comparisons;
+
+    // SIFT descriptors of consecutive KITTI frames, the workload of MAT_GEMM in the pipeline
+    cout << "=== SIFT descriptors of recorded frames ===" << endl;
+    cv::Mat descPrev;
+    for (int frameIdx = 0; frameIdx < nFrames && frameIdx < (int)config.frameFiles.size(); ++frameIdx)
+    {
+        DataFrame frame;
+        loadFrame(config, frameIdx, frame);
+        cv::Mat imgGray;
+        cv::cvtColor(frame.cameraImg, imgGray, cv::COLOR_BGR2GRAY);
+
+        vector<cv::KeyPoint> keypoints;
+        cv::Mat descriptors;
+        double detTime, descTime;
+        detKeypointsModern(keypoints, imgGray, "SIFT", detTime);
+        descKeypoints(keypoints, imgGray, descriptors, descTime, "SIFT");
+        if (!descPrev.empty())
+        {
+            comparisons.push_back(compareMatchers("frame " + to_string(frameIdx - 1) + " -> " + to_string(frameIdx) + " (" + to_string(descriptors.rows) + ")",
+                                                  descriptors, descPrev, nThreads, repetitions));
+        }
+        descPrev = descriptors;
+    }
+
+    // random descriptors of SIFT width, covering dense detectors and larger images
+    cout << "=== random 128-d descriptors ===" << endl;
+    vector<int> sizes{500, 2000, 5000, 10000};
+    for (int n : sizes)
+    {
+        cv::Mat descSource(n, 128, CV_32F), descRef(n, 128, CV_32F);
+        cv::randu(descSource, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::randu(descRef, cv::Scalar::all(0), cv::Scalar::all(255));
+        comparisons.push_back(compareMatchers(to_string(n) + " x " + to_string(n), descSource, descRef, nThreads, n > 5000 ? 1 : repetitions));
+    }
+
+    // speedup over all descriptor pairs, every pair is kept in gemm_bench.csv to record the results of a machine
+    double logSpeedup = 0.0, minSpeedup = INFINITY, maxSpeedup = 0.0, minAgreement = 1.0;
+    ofstream csv("../gemm_bench.csv");
+    csv << "label,nSource,nRef,threads,BF_ms,GEMM_ms,speedup,sameBestMatch,maxDistError" << endl;
+    for (auto &c : comparisons)
+    {
+        double speedup = c.bfMs / c.gemmMs;
+        logSpeedup += log(speedup);
+        minSpeedup = min(minSpeedup, speedup);
+        maxSpeedup = max(maxSpeedup, speedup);
+        minAgreement = min(minAgreement, c.agreement);
+        csv << c.label << "," << c.nSource << "," << c.nRef << "," << nThreads << "," << c.bfMs << "," << c.gemmMs << "," << speedup << ","
+            << c.agreement << "," << c.maxDistError << endl;
+    }
+    if (!comparisons.empty())
+    {
+        cout << "=== GEMM against BF over " << comparisons.size() << " descriptor pairs ===" << endl << fixed << setprecision(2)
+             << "  speedup min " << minSpeedup << " x, geometric mean " << exp(logSpeedup / comparisons.size()) << " x, max " << maxSpeedup << " x"
+             << setprecision(3) << ", same best match for at least " << 100.0 * minAgreement << " %" << endl
+             << "  results written to ../gemm_bench.csv" << endl;
+    }
+
+    flushLog();
+    return 0;
+}
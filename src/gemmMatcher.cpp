@@ -0,0 +1,154 @@
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include "gemmMatcher.hpp"
+#include "simdDispatch.hpp"
+
+using namespace std;
+
+static const int BLOCK_REF = SIMD_GEMM_COLS; // reference descriptors per packed block, the accumulators of 4 rows stay in L1
+static const int BLOCK_SOURCE = 128;          // source descriptors per block, reused from L2 for all reference blocks
+static const int ROWS = SIMD_GEMM_ROWS;       // source rows sharing each load of a packed reference column
+
+struct TopTwo { // two smallest squared distances of a source descriptor so far
+    float dist[2] = {numeric_limits<float>::max(), numeric_limits<float>::max()};
+    int idx[2] = {-1, -1};
+
+    void add(float d, int j)
+    {
+        if (d < dist[1])
+        {
+            if (d < dist[0])
+            {
+                dist[1] = dist[0];
+                idx[1] = idx[0];
+                dist[0] = d;
+                idx[0] = j;
+            }
+            else
+            {
+                dist[1] = d;
+                idx[1] = j;
+            }
+        }
+    }
+};
+
+// reference descriptors transposed into blocks of BLOCK_REF columns, so the inner loop runs over contiguous columns
+static void packReference(const cv::Mat &descRef, vector<float> &packed, vector<float> &norms)
+{
+    int nRef = descRef.rows, dims = descRef.cols;
+    int nBlocks = (nRef + BLOCK_REF - 1) / BLOCK_REF;
+    packed.assign((size_t)nBlocks * dims * BLOCK_REF, 0.0f);
+    norms.assign(nRef, 0.0f);
+    for (int j = 0; j < nRef; ++j)
+    {
+        const float *row = descRef.ptr<float>(j);
+        float *block = &packed[(size_t)(j / BLOCK_REF) * dims * BLOCK_REF];
+        float norm = 0.0f;
+        for (int d = 0; d < dims; ++d)
+        {
+            block[d * BLOCK_REF + j % BLOCK_REF] = row[d];
+            norm += row[d] * row[d];
+        }
+        norms[j] = norm;
+    }
+}
+
+// distances of source rows [begin, end) to all reference descriptors, keeping the two nearest per row
+static void matchRows(const cv::Mat &descSource, const vector<float> &packed, const vector<float> &refNorms, int begin, int end, vector<TopTwo> &best)
+{
+    vector<float> sourceNorms(end - begin, 0.0f);
+    for (int i = begin; i < end; ++i)
+    {
+        const float *row = descSource.ptr<float>(i);
+        for (int d = 0; d < descSource.cols; ++d)
+        {
+            sourceNorms[i - begin] += row[d] * row[d];
+        }
+    }
+
+    int nRef = refNorms.size(), dims = descSource.cols;
+    int nBlocks = (nRef + BLOCK_REF - 1) / BLOCK_REF;
+    float acc[ROWS][BLOCK_REF];
+    const SimdKernels &kernels = simdKernels();
+
+    for (int ib = begin; ib < end; ib += BLOCK_SOURCE)
+    {
+        int ibEnd = min(ib + BLOCK_SOURCE, end);
+        for (int jb = 0; jb < nBlocks; ++jb)
+        {
+            const float *block = &packed[(size_t)jb * dims * BLOCK_REF];
+            int nCols = min(BLOCK_REF, nRef - jb * BLOCK_REF);
+
+            for (int i = ib; i < ibEnd; i += ROWS)
+            {
+                int nRows = min(ROWS, ibEnd - i);
+                const float *a[ROWS];
+                for (int r = 0; r < ROWS; ++r)
+                {
+                    a[r] = descSource.ptr<float>(i + min(r, nRows - 1)); // surplus rows repeat the last one and are ignored
+                }
+                kernels.gemmTile(a, block, dims, &acc[0][0]);
+
+                // epilogue: squared distances and top-2 selection while the block is in cache
+                for (int r = 0; r < nRows; ++r)
+                {
+                    float sourceNorm = sourceNorms[i + r - begin];
+                    TopTwo &top = best[i + r];
+                    for (int j = 0; j < nCols; ++j)
+                    {
+                        int refIdx = jb * BLOCK_REF + j;
+                        top.add(sourceNorm + refNorms[refIdx] - 2.0f * acc[r][j], refIdx);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void knnMatchGemm(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<std::vector<cv::DMatch>> &knnMatches, int nThreads)
+{
+    knnMatches.clear();
+    if (descSource.empty() || descRef.empty())
+    {
+        return;
+    }
+    CV_Assert(descSource.cols == descRef.cols);
+    cv::Mat source, reference;
+    descSource.convertTo(source, CV_32F);
+    descRef.convertTo(reference, CV_32F);
+
+    vector<float> packed, refNorms;
+    packReference(reference, packed, refNorms);
+
+    // source rows are split among the threads, every thread selects the neighbours of its own rows
+    vector<TopTwo> best(source.rows);
+    nThreads = nThreads > 0 ? nThreads : max(1, (int)thread::hardware_concurrency());
+    nThreads = max(1, min(nThreads, source.rows / BLOCK_SOURCE));
+    vector<thread> workers;
+    for (int t = 1; t < nThreads; ++t)
+    {
+        workers.emplace_back(matchRows, cref(source), cref(packed), cref(refNorms), source.rows * t / nThreads, source.rows * (t + 1) / nThreads, ref(best));
+    }
+    matchRows(source, packed, refNorms, 0, source.rows / nThreads, best);
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+
+    knnMatches.resize(source.rows);
+    for (int i = 0; i < source.rows; ++i)
+    {
+        for (int k = 0; k < 2; ++k)
+        {
+            if (best[i].idx[k] >= 0)
+            {
+                knnMatches[i].push_back(cv::DMatch(i, best[i].idx[k], sqrt(max(best[i].dist[k], 0.0f))));
+            }
+        }
+    }
+}
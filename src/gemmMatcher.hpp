@@ -0,0 +1,15 @@
+
+#ifndef gemmMatcher_hpp
+#define gemmMatcher_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Brute-force 2-nearest-neighbour L2 matching of float descriptors. Squared distances are expanded into
+// |a|^2 + |b|^2 - 2 a.b, the dot products are computed by a cache-blocked matrix product, and the two best
+// reference descriptors per source descriptor are selected while the product blocks are still in cache.
+// Results have the same layout as cv::DescriptorMatcher::knnMatch with k = 2 and NORM_L2.
+void knnMatchGemm(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<std::vector<cv::DMatch>> &knnMatches, int nThreads=0);
+
+#endif /* gemmMatcher_hpp */
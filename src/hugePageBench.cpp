@@ -0,0 +1,249 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "dataStructures.h"
+#include "camFusion.hpp"
+#include "pipeline.hpp"
+#include "matching2D.hpp"
+#include "bufferPool.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+// hardware counter of the calling thread, unavailable counters (e.g. in VMs or with perf_event_paranoid > 2) read as -1
+class PerfCounter
+{
+public:
+    PerfCounter(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~PerfCounter()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+    void start()
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    long long stop()
+    {
+        long long count = -1;
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count))
+            {
+                count = -1;
+            }
+        }
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+struct KernelStats {
+    long long dtlbMisses = -1;
+    long long dtlbLoads = -1;
+    double timeMs = 0.0;
+};
+
+template <typename Kernel>
+static KernelStats measure(Kernel kernel, int repetitions)
+{
+    PerfCounter misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    PerfCounter loads(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16));
+
+    kernel(); // warm-up, faults in all pages
+    KernelStats stats;
+    misses.start();
+    loads.start();
+    double t = (double)cv::getTickCount();
+    for (int i = 0; i < repetitions; ++i)
+    {
+        kernel();
+    }
+    stats.timeMs = 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency() / repetitions;
+    stats.dtlbLoads = loads.stop();
+    stats.dtlbMisses = misses.stop();
+    return stats;
+}
+
+static void printStats(const string &kernel, const KernelStats &stats, int repetitions)
+{
+    cout << "  " << left << setw(12) << kernel << right << fixed << setprecision(2) << setw(10) << stats.timeMs << " ms";
+    if (stats.dtlbMisses >= 0)
+    {
+        cout << setw(14) << stats.dtlbMisses / repetitions << " dTLB misses";
+        if (stats.dtlbLoads > 0)
+        {
+            cout << " (" << setprecision(4) << 100.0 * stats.dtlbMisses / stats.dtlbLoads << " % of loads)";
+        }
+    }
+    else
+    {
+        cout << "  dTLB counters unavailable";
+    }
+    cout << endl;
+    cout.unsetf(ios::fixed | ios::left);
+}
+
+// dTLB misses of a huge page mode relative to regular pages
+static void printReduction(const string &kernel, const KernelStats &stats, const KernelStats &reference)
+{
+    cout << "  " << left << setw(12) << kernel << right;
+    if (stats.dtlbMisses >= 0 && reference.dtlbMisses > 0)
+    {
+        cout << fixed << setprecision(1) << setw(8) << 100.0 * (1.0 - (double)stats.dtlbMisses / reference.dtlbMisses) << " % fewer dTLB misses, "
+             << setprecision(2) << setw(6) << reference.timeMs / stats.timeMs << " x speed";
+    }
+    else
+    {
+        cout << "  dTLB counters unavailable, " << fixed << setprecision(2) << reference.timeMs / stats.timeMs << " x speed";
+    }
+    cout << endl;
+    cout.unsetf(ios::fixed | ios::left);
+}
+
+static void printPages(const string &buffer, const void *data)
+{
+    PageReport report;
+    if (queryPageReport(data, report))
+    {
+        cout << "  " << left << setw(12) << buffer << right << " page size " << (report.kernelPageSize >> 10) << " KB, "
+             << (report.anonHugeBytes >> 20) << " of " << (report.mappingSize >> 20) << " MB in transparent huge pages" << endl;
+    }
+}
+
+/* HUGE PAGE BENCHMARK: dTLB misses of the Lidar projection and descriptor matching kernels per page mode */
+// usage: hugepage_bench [cloud replication factor, 1 = recorded scan]
+int main(int argc, const char *argv[])
+{
+    string dataPath = "../";
+    PipelineConfig config = createDefaultConfig(dataPath);
+    setLogLevel(LOG_LEVEL_WARN);
+
+    int replication = argc > 1 ? stoi(argv[1]) : 1; // e.g. 4 x 64 beams ~ a 128-beam scan at twice the density
+    int repetitions = 5;
+
+    DataFrame recorded, next;
+    loadFrame(config, 0, recorded);
+    loadFrame(config, 1, next);
+
+    // object boxes covering the image in a grid, so every point is projected and tested against several boxes
+    vector<BoundingBox> gridBoxes;
+    for (int y = 0; y + 100 <= recorded.cameraImg.rows; y += 50)
+    {
+        for (int x = 0; x + 200 <= recorded.cameraImg.cols; x += 100)
+        {
+            BoundingBox bBox;
+            bBox.boxID = gridBoxes.size();
+            bBox.roi = cv::Rect(x, y, 200, 100);
+            gridBoxes.push_back(bBox);
+        }
+    }
+
+    vector<HugePageMode> modes{HUGE_PAGES_OFF, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_EXPLICIT};
+    vector<KernelStats> projectionStats, matchingStats;
+    for (HugePageMode mode : modes)
+    {
+        HugePageBufferPool *pool = enableHugePageMats(mode);
+        cout << "=== huge pages " << hugePageModeName(mode) << " ===" << endl;
+
+        // point cloud, replicated with jitter to the size of a high-resolution scan
+        mt19937 rng(1);
+        normal_distribution<double> jitter(0.0, 0.02);
+        vector<LidarPoint> cloud;
+        size_t nPoints = recorded.lidarPoints.size() * replication;
+        cloud.reserve(nPoints);
+        adviseHugePages(cloud.data(), nPoints * sizeof(LidarPoint));
+        for (int r = 0; r < replication; ++r)
+        {
+            for (auto pt : recorded.lidarPoints)
+            {
+                pt.x += jitter(rng);
+                pt.y += jitter(rng);
+                cloud.push_back(pt);
+            }
+        }
+
+        // descriptors of two consecutive recorded frames with the configured detector and descriptor, allocated through
+        // the matrix allocator of this mode (matrices below its minimum size stay on the heap)
+        vector<cv::KeyPoint> kptsSource, kptsRef;
+        cv::Mat descSource, descRef;
+        double descTime;
+        detectFrameKeypoints(config, next.cameraImg, kptsSource);
+        detectFrameKeypoints(config, recorded.cameraImg, kptsRef);
+        descKeypoints(kptsSource, next.cameraImg, descSource, descTime, config.descriptorType);
+        descKeypoints(kptsRef, recorded.cameraImg, descRef, descTime, config.descriptorType);
+        int normType = config.descriptorType.compare("SIFT") == 0 ? cv::NORM_L2 : cv::NORM_HAMMING;
+
+        cv::Mat P_rect_00 = config.P_rect_00, R_rect_00 = config.R_rect_00, RT = config.RT;
+        KernelStats projection = measure([&]() {
+            vector<BoundingBox> boxes = gridBoxes;
+            clusterLidarWithROI(boxes, cloud, config.shrinkFactor, P_rect_00, R_rect_00, RT);
+        }, repetitions);
+
+        cv::Ptr<cv::DescriptorMatcher> matcher = cv::BFMatcher::create(normType, false);
+        KernelStats matching = measure([&]() {
+            vector<vector<cv::DMatch>> knnMatches;
+            matcher->knnMatch(descSource, descRef, knnMatches, 2);
+        }, repetitions);
+
+        printPages("cloud", cloud.data());
+        printPages("descriptors", descSource.data);
+        cout << "  " << descSource.rows << " x " << descRef.rows << " " << config.descriptorType << " descriptors, "
+             << (descSource.total() * descSource.elemSize() >> 10) << " KB per frame" << endl;
+        printStats("projection", projection, repetitions);
+        printStats("matching", matching, repetitions);
+        projectionStats.push_back(projection);
+        matchingStats.push_back(matching);
+        if (pool != nullptr)
+        {
+            cout << "  ";
+            pool->printReport();
+            pool->trim();
+        }
+    }
+
+    // modes[0] runs on regular 4 KB pages
+    for (size_t m = 1; m < modes.size(); ++m)
+    {
+        cout << "=== huge pages " << hugePageModeName(modes[m]) << " against 4 KB pages ===" << endl;
+        printReduction("projection", projectionStats[m], projectionStats[0]);
+        printReduction("matching", matchingStats[m], matchingStats[0]);
+    }
+
+    enableHugePageMats(HUGE_PAGES_OFF);
+    flushLog();
+    return 0;
+}
@@ -0,0 +1,93 @@
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "latencyHistogram.hpp"
+
+using namespace std;
+
+static const int SUB_BUCKET_BITS = 11;                          // 2048 sub-buckets, 3 significant digits
+static const uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+static const uint64_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+static const int MAX_SHIFT = 26;                                // trackable up to ~19 h
+static const int BUCKET_COUNT = SUB_BUCKETS + MAX_SHIFT * HALF_SUB_BUCKETS;
+
+LatencyHistogram::LatencyHistogram() : counts(BUCKET_COUNT, 0)
+{
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return (int)value;
+    }
+    // shift the value into [HALF_SUB_BUCKETS, SUB_BUCKETS)
+    int msb = 63 - __builtin_clzll(value);
+    int shift = std::min(msb - (SUB_BUCKET_BITS - 1), MAX_SHIFT);
+    uint64_t sub = std::min<uint64_t>(value >> shift, SUB_BUCKETS - 1);
+    return (int)(SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS + (sub - HALF_SUB_BUCKETS));
+}
+
+uint64_t LatencyHistogram::bucketHighest(int index)
+{
+    if (index < (int)SUB_BUCKETS)
+    {
+        return index;
+    }
+    int shift = (index - SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+    uint64_t sub = (index - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t valueUs)
+{
+    ++counts[bucketIndex(valueUs)];
+    minValue = totalCount == 0 ? valueUs : std::min(minValue, valueUs);
+    maxValue = std::max(maxValue, valueUs);
+    sum += valueUs;
+    ++totalCount;
+}
+
+void LatencyHistogram::reset()
+{
+    fill(counts.begin(), counts.end(), 0);
+    totalCount = minValue = maxValue = 0;
+    sum = 0.0;
+}
+
+double LatencyHistogram::mean() const
+{
+    return totalCount > 0 ? sum / totalCount : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (totalCount == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p / 100.0 * totalCount + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            return std::min(bucketHighest(i), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+void LatencyHistogram::print(const std::string &title) const
+{
+    cout << title << " (" << totalCount << " samples, ms)" << endl;
+    cout << fixed << setprecision(2)
+         << "  min " << min() / 1000.0 << "  mean " << mean() / 1000.0
+         << "  p50 " << percentile(50) / 1000.0 << "  p90 " << percentile(90) / 1000.0
+         << "  p99 " << percentile(99) / 1000.0 << "  p99.9 " << percentile(99.9) / 1000.0
+         << "  max " << max() / 1000.0 << endl;
+    cout.unsetf(ios::fixed);
+}
@@ -0,0 +1,37 @@
+
+#ifndef latencyHistogram_hpp
+#define latencyHistogram_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// HDR-style histogram of latencies in microseconds: exact below 2048 us, above that log-linear buckets
+// with a relative error of at most 0.1 %. Recording is O(1) and the memory use is independent of the sample count.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(uint64_t valueUs);
+    void reset();
+
+    uint64_t count() const { return totalCount; }
+    uint64_t min() const { return totalCount > 0 ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const;
+    uint64_t percentile(double p) const; // p in [0, 100], highest value equivalent to the bucket containing the percentile
+
+    void print(const std::string &title) const;
+
+private:
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketHighest(int index);
+
+    std::vector<uint64_t> counts;
+    uint64_t totalCount = 0, minValue = 0, maxValue = 0;
+    double sum = 0.0;
+};
+
+#endif /* latencyHistogram_hpp */
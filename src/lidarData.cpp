@@ -4,6 +4,8 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "lidarData.hpp"
+#include "bufferPool.hpp"
+#include "fusionKernels.hpp"
 
 
 using namespace std;
@@ -11,20 +13,9 @@ using namespace std;
 // remove Lidar points based on min. and max distance in X, Y and Z
 void cropLidarPoints(std::vector<LidarPoint> &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR)
 {
-    std::vector<LidarPoint> newLidarPts; 
-    for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it) {
-        
-       if( (*it).x>=minX && (*it).x<=maxX && (*it).z>=minZ && (*it).z<=maxZ && (*it).z<=0.0 && abs((*it).y)<=maxY && (*it).r>=minR )  // Check if Lidar point is outside of boundaries
-       {
-           newLidarPts.push_back(*it);
-       }
-    }
-
-    lidarPoints = std::move(newLidarPts);
+    cropLidarPointsT<FusionScalar>(lidarPoints, minX, maxX, maxY, minZ, maxZ, minR);
 }
 
-
-
 // Load Lidar points from a given location and store them in a vector
 void loadLidarFromFile(vector<LidarPoint> &lidarPoints, string filename)
 {
@@ -42,16 +33,33 @@ void loadLidarFromFile(vector<LidarPoint> &lidarPoints, string filename)
     FILE *stream;
     stream = fopen (filename.c_str(),"rb");
     num = fread(data,sizeof(float),num,stream)/4;
+    lidarPoints.reserve(lidarPoints.size() + num);
+    adviseHugePages(lidarPoints.data(), lidarPoints.capacity() * sizeof(LidarPoint)); // before the pages are touched
  
-    for (int32_t i=0; i<num; i++) {
+    for (size_t i=0; i<num; i++) {
         LidarPoint lpt;
         lpt.x = *px; lpt.y = *py; lpt.z = *pz; lpt.r = *pr;
         lidarPoints.push_back(lpt);
         px+=4; py+=4; pz+=4; pr+=4;
     }
     fclose(stream);
+    free(data);
 }
 
+// Parse Lidar points from a raw scan already held in memory (same layout as the files read by loadLidarFromFile)
+void loadLidarFromBuffer(std::vector<LidarPoint> &lidarPoints, const char *data, size_t size)
+{
+    const float *values = (const float *)data;
+    size_t num = size / (4 * sizeof(float));
+    lidarPoints.reserve(lidarPoints.size() + num);
+    adviseHugePages(lidarPoints.data(), lidarPoints.capacity() * sizeof(LidarPoint)); // before the pages are touched
+
+    for (size_t i = 0; i < num; i++, values += 4) {
+        LidarPoint lpt;
+        lpt.x = values[0]; lpt.y = values[1]; lpt.z = values[2]; lpt.r = values[3];
+        lidarPoints.push_back(lpt);
+    }
+}
 
 void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait)
 {
@@ -73,7 +81,7 @@ void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize,
     // plot distance markers
     float lineSpacing = 2.0; // gap between distance markers
     int nMarkers = floor(worldSize.height / lineSpacing);
-    for (size_t i = 0; i < nMarkers; ++i)
+    for (int i = 0; i < nMarkers; ++i)
     {
         int y = (-(i * lineSpacing) * imageSize.height / worldSize.height) + imageSize.height;
         cv::line(topviewImg, cv::Point(0, y), cv::Point(imageSize.width, y), cv::Scalar(255, 0, 0));
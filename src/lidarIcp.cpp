@@ -0,0 +1,222 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "lidarIcp.hpp"
+
+using namespace std;
+
+static inline double coord(const LidarPoint &pt, int axis)
+{
+    return axis == 0 ? pt.x : (axis == 1 ? pt.y : pt.z);
+}
+
+static inline double sqDistance(const LidarPoint &pt1, const LidarPoint &pt2)
+{
+    double dx = pt1.x - pt2.x, dy = pt1.y - pt2.y, dz = pt1.z - pt2.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// (re-)build the tree from a point cloud, reusing the storage of previous builds
+void KdTree::build(const std::vector<LidarPoint> &cloud)
+{
+    points.assign(cloud.begin(), cloud.end());
+    axes.resize(points.size());
+    buildRange(0, (int)points.size(), 0);
+}
+
+void KdTree::buildRange(int lo, int hi, int depth)
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    int axis = depth % 3;
+    nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi,
+                [axis](const LidarPoint &pt1, const LidarPoint &pt2) { return coord(pt1, axis) < coord(pt2, axis); });
+    axes[mid] = axis;
+
+    buildRange(lo, mid, depth + 1);
+    buildRange(mid + 1, hi, depth + 1);
+}
+
+int KdTree::nearest(const LidarPoint &query, double maxDist, double &sqDist) const
+{
+    int best = -1;
+    sqDist = maxDist * maxDist;
+    nearestRange(0, (int)points.size(), query, best, sqDist);
+    return best;
+}
+
+void KdTree::nearestRange(int lo, int hi, const LidarPoint &query, int &best, double &bestSqDist) const
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    double d = sqDistance(points[mid], query);
+    if (d < bestSqDist)
+    {
+        bestSqDist = d;
+        best = mid;
+    }
+
+    // descend into the half containing the query first, visit the other half only if it can contain a closer point
+    double diff = coord(query, axes[mid]) - coord(points[mid], axes[mid]);
+    if (diff < 0)
+    {
+        nearestRange(lo, mid, query, best, bestSqDist);
+        if (diff * diff < bestSqDist)
+            nearestRange(mid + 1, hi, query, best, bestSqDist);
+    }
+    else
+    {
+        nearestRange(mid + 1, hi, query, best, bestSqDist);
+        if (diff * diff < bestSqDist)
+            nearestRange(lo, mid, query, best, bestSqDist);
+    }
+}
+
+static double medianX(const std::vector<LidarPoint> &points)
+{
+    vector<double> x;
+    x.reserve(points.size());
+    for (auto &pt : points)
+    {
+        x.push_back(pt.x);
+    }
+    auto med = x.begin() + x.size() / 2;
+    nth_element(x.begin(), med, x.end());
+    return *med;
+}
+
+// Point-to-point ICP which aligns the source points with the points indexed by the target tree, starting from a forward
+// translation initialTx. The motion model is a translation plus a rotation about the vertical axis, which is all a vehicle
+// can do between two scans. Returns false if the alignment did not converge or was based on fewer than minCorrespondences point pairs.
+bool alignLidarICP(std::vector<LidarPoint> &source, KdTree &targetTree, IcpResult &result, double initialTx, int maxIterations, double maxCorrDist,
+                   double minDelta, int minCorrespondences)
+{
+    result.tx = initialTx;
+    result.ty = result.tz = result.yaw = 0.0;
+    result.iterations = 0;
+    result.rmse = std::numeric_limits<double>::quiet_NaN();
+    result.correspondences = 0;
+    result.bConverged = result.bForwardConverged = false;
+
+    for (int iter = 0; iter < maxIterations; ++iter)
+    {
+        double c = cos(result.yaw), s = sin(result.yaw);
+
+        // find correspondences for all transformed source points and accumulate their centroids
+        vector<LidarPoint> srcPts, dstPts;
+        srcPts.reserve(source.size());
+        dstPts.reserve(source.size());
+        double sumSqDist = 0.0;
+        for (auto &pt : source)
+        {
+            LidarPoint moved = pt;
+            moved.x = c * pt.x - s * pt.y + result.tx;
+            moved.y = s * pt.x + c * pt.y + result.ty;
+            moved.z = pt.z + result.tz;
+
+            double sqDist;
+            int idx = targetTree.nearest(moved, maxCorrDist, sqDist);
+            if (idx >= 0)
+            {
+                srcPts.push_back(moved);
+                dstPts.push_back(targetTree.points[idx]);
+                sumSqDist += sqDist;
+            }
+        }
+        result.iterations = iter + 1;
+        result.correspondences = srcPts.size();
+        if (result.correspondences < max(minCorrespondences, 3))
+        {
+            break;
+        }
+        result.rmse = sqrt(sumSqDist / srcPts.size());
+
+        LidarPoint srcMean = {0, 0, 0, 0}, dstMean = {0, 0, 0, 0};
+        for (size_t i = 0; i < srcPts.size(); ++i)
+        {
+            srcMean.x += srcPts[i].x; srcMean.y += srcPts[i].y; srcMean.z += srcPts[i].z;
+            dstMean.x += dstPts[i].x; dstMean.y += dstPts[i].y; dstMean.z += dstPts[i].z;
+        }
+        double n = srcPts.size();
+        srcMean.x /= n; srcMean.y /= n; srcMean.z /= n;
+        dstMean.x /= n; dstMean.y /= n; dstMean.z /= n;
+
+        // closed-form incremental rotation about z from the centered cross-covariance
+        double sxx = 0.0, sxy = 0.0;
+        for (size_t i = 0; i < srcPts.size(); ++i)
+        {
+            double ax = srcPts[i].x - srcMean.x, ay = srcPts[i].y - srcMean.y;
+            double bx = dstPts[i].x - dstMean.x, by = dstPts[i].y - dstMean.y;
+            sxx += ax * bx + ay * by;
+            sxy += ax * by - ay * bx;
+        }
+        double dYaw = atan2(sxy, sxx);
+        double dc = cos(dYaw), ds = sin(dYaw);
+        double dtx = dstMean.x - (dc * srcMean.x - ds * srcMean.y);
+        double dty = dstMean.y - (ds * srcMean.x + dc * srcMean.y);
+        double dtz = dstMean.z - srcMean.z;
+
+        // compose the increment with the current estimate
+        double tx = dc * result.tx - ds * result.ty + dtx;
+        double ty = ds * result.tx + dc * result.ty + dty;
+        result.tx = tx;
+        result.ty = ty;
+        result.tz += dtz;
+        result.yaw += dYaw;
+
+        // the rear of an object fixes tx within a few iterations, while sliding along it (ty, yaw) converges slowly
+        result.bForwardConverged = fabs(dtx) < minDelta;
+
+        // stop early once the update becomes negligible
+        if (sqrt(dtx * dtx + dty * dty + dtz * dtz) < minDelta && fabs(dYaw) < minDelta)
+        {
+            result.bConverged = true;
+            break;
+        }
+    }
+    return result.bConverged;
+}
+
+// Compute time-to-collision (TTC) from the relative motion of a tracked object estimated by scan-to-scan ICP;
+// failed alignments, objects at constant distance and receding objects have no TTC (NAN)
+void computeTTCLidarICP(std::vector<LidarPoint> &lidarPointsPrev, std::vector<LidarPoint> &lidarPointsCurr, double frameRate,
+                        double &TTC, double &closingVelocity, KdTree &tree)
+{
+    const double minClosingVelocity = 0.01; // [m/s], slower approaches would give TTCs of many minutes
+
+    if (lidarPointsPrev.empty() || lidarPointsCurr.empty())
+    {
+        TTC = closingVelocity = NAN;
+        return;
+    }
+    tree.build(lidarPointsCurr);
+
+    // start from the shift of the median forward distance, otherwise closing speeds beyond maxCorrDist per frame
+    // (5 m/s at 10 Hz) leave no correspondences
+    double medPrevX = medianX(lidarPointsPrev), medCurrX = medianX(lidarPointsCurr);
+    IcpResult icp;
+    alignLidarICP(lidarPointsPrev, tree, icp, medCurrX - medPrevX);
+    bool bAligned = icp.bForwardConverged; // only the forward motion enters the TTC
+
+    // the object moves by (tx, ty) between frames, approaching objects have a negative tx
+    closingVelocity = bAligned ? -icp.tx * frameRate : NAN;
+    if (!bAligned || closingVelocity < minClosingVelocity)
+    {
+        TTC = NAN;
+        return;
+    }
+
+    // robust distance to the object from the median forward distance of the current points
+    TTC = medCurrX / closingVelocity;
+}
@@ -0,0 +1,41 @@
+
+#ifndef lidarIcp_hpp
+#define lidarIcp_hpp
+
+#include <stdio.h>
+#include <vector>
+
+#include "dataStructures.h"
+
+// 3D kd-tree over Lidar points, stored implicitly in a reordered copy of the points (each node is the midpoint of its index
+// range), so it can be rebuilt without reallocating
+struct KdTree
+{
+    std::vector<LidarPoint> points; // copy of the indexed points, reordered into tree layout
+    std::vector<int> axes;          // split axis of each node (node = midpoint of its index range)
+
+    void build(const std::vector<LidarPoint> &cloud);
+    int nearest(const LidarPoint &query, double maxDist, double &sqDist) const; // index into points, -1 if none within maxDist
+
+private:
+    void buildRange(int lo, int hi, int depth);
+    void nearestRange(int lo, int hi, const LidarPoint &query, int &best, double &bestSqDist) const;
+};
+
+struct IcpResult
+{
+    double tx, ty, tz;  // translation of the object between previous and current frame in [m]
+    double yaw;         // rotation about the vertical axis in [rad]
+    int iterations;     // no. of iterations until convergence
+    double rmse;        // root mean squared correspondence distance after alignment in [m]
+    int correspondences; // no. of source points with a target point within the correspondence distance in the last iteration
+    bool bConverged;    // the update fell below the minimum delta with enough correspondences
+    bool bForwardConverged; // the update of tx alone fell below the minimum delta in the last iteration
+};
+
+bool alignLidarICP(std::vector<LidarPoint> &source, KdTree &targetTree, IcpResult &result, double initialTx=0.0,
+                   int maxIterations=20, double maxCorrDist=0.5, double minDelta=1e-3, int minCorrespondences=10);
+void computeTTCLidarICP(std::vector<LidarPoint> &lidarPointsPrev, std::vector<LidarPoint> &lidarPointsCurr, double frameRate,
+                        double &TTC, double &closingVelocity, KdTree &tree);
+
+#endif /* lidarIcp_hpp */
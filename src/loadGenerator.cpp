@@ -0,0 +1,159 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "pipeline.hpp"
+#include "latencyHistogram.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+struct LoadRunResult { // outcome of feeding the pipeline at one target rate
+    double targetRate;
+    double throughput;       // completed frames per second
+    size_t maxQueueDepth;
+    double queueGrowth;      // frames per second the backlog grew by on average
+    LatencyHistogram latency; // scheduled arrival to result, in microseconds
+};
+
+// Feed nFrames frames at a fixed rate, independent of the pipeline's progress (open loop). Latency is measured from the
+// scheduled arrival time, so a stalled pipeline is charged for all frames that queued up behind it (no coordinated omission).
+static void runAtRate(const PipelineConfig &config, const std::vector<DataFrame> &recorded, double rate, size_t nFrames, LoadRunResult &result)
+{
+    result.targetRate = rate;
+    result.maxQueueDepth = 0;
+    result.latency.reset();
+
+    mutex mtx;
+    condition_variable cond;
+    deque<pair<size_t, Clock::time_point>> queue; // frame number and scheduled arrival
+    vector<size_t> depthAtArrival;
+    bool bDone = false;
+
+    auto period = chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / rate));
+    Clock::time_point start = Clock::now();
+
+    // sensor: frames arrive at their scheduled time whether or not the previous ones have been processed
+    thread sensor([&]() {
+        for (size_t i = 0; i < nFrames; ++i)
+        {
+            Clock::time_point arrival = start + i * period;
+            this_thread::sleep_until(arrival);
+            {
+                lock_guard<mutex> lock(mtx);
+                queue.emplace_back(i, arrival);
+                depthAtArrival.push_back(queue.size());
+            }
+            cond.notify_one();
+        }
+        lock_guard<mutex> lock(mtx);
+        bDone = true;
+        cond.notify_one();
+    });
+
+    PipelineState state;
+    vector<TTCResult> ttcResults;
+    DataFrame prevFrame;
+    size_t completed = 0;
+    while (true)
+    {
+        pair<size_t, Clock::time_point> job;
+        {
+            unique_lock<mutex> lock(mtx);
+            cond.wait(lock, [&]() { return bDone || !queue.empty(); });
+            if (queue.empty())
+            {
+                break;
+            }
+            job = queue.front();
+            queue.pop_front();
+        }
+
+        // the recording is replayed in a loop, tracking restarts at the beginning of every pass
+        size_t recIdx = job.first % recorded.size();
+        DataFrame frame;
+        frame.cameraImg = recorded[recIdx].cameraImg;
+        frame.lidarPoints = recorded[recIdx].lidarPoints;
+        bool bHasPrev = recIdx > 0 && job.first > 0;
+        processFrame(config, frame, bHasPrev ? &prevFrame : nullptr, &state);
+        if (bHasPrev)
+        {
+            processFramePair(config, prevFrame, frame, state, recIdx, ttcResults);
+        }
+        prevFrame = std::move(frame);
+        ttcResults.clear();
+
+        result.latency.record(chrono::duration_cast<chrono::microseconds>(Clock::now() - job.second).count());
+        ++completed;
+    }
+    sensor.join();
+
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+    double offeredTime = nFrames / rate;
+    result.throughput = completed / elapsed;
+    result.maxQueueDepth = depthAtArrival.empty() ? 0 : *max_element(depthAtArrival.begin(), depthAtArrival.end());
+    result.queueGrowth = depthAtArrival.size() > 1 ? ((double)depthAtArrival.back() - depthAtArrival.front()) / offeredTime : 0.0;
+}
+
+/* LOAD GENERATOR: measures the sustainable sensor rate of the full pipeline */
+// usage: load_generator [frames per run] [rate in Hz ...]
+int main(int argc, const char *argv[])
+{
+    string dataPath = "../";
+    PipelineConfig config = createDefaultConfig(dataPath);
+    setLogLevel(LOG_LEVEL_WARN);
+
+    size_t nFrames = argc > 1 ? stoul(argv[1]) : 100;
+    vector<double> rates;
+    for (int i = 2; i < argc; ++i)
+    {
+        rates.push_back(stod(argv[i]));
+    }
+    if (rates.empty())
+    {
+        rates = {10.0, 20.0, 50.0};
+    }
+
+    // preload the recording so file I/O does not distort the measurement
+    vector<DataFrame> recorded(config.frameFiles.size());
+    for (size_t i = 0; i < recorded.size(); ++i)
+    {
+        loadFrame(config, i, recorded[i]);
+    }
+
+    double maxSustainable = 0.0;
+    for (double rate : rates)
+    {
+        LoadRunResult result;
+        runAtRate(config, recorded, rate, nFrames, result);
+
+        // sustainable: the pipeline keeps up with the sensor and the backlog does not grow
+        bool bSustainable = result.throughput >= 0.98 * rate && result.queueGrowth < 0.5;
+        if (bSustainable)
+        {
+            maxSustainable = max(maxSustainable, rate);
+        }
+
+        cout << "=== " << rate << " Hz, " << nFrames << " frames ===" << endl;
+        cout << "  throughput " << result.throughput << " frames/s, max queue depth " << result.maxQueueDepth
+             << ", queue growth " << result.queueGrowth << " frames/s -> " << (bSustainable ? "sustainable" : "NOT sustainable") << endl;
+        result.latency.print("  arrival-to-result latency");
+    }
+    cout << "Max. sustainable rate of the tested rates : " << maxSustainable << " Hz (" << thread::hardware_concurrency() << " hardware threads)" << endl;
+
+    flushLog();
+    return 0;
+}
@@ -0,0 +1,157 @@
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+#include "logging.hpp"
+
+using namespace std;
+
+static const size_t kLogCapacity = 4096;  // no. of slots in the ring buffer (power of two)
+static const size_t kMaxMessage = 240;    // longer messages are truncated
+
+static const char *kLevelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+// slot of the bounded multi-producer ring buffer; the sequence number tells producers and the consumer whose turn it is
+struct LogSlot
+{
+    std::atomic<size_t> sequence;
+    LogLevel level;
+    size_t length;
+    char text[kMaxMessage];
+};
+
+// Lock-free bounded queue (after D. Vyukov) drained by a single background thread, so logging never waits on I/O
+class AsyncLogger
+{
+public:
+    AsyncLogger() : enqueuePos(0), dequeuePos(0), dropped(0), bStop(false)
+    {
+        for (size_t i = 0; i < kLogCapacity; ++i)
+        {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+        writer = thread(&AsyncLogger::drain, this);
+    }
+
+    ~AsyncLogger()
+    {
+        bStop.store(true, memory_order_release);
+        writer.join();
+        if (dropped.load() > 0)
+        {
+            fprintf(stderr, "[WARN] %zu log messages dropped\n", dropped.load());
+        }
+    }
+
+    void push(LogLevel level, const std::string &msg)
+    {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        LogSlot *slot;
+        while (true)
+        {
+            slot = &slots[pos & (kLogCapacity - 1)];
+            size_t seq = slot->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            { // buffer full, drop instead of stalling the caller
+                dropped.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        slot->length = min(msg.size(), kMaxMessage);
+        memcpy(slot->text, msg.data(), slot->length);
+        slot->sequence.store(pos + 1, memory_order_release);
+    }
+
+    void flush()
+    {
+        size_t target = enqueuePos.load(memory_order_acquire);
+        while (dequeuePos.load(memory_order_acquire) < target)
+        {
+            this_thread::sleep_for(chrono::microseconds(100));
+        }
+    }
+
+private:
+    void drain()
+    {
+        while (true)
+        {
+            bool bWritten = false;
+            size_t pos = dequeuePos.load(memory_order_relaxed);
+            LogSlot *slot = &slots[pos & (kLogCapacity - 1)];
+            while (slot->sequence.load(memory_order_acquire) == pos + 1)
+            {
+                fprintf(stdout, "[%s] %.*s\n", kLevelNames[slot->level], (int)slot->length, slot->text);
+                slot->sequence.store(pos + kLogCapacity, memory_order_release);
+                dequeuePos.store(++pos, memory_order_release);
+                slot = &slots[pos & (kLogCapacity - 1)];
+                bWritten = true;
+            }
+
+            if (bWritten)
+            {
+                fflush(stdout);
+            }
+            else if (bStop.load(memory_order_acquire))
+            {
+                return;
+            }
+            else
+            {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        }
+    }
+
+    LogSlot slots[kLogCapacity];
+    std::atomic<size_t> enqueuePos, dequeuePos, dropped;
+    std::atomic<bool> bStop;
+    std::thread writer;
+};
+
+static std::atomic<int> logLevel(LOG_LEVEL_WARN);
+
+static AsyncLogger &logger()
+{
+    static AsyncLogger instance;
+    return instance;
+}
+
+void setLogLevel(LogLevel level)
+{
+    logLevel.store(level, memory_order_relaxed);
+}
+
+LogLevel getLogLevel()
+{
+    return (LogLevel)logLevel.load(memory_order_relaxed);
+}
+
+bool logEnabled(LogLevel level)
+{
+    return level >= logLevel.load(memory_order_relaxed);
+}
+
+void logMessage(LogLevel level, const std::string &msg)
+{
+    logger().push(level, msg);
+}
+
+void flushLog()
+{
+    logger().flush();
+}
@@ -0,0 +1,45 @@
+
+#ifndef logging_hpp
+#define logging_hpp
+
+#include <stdio.h>
+#include <sstream>
+#include <string>
+
+// levels below LOG_COMPILE_LEVEL are removed at compile time (0 = debug, 1 = info, 2 = warn, 3 = error)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+enum LogLevel { LOG_LEVEL_DEBUG = 0, LOG_LEVEL_INFO = 1, LOG_LEVEL_WARN = 2, LOG_LEVEL_ERROR = 3, LOG_LEVEL_OFF = 4 };
+
+void setLogLevel(LogLevel level);      // runtime threshold, defaults to LOG_LEVEL_WARN so nothing is emitted per frame
+LogLevel getLogLevel();
+bool logEnabled(LogLevel level);
+void logMessage(LogLevel level, const std::string &msg); // enqueue without blocking, dropped if the ring buffer is full
+void flushLog();                       // wait until all queued messages have been written
+
+#define LOG_AT(level, expr) \
+    do { if (logEnabled(level)) { std::ostringstream logStream_; logStream_ << expr; logMessage(level, logStream_.str()); } } while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_DEBUG(expr) LOG_AT(LOG_LEVEL_DEBUG, expr)
+#else
+#define LOG_DEBUG(expr) do { } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_INFO(expr) LOG_AT(LOG_LEVEL_INFO, expr)
+#else
+#define LOG_INFO(expr) do { } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define LOG_WARN(expr) LOG_AT(LOG_LEVEL_WARN, expr)
+#else
+#define LOG_WARN(expr) do { } while (0)
+#endif
+
+#define LOG_ERROR(expr) LOG_AT(LOG_LEVEL_ERROR, expr)
+
+#endif /* logging_hpp */
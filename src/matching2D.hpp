@@ -20,11 +20,14 @@
 #include "dataStructures.h"
 
 
+cv::Ptr<cv::FeatureDetector> createKeypointDetector(std::string detectorType, double threshold=-1.0, int maxFeatures=0);
+cv::Ptr<cv::DescriptorExtractor> createDescriptorExtractor(std::string descriptorType);
 void detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, double &detectedTime, bool bVis=false);
 void detKeypointsShiTomasi(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, double &detectedTime, bool bVis=false);
 void detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, std::string detectorType, double &detectedTime, bool bVis=false);
-void descKeypoints(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, double &descTime, std::string descriptorType);
+void descKeypoints(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, double &descTime, std::string descriptorType, int nThreads=1);
 void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::KeyPoint> &kPtsRef, cv::Mat &descSource, cv::Mat &descRef,
-                      std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, double &matchTime, std::string selectorType);
+                      std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, double &matchTime, std::string selectorType,
+                      double minDistRatio=0.8);
 
 #endif /* matching2D_hpp */
@@ -1,12 +1,51 @@
 #include <numeric>
+#include <thread>
 #include "matching2D.hpp"
+#include "gemmMatcher.hpp"
+#include "logging.hpp"
 
 using namespace std;
 
 // Find best matches for keypoints in two camera images based on several matching methods
 void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::KeyPoint> &kPtsRef, cv::Mat &descSource, cv::Mat &descRef,
-                      std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, double &matchTime, std::string selectorType)
+                      std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, double &matchTime, std::string selectorType,
+                      double minDistRatio)
 {
+    // float descriptors can be matched through the blocked distance-matrix product, binary ones fall back to brute force
+    bool bGemm = matcherType.compare("MAT_GEMM") == 0 && descriptorType.compare("DES_HOG") == 0;
+    if (matcherType.compare("MAT_GEMM") == 0 && !bGemm)
+    {
+        static bool bWarned = false;
+        if (!bWarned)
+        {
+            LOG_WARN("MAT_GEMM only supports float descriptors, matching " << descriptorType << " by brute force");
+            bWarned = true;
+        }
+        matcherType = "MAT_BF";
+    }
+    if (bGemm)
+    {
+        if (descSource.type() != CV_32F)
+        {
+            descSource.convertTo(descSource, CV_32F);
+            descRef.convertTo(descRef, CV_32F);
+        }
+        vector<vector<cv::DMatch>> knn_matches;
+        matchTime = (double)cv::getTickCount();
+        knnMatchGemm(descSource, descRef, knn_matches);
+        matchTime = ((double)cv::getTickCount() - matchTime)/cv::getTickFrequency();
+
+        bool bKNN = selectorType.compare("SEL_KNN") == 0;
+        for (auto it = knn_matches.begin(); it != knn_matches.end(); it++)
+        {
+            if (!bKNN || (it->size() > 1 && (*it)[0].distance < minDistRatio * (*it)[1].distance))
+            {
+                matches.push_back((*it)[0]);
+            }
+        }
+        return;
+    }
+
     // configure matcher
     bool crossCheck = false;
     cv::Ptr<cv::DescriptorMatcher> matcher;
@@ -53,13 +92,12 @@ void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::Key
         vector<vector<cv::DMatch>> knn_matches;
         matchTime = (double)cv::getTickCount();
         matcher->knnMatch(descSource, descRef, knn_matches,2);
-        cout<<"After matching descSource, descRef type: "<<descSource.type()<<" "<<descRef.type()<<endl;
+        LOG_DEBUG("After matching descSource, descRef type: " << descSource.type() << " " << descRef.type());
         matchTime = ((double)cv::getTickCount() - matchTime)/cv::getTickFrequency();
 
-        double minDistRatio = 0.8;
         for (auto it = knn_matches.begin(); it != knn_matches.end(); it++)
         {
-            if((*it)[0].distance < minDistRatio * (*it)[1].distance)
+            if(it->size() > 1 && (*it)[0].distance < minDistRatio * (*it)[1].distance)
             {
                 matches.push_back((*it)[0]);
             }
@@ -69,10 +107,9 @@ void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::Key
     }
 }
 
-// Use one of several types of state-of-art descriptors to uniquely identify keypoints
-void descKeypoints(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, double &descTime, string descriptorType)
+// Create the extractor for one of several types of state-of-art descriptors
+cv::Ptr<cv::DescriptorExtractor> createDescriptorExtractor(std::string descriptorType)
 {
-    // select appropriate descriptor
     cv::Ptr<cv::DescriptorExtractor> extractor;
     if (descriptorType.compare("BRISK") == 0)
     {
@@ -83,20 +120,20 @@ void descKeypoints(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descr
 
         extractor = cv::BRISK::create(threshold, octaves, patternScale);
     }
-    else if(descriptorType.compare("SIFT"))
+    else if(descriptorType.compare("SIFT") == 0)
     {
         extractor = cv::xfeatures2d::SIFT::create();
     }
 
-    else if(descriptorType.compare("FREAK"))
+    else if(descriptorType.compare("FREAK") == 0)
     {
         extractor = cv::xfeatures2d::FREAK::create();
     }
-    else if(descriptorType.compare("BRIEF"))
+    else if(descriptorType.compare("BRIEF") == 0)
     {
         extractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
     }
-    else if(descriptorType.compare("AKAZE"))
+    else if(descriptorType.compare("AKAZE") == 0)
     {
         extractor = cv::AKAZE::create();
     }
@@ -106,12 +143,77 @@ void descKeypoints(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descr
         float scaleFactor = 1.2f;
         extractor = cv::ORB::create(n_features, scaleFactor);
     }
+    return extractor;
+}
+
+// Describe keypoints in contiguous chunks on several threads, each with its own extractor instance. Extractors drop keypoints
+// they cannot describe (e.g. near the image border), so every chunk keeps its surviving keypoints next to its descriptor rows
+// and both are concatenated in chunk order, which preserves the original order and the keypoint/descriptor alignment.
+static void descKeypointsParallel(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, string descriptorType, int nThreads, size_t minChunkSize)
+{
+    size_t nChunks = min((size_t)nThreads, max<size_t>(1, keypoints.size() / minChunkSize));
+    vector<vector<cv::KeyPoint>> chunkKeypoints(nChunks);
+    vector<cv::Mat> chunkDescriptors(nChunks);
+    for (size_t c = 0; c < nChunks; ++c)
+    {
+        size_t begin = keypoints.size() * c / nChunks, end = keypoints.size() * (c + 1) / nChunks;
+        chunkKeypoints[c].assign(keypoints.begin() + begin, keypoints.begin() + end);
+    }
+
+    vector<thread> workers;
+    for (size_t c = 1; c < nChunks; ++c)
+    {
+        workers.emplace_back([&, c]() {
+            createDescriptorExtractor(descriptorType)->compute(img, chunkKeypoints[c], chunkDescriptors[c]);
+        });
+    }
+    createDescriptorExtractor(descriptorType)->compute(img, chunkKeypoints[0], chunkDescriptors[0]);
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+
+    keypoints.clear();
+    vector<cv::Mat> rows;
+    for (size_t c = 0; c < nChunks; ++c)
+    {
+        keypoints.insert(keypoints.end(), chunkKeypoints[c].begin(), chunkKeypoints[c].end());
+        if (!chunkDescriptors[c].empty())
+        {
+            rows.push_back(chunkDescriptors[c]);
+        }
+    }
+    if (rows.empty())
+    {
+        descriptors.release();
+    }
+    else
+    {
+        cv::vconcat(rows, descriptors);
+    }
+}
+
+// Use one of several types of state-of-art descriptors to uniquely identify keypoints
+void descKeypoints(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, double &descTime, string descriptorType, int nThreads)
+{
+    // below this no. of keypoints per thread the per-chunk setup (e.g. the scale space of SIFT and AKAZE) outweighs the gain
+    size_t minChunkSize = 500;
 
-    // perform feature description
     descTime = (double)cv::getTickCount();
-    extractor->compute(img, keypoints, descriptors);
+    if (nThreads > 1 && keypoints.size() >= 2 * minChunkSize)
+    {
+        descKeypointsParallel(keypoints, img, descriptors, descriptorType, nThreads, minChunkSize);
+    }
+    else
+    {
+        // select appropriate descriptor
+        cv::Ptr<cv::DescriptorExtractor> extractor = createDescriptorExtractor(descriptorType);
+
+        // perform feature description
+        extractor->compute(img, keypoints, descriptors);
+    }
     descTime = ((double)cv::getTickCount() - descTime) / cv::getTickFrequency();
-    cout << descriptorType << " descriptor extraction in " << 1000 * descTime/ 1.0 << " ms" << endl;
+    LOG_DEBUG(descriptorType << " descriptor extraction in " << 1000 * descTime / 1.0 << " ms");
 }
 
 // Detect keypoints in image using the traditional Shi-Thomasi detector
@@ -174,9 +276,9 @@ void detKeypointsHarris(vector<cv::KeyPoint> &keypoints, cv::Mat &img, double &d
     // cv::convertScaleAbs(dst_norm, dst_norm_scaled);
 
     double maxOverlap = 0.0;
-    for(size_t j=0; j < dst_norm.rows; ++j)
+    for(int j=0; j < dst_norm.rows; ++j)
     {
-        for (size_t i=0; i < dst_norm.cols; ++i)
+        for (int i=0; i < dst_norm.cols; ++i)
         {
             int response = static_cast<int>(dst_norm.at<float>(j,i));
             if (response > minResponse)
@@ -221,34 +323,40 @@ void detKeypointsHarris(vector<cv::KeyPoint> &keypoints, cv::Mat &img, double &d
 }
 
 
-void detKeypointsModern(vector<cv::KeyPoint> &keypoints, cv::Mat &img, std::string detectorType, double &detectedTime, bool bVis)
+// Create one of the modern keypoint detectors, BRISK for unknown types. A non-negative threshold replaces the default
+// detection threshold (FAST/BRISK/ORB: FAST score, AKAZE: detector response, SIFT: contrast), maxFeatures the ORB/SIFT limit.
+cv::Ptr<cv::FeatureDetector> createKeypointDetector(std::string detectorType, double threshold, int maxFeatures)
 {
-    cv::Ptr<cv::FeatureDetector> detector = cv::BRISK::create();
-    string windowName = "BRISK Detector Results";
+    bool bDefault = threshold < 0.0;
+    cv::Ptr<cv::FeatureDetector> detector = bDefault ? cv::BRISK::create() : cv::BRISK::create((int)threshold);
     if (detectorType.compare("FAST") == 0)
     {
-        windowName = "FAST Detector Results";
-        int threshold = 30;
+        int fastThreshold = bDefault ? 30 : (int)threshold;
         int bNMS = true;
         cv::FastFeatureDetector::DetectorType type = cv::FastFeatureDetector::DetectorType::TYPE_9_16;
-        detector = cv::FastFeatureDetector::create(threshold, bNMS, type);      
+        detector = cv::FastFeatureDetector::create(fastThreshold, bNMS, type);      
     }
     if (detectorType.compare("SIFT")==0)
     {
-        windowName = "SIFT Detector Results";
-        detector = cv::xfeatures2d::SIFT::create();
+        detector = bDefault ? cv::xfeatures2d::SIFT::create(maxFeatures) : cv::xfeatures2d::SIFT::create(maxFeatures, 3, threshold);
     }
     if (detectorType.compare("ORB") == 0)
     {
-        windowName = "ORB Detector Results";
-        int n_features = 500;
-        detector = cv::ORB::create(n_features);
+        int n_features = maxFeatures > 0 ? maxFeatures : 500;
+        detector = bDefault ? cv::ORB::create(n_features)
+                            : cv::ORB::create(n_features, 1.2f, 8, 31, 0, 2, cv::ORB::HARRIS_SCORE, 31, (int)threshold);
     }
     if (detectorType.compare("AKAZE") == 0)
     {
-        windowName = "AKAZE Detector Results";
-        detector = cv::AKAZE::create();
+        detector = bDefault ? cv::AKAZE::create() : cv::AKAZE::create(cv::AKAZE::DESCRIPTOR_MLDB, 0, 3, (float)threshold);
     }
+    return detector;
+}
+
+void detKeypointsModern(vector<cv::KeyPoint> &keypoints, cv::Mat &img, std::string detectorType, double &detectedTime, bool bVis)
+{
+    cv::Ptr<cv::FeatureDetector> detector = createKeypointDetector(detectorType);
+    string windowName = detectorType + " Detector Results";
 
     detectedTime = (double)cv::getTickCount();
     detector->detect(img, keypoints);
@@ -2,37 +2,125 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <mutex>
 
 #include <opencv2/dnn.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
 #include "objectDetection2D.hpp"
+#include "simdDispatch.hpp"
 
 
 using namespace std;
 
+// greedy non-maximum suppression with the same selection as cv::dnn::NMSBoxes, the overlaps of a candidate with
+// all boxes kept so far are computed by one SIMD kernel call
+static void suppressNonMaxima(const vector<cv::Rect> &boxes, const vector<float> &confidences, float confThreshold, float nmsThreshold, vector<int> &indices)
+{
+    vector<int> order;
+    for (int i = 0; i < (int)boxes.size(); ++i)
+    {
+        if (confidences[i] > confThreshold)
+        {
+            order.push_back(i);
+        }
+    }
+    stable_sort(order.begin(), order.end(), [&](int i1, int i2) { return confidences[i1] > confidences[i2]; });
+
+    const SimdKernels &kernels = simdKernels();
+    vector<float> x1, y1, x2, y2, iou; // corners of the kept boxes
+    indices.clear();
+    for (int i : order)
+    {
+        const cv::Rect &b = boxes[i];
+        float box[4] = {(float)b.x, (float)b.y, (float)(b.x + b.width), (float)(b.y + b.height)};
+        iou.resize(indices.size());
+        kernels.iouRow(box, x1.data(), y1.data(), x2.data(), y2.data(), indices.size(), iou.data());
+        if (any_of(iou.begin(), iou.end(), [&](float overlap) { return overlap > nmsThreshold; }))
+        {
+            continue;
+        }
+        indices.push_back(i);
+        x1.push_back(box[0]);
+        y1.push_back(box[1]);
+        x2.push_back(box[2]);
+        y2.push_back(box[3]);
+    }
+}
+
+// original class index of every class output of a model pruned by yolo_prune, one index per line
+bool readClassMap(const std::string &classMapFile, std::vector<int> &classMap)
+{
+    classMap.clear();
+    ifstream ifs(classMapFile.c_str());
+    int classId;
+    while (ifs >> classId)
+    {
+        classMap.push_back(classId);
+    }
+    return !classMap.empty();
+}
+
+// class map of a pruned model, read once per file and shared by all threads running the detector
+static const vector<int> &cachedClassMap(const string &classMapFile)
+{
+    static mutex mtx;
+    static map<string, vector<int>> classMaps;
+    lock_guard<mutex> lock(mtx);
+    auto it = classMaps.find(classMapFile);
+    if (it == classMaps.end())
+    {
+        it = classMaps.emplace(classMapFile, vector<int>()).first;
+        if (!readClassMap(classMapFile, it->second))
+        {
+            cerr << "Cannot read class map " << classMapFile << endl;
+        }
+    }
+    return it->second;
+}
+
+// YOLO network of the calling thread, parsed from the cfg and weights files on first use only. A Net must not be used by
+// several threads at once, so every thread (e.g. each offline worker) keeps its own instance.
+cv::dnn::Net &detectorNet(const std::string &modelConfiguration, const std::string &modelWeights)
+{
+    static thread_local map<string, cv::dnn::Net> nets;
+    string key = modelConfiguration + "|" + modelWeights;
+    auto it = nets.find(key);
+    if (it == nets.end())
+    {
+        cv::dnn::Net net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        it = nets.emplace(key, net).first;
+    }
+    return it->second;
+}
+
 // detects objects in an image using the YOLO library and a set of pre-trained objects from the COCO database;
-// a set of 80 classes is listed in "coco.names" and pre-trained weights are stored in "yolov3.weights"
+// a set of 80 classes is listed in "coco.names" and pre-trained weights are stored in "yolov3.weights".
+// Models pruned to a subset of classes (yolo_prune) output fewer class scores, classMapFile maps them back to the COCO classes.
+// Without a given net, the network of the calling thread is used (detectorNet), so the weights are parsed once per thread.
 void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
-                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis)
+                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis, int inputSize,
+                   std::string classMapFile, cv::dnn::Net *net)
 {
-    // load class names from file
-    vector<string> classes;
-    ifstream ifs(classesFile.c_str());
-    string line;
-    while (getline(ifs, line)) classes.push_back(line);
+    static const vector<int> noClassMap;
+    const vector<int> &classMap = classMapFile.empty() ? noClassMap : cachedClassMap(classMapFile);
     
-    // load neural network
-    cv::dnn::Net net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
-    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    // neural network, loaded once per thread
+    if (net == nullptr)
+    {
+        net = &detectorNet(modelConfiguration, modelWeights);
+    }
     
     // generate 4D blob from input image
     cv::Mat blob;
     vector<cv::Mat> netOutput;
     double scalefactor = 1/255.0;
-    cv::Size size = cv::Size(416, 416);
+    cv::Size size = cv::Size(inputSize, inputSize); // multiple of 32, smaller is faster but misses small objects
     cv::Scalar mean = cv::Scalar(0,0,0);
     bool swapRB = false;
     bool crop = false;
@@ -40,30 +128,53 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     
     // Get names of output layers
     vector<cv::String> names;
-    vector<int> outLayers = net.getUnconnectedOutLayers(); // get  indices of  output layers, i.e.  layers with unconnected outputs
-    vector<cv::String> layersNames = net.getLayerNames(); // get  names of all layers in the network
+    vector<int> outLayers = net->getUnconnectedOutLayers(); // get  indices of  output layers, i.e.  layers with unconnected outputs
+    vector<cv::String> layersNames = net->getLayerNames(); // get  names of all layers in the network
     
     names.resize(outLayers.size());
     for (size_t i = 0; i < outLayers.size(); ++i) // Get the names of the output layers in names
         names[i] = layersNames[outLayers[i] - 1];
     
     // invoke forward propagation through network
-    net.setInput(blob);
-    net.forward(netOutput, names);
+    net->setInput(blob);
+    net->forward(netOutput, names);
     
     // Scan through all bounding boxes and keep only the ones with high confidence
     vector<int> classIds; vector<float> confidences; vector<cv::Rect> boxes;
     for (size_t i = 0; i < netOutput.size(); ++i)
     {
+        // a class map written for a differently pruned model would assign wrong classes
+        size_t nClasses = netOutput[i].cols - 5;
+        if (!classMap.empty() && classMap.size() != nClasses)
+        {
+            cerr << "Class map " << classMapFile << " lists " << classMap.size() << " classes, the model outputs " << nClasses << ", no objects detected" << endl;
+            return;
+        }
+
         float* data = (float*)netOutput[i].data;
         for (int j = 0; j < netOutput[i].rows; ++j, data += netOutput[i].cols)
         {
-            cv::Mat scores = netOutput[i].row(j).colRange(5, netOutput[i].cols);
-            cv::Point classId;
-            double confidence;
-            
+            // class scores are probabilities scaled by the objectness, none of them can pass if the objectness does not
+            if (data[4] <= confThreshold)
+            {
+                continue;
+            }
+
             // Get the value and location of the maximum score
-            cv::minMaxLoc(scores, 0, &confidence, 0, &classId);
+            cv::Point classId;
+            double confidence = data[5];
+            for (int c = 6; c < netOutput[i].cols; ++c)
+            {
+                if (data[c] > confidence)
+                {
+                    confidence = data[c];
+                    classId.x = c - 5;
+                }
+            }
+            if (!classMap.empty() && classId.x < (int)classMap.size())
+            {
+                classId.x = classMap[classId.x];
+            }
             if (confidence > confThreshold)
             {
                 cv::Rect box; int cx, cy;
@@ -83,7 +194,7 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     
     // perform non-maxima suppression
     vector<int> indices;
-    cv::dnn::NMSBoxes(boxes, confidences, confThreshold, nmsThreshold, indices);
+    suppressNonMaxima(boxes, confidences, confThreshold, nmsThreshold, indices);
     for(auto it=indices.begin(); it!=indices.end(); ++it) {
         
         BoundingBox bBox;
@@ -98,6 +209,12 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     // show results
     if(bVis) {
         
+        // load class names from file
+        vector<string> classes;
+        ifstream ifs(classesFile.c_str());
+        string line;
+        while (getline(ifs, line)) classes.push_back(line);
+
         cv::Mat visImg = img.clone();
         for(auto it=bBoxes.begin(); it!=bBoxes.end(); ++it) {
             
@@ -4,10 +4,14 @@
 
 #include <stdio.h>
 #include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
 
 #include "dataStructures.h"
 
 void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
-                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis);
+                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis, int inputSize=416,
+                   std::string classMapFile="", cv::dnn::Net *net=nullptr);
+cv::dnn::Net &detectorNet(const std::string &modelConfiguration, const std::string &modelWeights);
+bool readClassMap(const std::string &classMapFile, std::vector<int> &classMap);
 
 #endif /* objectDetection2D_hpp */
@@ -0,0 +1,565 @@
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "pipeline.hpp"
+#include "matching2D.hpp"
+#include "objectDetection2D.hpp"
+#include "lidarData.hpp"
+#include "camFusion.hpp"
+#include "boxMatching.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+// settings of the KITTI sequence shipped with the project
+PipelineConfig createDefaultConfig(std::string dataPath)
+{
+    PipelineConfig config;
+
+    // camera
+    string imgBasePath = dataPath + "images/";
+    string imgPrefix = "KITTI/2011_09_26/image_02/data/000000"; // left camera, color
+    string imgFileType = ".png";
+    int imgStartIndex = 0; // first file index to load (assumes Lidar and camera names have identical naming convention)
+    int imgEndIndex = 18;   // last file index to load
+    int imgStepWidth = 1;
+    int imgFillWidth = 4;  // no. of digits which make up the file index (e.g. img-0001.png)
+
+    // Lidar
+    string lidarPrefix = "KITTI/2011_09_26/velodyne_points/data/000000";
+    string lidarFileType = ".bin";
+
+    for (int imgIndex = 0; imgIndex <= imgEndIndex - imgStartIndex; imgIndex += imgStepWidth)
+    {
+        ostringstream imgNumber;
+        imgNumber << setfill('0') << setw(imgFillWidth) << imgStartIndex + imgIndex;
+        config.frameFiles.push_back({imgBasePath + imgPrefix + imgNumber.str() + imgFileType, imgBasePath + lidarPrefix + imgNumber.str() + lidarFileType});
+    }
+    config.sensorFrameRate = 10.0 / imgStepWidth;
+
+    // object detection
+    config.yoloBasePath = dataPath + "dat/yolo/";
+    config.yoloClassesFile = config.yoloBasePath + "coco.names";
+    config.yoloModelConfiguration = config.yoloBasePath + "yolov3.cfg";
+    config.yoloModelWeights = config.yoloBasePath + "yolov3.weights";
+
+    // calibration data for camera and lidar
+    cv::Mat P_rect_00(3,4,cv::DataType<double>::type); // 3x4 projection matrix after rectification
+    cv::Mat R_rect_00(4,4,cv::DataType<double>::type); // 3x3 rectifying rotation to make image planes co-planar
+    cv::Mat RT(4,4,cv::DataType<double>::type); // rotation matrix and translation vector
+
+    RT.at<double>(0,0) = 7.533745e-03; RT.at<double>(0,1) = -9.999714e-01; RT.at<double>(0,2) = -6.166020e-04; RT.at<double>(0,3) = -4.069766e-03;
+    RT.at<double>(1,0) = 1.480249e-02; RT.at<double>(1,1) = 7.280733e-04; RT.at<double>(1,2) = -9.998902e-01; RT.at<double>(1,3) = -7.631618e-02;
+    RT.at<double>(2,0) = 9.998621e-01; RT.at<double>(2,1) = 7.523790e-03; RT.at<double>(2,2) = 1.480755e-02; RT.at<double>(2,3) = -2.717806e-01;
+    RT.at<double>(3,0) = 0.0; RT.at<double>(3,1) = 0.0; RT.at<double>(3,2) = 0.0; RT.at<double>(3,3) = 1.0;
+
+    R_rect_00.at<double>(0,0) = 9.999239e-01; R_rect_00.at<double>(0,1) = 9.837760e-03; R_rect_00.at<double>(0,2) = -7.445048e-03; R_rect_00.at<double>(0,3) = 0.0;
+    R_rect_00.at<double>(1,0) = -9.869795e-03; R_rect_00.at<double>(1,1) = 9.999421e-01; R_rect_00.at<double>(1,2) = -4.278459e-03; R_rect_00.at<double>(1,3) = 0.0;
+    R_rect_00.at<double>(2,0) = 7.402527e-03; R_rect_00.at<double>(2,1) = 4.351614e-03; R_rect_00.at<double>(2,2) = 9.999631e-01; R_rect_00.at<double>(2,3) = 0.0;
+    R_rect_00.at<double>(3,0) = 0; R_rect_00.at<double>(3,1) = 0; R_rect_00.at<double>(3,2) = 0; R_rect_00.at<double>(3,3) = 1;
+
+    P_rect_00.at<double>(0,0) = 7.215377e+02; P_rect_00.at<double>(0,1) = 0.000000e+00; P_rect_00.at<double>(0,2) = 6.095593e+02; P_rect_00.at<double>(0,3) = 0.000000e+00;
+    P_rect_00.at<double>(1,0) = 0.000000e+00; P_rect_00.at<double>(1,1) = 7.215377e+02; P_rect_00.at<double>(1,2) = 1.728540e+02; P_rect_00.at<double>(1,3) = 0.000000e+00;
+    P_rect_00.at<double>(2,0) = 0.000000e+00; P_rect_00.at<double>(2,1) = 0.000000e+00; P_rect_00.at<double>(2,2) = 1.000000e+00; P_rect_00.at<double>(2,3) = 0.000000e+00;
+
+    config.P_rect_00 = P_rect_00;
+    config.R_rect_00 = R_rect_00;
+    config.RT = RT;
+
+    return config;
+}
+
+// boxes only need copies of their Lidar points for ICP and for drawing them on the image, all other consumers use the summaries
+bool keepLidarPoints(const PipelineConfig &config)
+{
+    return config.bKeepLidarPoints || config.bLidarICP || config.bVisTTC;
+}
+
+// detect with a model written by yolo_prune into the YOLO directory (<modelName>.cfg, .weights, .classmap), which only scores
+// a subset of the COCO classes; class IDs of the boxes remain COCO IDs
+void usePrunedDetector(PipelineConfig &config, std::string modelName)
+{
+    config.yoloModelConfiguration = config.yoloBasePath + modelName + ".cfg";
+    config.yoloModelWeights = config.yoloBasePath + modelName + ".weights";
+    config.yoloClassMapFile = config.yoloBasePath + modelName + ".classmap";
+}
+
+// detect keypoints with the configured detector and optionally keep only the strongest ones;
+// with a threshold state, the detection threshold follows the target keypoint count from frame to frame
+void detectFrameKeypoints(const PipelineConfig &config, cv::Mat &img, std::vector<cv::KeyPoint> &keypoints, ThresholdState *thresholdState)
+{
+    // convert current image to grayscale
+    cv::Mat imgGray;
+    cv::cvtColor(img, imgGray, cv::COLOR_BGR2GRAY);
+
+    // extract 2D keypoints from current image
+    keypoints.clear();
+    double detectedTime;
+
+    if (config.detectorType.compare("SHITOMASI") == 0)
+    {
+        detKeypointsShiTomasi(keypoints, imgGray, detectedTime, false);
+    }
+    else if(config.detectorType.compare("HARRIS") == 0)
+    {
+        detKeypointsHarris(keypoints, imgGray, detectedTime, false);
+    }
+    else if (thresholdState != nullptr && hasAdaptiveThreshold(config.detectorType))
+    {
+        detectKeypointsAdaptive(config.thresholdPolicy, *thresholdState, config.detectorType, imgGray, keypoints);
+    }
+    else
+    {
+        detKeypointsModern(keypoints, imgGray, config.detectorType, detectedTime, false);
+    }
+
+    // optional : limit number of keypoints (helpful for debugging and learning)
+    if (config.bLimitKpts && (int)keypoints.size() > config.maxKeypoints)
+    {
+        if (config.detectorType.compare("SHITOMASI") == 0)
+        { // there is no response info, so keep the first ones as they are sorted in descending quality order
+            keypoints.erase(keypoints.begin() + config.maxKeypoints, keypoints.end());
+        }
+        cv::KeyPointsFilter::retainBest(keypoints, config.maxKeypoints);
+        LOG_DEBUG("Keypoints have been limited!");
+    }
+}
+
+// add the time since the previous lap to a stage of the frame trace
+static void traceLap(FrameTrace &trace, PipelineStage stage, double &lapMs)
+{
+    double now = traceClockMs();
+    trace.stageMs[stage] += now - lapMs;
+    lapMs = now;
+}
+
+// load camera image and raw Lidar scan of a frame, preferably through the readahead of a frame reader
+bool loadFrame(const PipelineConfig &config, size_t frameIdx, DataFrame &frame, FrameReader *frameReader)
+{
+    frame.trace.frameIndex = frameIdx;
+    frame.trace.startMs = traceClockMs();
+    double lapMs = frame.trace.startMs;
+    frame.lidarPoints.clear();
+    if (frameReader == nullptr || !frameReader->readFrame(frameIdx, frame.cameraImg, frame.lidarPoints))
+    {
+        frame.cameraImg = cv::imread(config.frameFiles[frameIdx].imgFile);
+        frame.lidarPoints.clear();
+        loadLidarFromFile(frame.lidarPoints, config.frameFiles[frameIdx].lidarFile);
+    }
+
+    traceLap(frame.trace, STAGE_LOAD, lapMs);
+    LOG_DEBUG("#1 : LOAD IMAGE INTO BUFFER done");
+    return !frame.cameraImg.empty();
+}
+
+// Stages which only depend on the current frame: object detection, Lidar cropping and clustering, keypoints and descriptors.
+// Static-scene reuse needs the previous frame and the pipeline state and is skipped if they are not given.
+void processFrame(const PipelineConfig &config, DataFrame &frame, DataFrame *prevFrame, PipelineState *state)
+{
+    bool bVis = config.bVis;
+    double lapMs = traceClockMs();
+    if (frame.trace.startMs == 0.0) // frames received from another process are not loaded here
+    {
+        frame.trace.startMs = lapMs;
+    }
+
+    /* DETECT STATIC SCENE */
+
+    // compare thumbnail, Lidar range histogram and ego-lane distance with the previous frame
+    bool bStaticFrame = false;
+    if (config.bReuseStatic && state != nullptr)
+    {
+        computeSceneSignature(config.staticConfig, frame.cameraImg, frame.lidarPoints, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ,
+                              config.minR, state->currSignature);
+        bStaticFrame = prevFrame != nullptr && isStaticScene(config.staticConfig, state->prevSignature, state->currSignature, state->staticFrames);
+        std::swap(state->prevSignature, state->currSignature);
+    }
+    if (bStaticFrame)
+    {
+        reuseFrameResults(*prevFrame, frame);
+        LOG_DEBUG("Static scene, reusing detections and features of previous frame");
+    }
+    frame.trace.bStatic = bStaticFrame;
+    traceLap(frame.trace, STAGE_SCENE, lapMs);
+
+
+    /* DETECT & CLASSIFY OBJECTS */
+
+    if (!bStaticFrame && config.bDetectObjects)
+    {
+        // each offline worker thread runs its own network, loaded on its first frame
+        cv::dnn::Net &net = detectorNet(config.yoloModelConfiguration, config.yoloModelWeights);
+        detectObjects(frame.cameraImg, frame.boundingBoxes, config.confThreshold, config.nmsThreshold,
+                      config.yoloBasePath, config.yoloClassesFile, config.yoloModelConfiguration, config.yoloModelWeights, bVis, config.yoloInputSize,
+                      config.yoloClassMapFile, &net);
+    }
+
+    traceLap(frame.trace, STAGE_DETECT, lapMs);
+    LOG_DEBUG("#2 : DETECT & CLASSIFY OBJECTS done");
+
+
+    /* CROP LIDAR POINTS */
+
+    // remove Lidar points based on distance properties
+    cropLidarPoints(frame.lidarPoints, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ, config.minR);
+
+    traceLap(frame.trace, STAGE_CROP, lapMs);
+    LOG_DEBUG("#3 : CROP LIDAR POINTS done");
+
+
+    /* CLUSTER LIDAR POINT CLOUD */
+
+    // associate Lidar points with camera-based ROI
+    cv::Mat P_rect_00 = config.P_rect_00, R_rect_00 = config.R_rect_00, RT = config.RT;
+    clusterLidarWithROI(frame.boundingBoxes, frame.lidarPoints, config.shrinkFactor, P_rect_00, R_rect_00, RT, keepLidarPoints(config));
+
+    // Visualize 3D objects
+    if(bVis)
+    {
+        show3DObjects(frame.boundingBoxes, cv::Size(4.0, 20.0), cv::Size(1000, 1000), true);
+    }
+
+    traceLap(frame.trace, STAGE_CLUSTER, lapMs);
+    LOG_DEBUG("#4 : CLUSTER LIDAR POINT CLOUD done");
+
+
+    /* DETECT IMAGE KEYPOINTS */
+
+    // the feature engine chosen by the online selector replaces the configured detector and descriptor
+    bool bEngine = config.bAdaptiveFeatures && state != nullptr;
+    if (bEngine && state->featureSelector.engines.empty())
+    {
+        initFeatureSelector(config.featurePolicy, state->featureSelector);
+    }
+
+    if (!bStaticFrame && !bEngine) // static frames keep the keypoints of the previous frame
+    {
+        // threshold control needs the frames in order, it is not used when frames are processed in parallel without state
+        ThresholdState *thresholdState = config.bAdaptiveThreshold && state != nullptr ? &state->detectorThreshold : nullptr;
+        detectFrameKeypoints(config, frame.cameraImg, frame.keypoints, thresholdState);
+    }
+
+    traceLap(frame.trace, STAGE_KEYPOINTS, lapMs);
+    LOG_DEBUG("#5 : DETECT KEYPOINTS done");
+
+
+    /* EXTRACT KEYPOINT DESCRIPTORS */
+
+    if (!bStaticFrame && !bEngine) // static frames keep the descriptors of the previous frame
+    {
+        cv::Mat descriptors;
+        double descTime;
+        descKeypoints(frame.keypoints, frame.cameraImg, descriptors, descTime, config.descriptorType, config.descThreads);
+        frame.descriptors = descriptors;
+    }
+    else if (!bStaticFrame)
+    {
+        frame.featureEngine = state->featureSelector.current;
+        computeEngineFeatures(state->featureSelector.engines[frame.featureEngine], frame.cameraImg, frame.keypoints, frame.descriptors);
+    }
+
+    traceLap(frame.trace, STAGE_DESCRIPTORS, lapMs);
+    frame.trace.nBoxes = frame.boundingBoxes.size();
+    frame.trace.doneMs = lapMs;
+    LOG_DEBUG("#6 : EXTRACT DESCRIPTORS done");
+}
+
+// Stages which need the previous frame: keypoint matching, object tracking and TTC computation
+void processFramePair(const PipelineConfig &config, DataFrame &prevFrame, DataFrame &currFrame, PipelineState &state, int frameIndex, std::vector<TTCResult> &results)
+{
+    double lapMs = traceClockMs();
+
+    /* MATCH KEYPOINT DESCRIPTORS */
+
+    // after a switch of the feature engine the previous frame is described again, so both frames use the same engine
+    FeatureSelectorState &selector = state.featureSelector;
+    if (currFrame.featureEngine >= 0 && prevFrame.featureEngine != currFrame.featureEngine)
+    {
+        prevFrame.featureEngine = currFrame.featureEngine;
+        computeEngineFeatures(selector.engines[currFrame.featureEngine], prevFrame.cameraImg, prevFrame.keypoints, prevFrame.descriptors);
+    }
+    string descriptorType = currFrame.featureEngine >= 0 ? selector.engines[currFrame.featureEngine].descriptorType : config.descriptorType;
+
+    vector<cv::DMatch> matches;
+    double matchTime;
+    string desCategory = descriptorType.compare("SIFT") == 0 ? "DES_HOG" : "DES_BINARY"; // DES_BINARY, DES_HOG
+
+    if (currFrame.bStatic)
+    { // reused keypoints correspond one-to-one to those of the previous frame
+        for (int i = 0; i < (int)currFrame.keypoints.size(); ++i)
+        {
+            matches.push_back(cv::DMatch(i, i, 0.0f));
+        }
+        matchTime = 0.0;
+    }
+    else if (config.bMatchByBox)
+    {
+        matchDescriptorsByBox(prevFrame, currFrame, matches, desCategory, config.matcherType, matchTime, config.selectorType, config.matchMinIoU, config.minDistRatio);
+    }
+    else
+    {
+        matchDescriptors(prevFrame.keypoints, currFrame.keypoints, prevFrame.descriptors, currFrame.descriptors,
+                         matches, desCategory, config.matcherType, matchTime, config.selectorType, config.minDistRatio);
+    }
+
+    // store matches in current data frame
+    currFrame.kptMatches = matches;
+
+    // assign enclosed keypoint matches to all bounding boxes at once
+    clusterKptMatchesWithROIs(currFrame.boundingBoxes, currFrame.keypoints, currFrame.kptMatches, currFrame.boxKptMatches);
+
+    traceLap(currFrame.trace, STAGE_MATCH, lapMs);
+    LOG_DEBUG("#7 : MATCH KEYPOINT DESCRIPTORS done");
+
+
+    /* TRACK 3D OBJECT BOUNDING BOXES */
+
+    // associate bounding boxes between current and previous frame using keypoint matches and predicted overlap
+    map<int, int> bbBestMatches;
+    matchBoundingBoxes(matches, bbBestMatches, prevFrame, currFrame, config.minKptVotes, config.trackMinIoU);
+
+    // store matches in current data frame
+    currFrame.bbMatches = bbBestMatches;
+    int firstNewTrackID = state.nextTrackID;
+    updateTracks(bbBestMatches, prevFrame, currFrame, state.nextTrackID);
+    if (config.bReidentify)
+    {
+        reidentifyTracks(config.trackMemoryPolicy, state.trackMemory, currFrame, firstNewTrackID, frameIndex);
+        rememberTracks(config.trackMemoryPolicy, state.trackMemory, currFrame, frameIndex);
+    }
+
+    traceLap(currFrame.trace, STAGE_TRACK, lapMs);
+    LOG_DEBUG("#8 : TRACK 3D OBJECT BOUNDING BOXES done");
+
+
+    /* COMPUTE TTC ON OBJECT IN FRONT */
+
+    // loop over all BB match pairs
+    vector<double> ttcDiffs; // relative difference between camera and Lidar TTC per object
+    for (auto it1 = currFrame.bbMatches.begin(); it1 != currFrame.bbMatches.end(); ++it1)
+    {
+        // find bounding boxes associates with current match
+        BoundingBox *prevBB = nullptr, *currBB = nullptr;
+        for (auto it2 = currFrame.boundingBoxes.begin(); it2 != currFrame.boundingBoxes.end(); ++it2)
+        {
+            if (it1->second == it2->boxID) // check wether current match partner corresponds to this BB
+            {
+                currBB = &(*it2);
+            }
+        }
+
+        for (auto it2 = prevFrame.boundingBoxes.begin(); it2 != prevFrame.boundingBoxes.end(); ++it2)
+        {
+            if (it1->first == it2->boxID) // check wether current match partner corresponds to this BB
+            {
+                prevBB = &(*it2);
+            }
+        }
+        if (currBB == nullptr || prevBB == nullptr)
+        {
+            continue;
+        }
+
+        // compute TTC for current match
+        if( currBB->lidarSummary.count>0 && prevBB->lidarSummary.count>0 ) // only compute TTC if we have Lidar points
+        {
+            double ttcLidar, ttcCamera;
+
+            ObjectCost cost;
+            cost.frameIndex = frameIndex;
+            cost.trackID = currBB->trackID;
+            cost.boxID = currBB->boxID;
+            cost.nLidarPoints = currBB->lidarSummary.count;
+
+            double medianTime = (double)cv::getTickCount();
+            CostProbe probe = startCostProbe(state.costs.bEnabled);
+            computeTTCLidar(prevBB->lidarSummary.xSketch, currBB->lidarSummary.xSketch, config.sensorFrameRate, ttcLidar);
+            stopCostProbe(probe, cost, COST_LIDAR_TTC);
+            medianTime = ((double)cv::getTickCount() - medianTime) / cv::getTickFrequency();
+            LOG_INFO("Track " << currBB->trackID << " : TTC Lidar " << ttcLidar << " s");
+
+            if (config.bLidarICP)
+            {
+                double ttcMedian = ttcLidar, closingVelocity;
+                double icpTime = (double)cv::getTickCount();
+                probe = startCostProbe(state.costs.bEnabled);
+                computeTTCLidarICP(prevBB->lidarPoints, currBB->lidarPoints, config.sensorFrameRate, ttcLidar, closingVelocity, state.icpTree);
+                stopCostProbe(probe, cost, COST_LIDAR_ICP);
+                icpTime = ((double)cv::getTickCount() - icpTime) / cv::getTickFrequency();
+                LOG_INFO("Track " << currBB->trackID << " : TTC Lidar ICP " << ttcLidar << " s (v = " << closingVelocity << " m/s) in " << 1000 * icpTime << " ms, median "
+                         << ttcMedian << " s in " << 1000 * medianTime << " ms (" << prevBB->lidarPoints.size() << "/" << currBB->lidarPoints.size() << " pts)");
+            }
+
+            string fusionReason;
+            // reused keypoints of a static frame carry no scale change, camera TTC is only computed on fresh features
+            bool bCameraTTC = false;
+            if (currFrame.bStatic)
+            {
+                countStaticSkip(state.fusionState);
+            }
+            else
+            {
+                bCameraTTC = needCameraTTC(config.fusionPolicy, state.fusionState, *currBB, currFrame.boundingBoxes, fusionReason);
+            }
+            ttcCamera = NAN;
+            if (bCameraTTC)
+            {
+                KptMatchPartition &boxKptMatches = currFrame.boxKptMatches;
+                size_t boxIdx = currBB - &currFrame.boundingBoxes[0];
+                probe = startCostProbe(state.costs.bEnabled);
+                currBB->kptMatches.assign(boxKptMatches.matches.begin() + boxKptMatches.offsets[boxIdx],
+                                          boxKptMatches.matches.begin() + boxKptMatches.offsets[boxIdx + 1]);
+                computeTTCCamera(prevFrame.keypoints, currFrame.keypoints, currBB->kptMatches, config.sensorFrameRate, ttcCamera);
+                stopCostProbe(probe, cost, COST_CAMERA_TTC);
+                long long nMatches = currBB->kptMatches.size();
+                cost.nMatches = nMatches;
+                cost.nPairs = nMatches > 1 ? (nMatches - 1) * (nMatches - 1) : 0;
+                LOG_INFO("Track " << currBB->trackID << " : TTC Camera " << ttcCamera << " s (" << fusionReason << ")");
+            }
+            updateFusionState(config.fusionPolicy, state.fusionState, currBB->trackID, ttcLidar, ttcCamera, bCameraTTC);
+
+            results.push_back({frameIndex, currBB->trackID, ttcLidar, ttcCamera});
+            if (state.costs.bEnabled)
+            {
+                recordObjectCost(state.costs, cost);
+            }
+            if (bCameraTTC && std::isfinite(ttcCamera) && std::isfinite(ttcLidar))
+            {
+                ttcDiffs.push_back(fabs(ttcCamera - ttcLidar) / max(fabs(ttcLidar), 1e-6));
+            }
+
+            if (config.bVisTTC)
+            {
+                double visStartMs = traceClockMs();
+                cv::Mat P_rect_00 = config.P_rect_00, R_rect_00 = config.R_rect_00, RT = config.RT;
+                cv::Mat visImg = currFrame.cameraImg.clone();
+                showLidarImgOverlay(visImg, currBB->lidarPoints, P_rect_00, R_rect_00, RT, &visImg);
+                cv::rectangle(visImg, cv::Point(currBB->roi.x, currBB->roi.y), cv::Point(currBB->roi.x + currBB->roi.width, currBB->roi.y + currBB->roi.height), cv::Scalar(0, 255, 0), 2);
+
+                char str[200];
+                sprintf(str, "TTC Lidar : %f s, TTC Camera : %f s", ttcLidar, ttcCamera);
+                putText(visImg, str, cv::Point2f(80, 50), cv::FONT_HERSHEY_PLAIN, 2, cv::Scalar(0,0,255));
+
+                string windowName = "Final Results : TTC";
+                cv::namedWindow(windowName, 4);
+                cv::imshow(windowName, visImg);
+                cout << "Press key to continue to next frame" << endl;
+                cv::waitKey(0);
+                lapMs += traceClockMs() - visStartMs; // waiting for the user is not part of the stage time
+            }
+        } // eof TTC computation
+    } // eof loop over all BB matches
+
+    /* SELECT FEATURE ENGINE FOR THE NEXT FRAME */
+
+    if (currFrame.featureEngine >= 0 && !currFrame.bStatic)
+    {
+        FeatureSignals signals;
+        signals.nMatches = matches.size();
+        signals.inlierRatio = matchInlierRatio(prevFrame.keypoints, currFrame.keypoints, matches); // all matches, before box filtering
+        if (!ttcDiffs.empty())
+        {
+            nth_element(ttcDiffs.begin(), ttcDiffs.begin() + ttcDiffs.size() / 2, ttcDiffs.end());
+            signals.ttcInconsistency = ttcDiffs[ttcDiffs.size() / 2];
+        }
+        updateFeatureSelector(config.featurePolicy, selector, signals, frameIndex);
+    }
+
+    traceLap(currFrame.trace, STAGE_TTC, lapMs);
+    currFrame.trace.doneMs = lapMs;
+    if (config.bRecordTrace)
+    {
+        if (state.traces.empty())
+        { // the first frame has no pairwise stages and completes with its per-frame stages
+            state.traces.push_back(prevFrame.trace);
+        }
+        state.traces.push_back(currFrame.trace);
+    }
+}
+
+// Offline mode for recorded data: the per-frame stages of many frames run in parallel and finish out of order,
+// the pairwise stages run in recording order as soon as both neighbours of a pair are ready.
+void runOffline(const PipelineConfig &config, int nThreads, PipelineState &state, std::vector<TTCResult> &results)
+{
+    size_t nFrames = config.frameFiles.size();
+    nThreads = max(1, nThreads);
+    size_t window = 2 * nThreads;   // max. no. of frames in flight, bounds memory use
+
+    mutex mtx;
+    condition_variable cond;
+    map<size_t, DataFrame> readyFrames; // processed frames waiting for their pairwise stages
+    size_t nextToClaim = 0, nextToPair = 0;
+
+    auto worker = [&]() {
+        while (true)
+        {
+            size_t frameIdx;
+            {
+                unique_lock<mutex> lock(mtx);
+                cond.wait(lock, [&]() { return nextToClaim >= nFrames || nextToClaim < nextToPair + window; });
+                if (nextToClaim >= nFrames)
+                {
+                    return;
+                }
+                frameIdx = nextToClaim++;
+            }
+
+            DataFrame frame;
+            loadFrame(config, frameIdx, frame);
+            processFrame(config, frame);
+
+            {
+                lock_guard<mutex> lock(mtx);
+                readyFrames[frameIdx] = std::move(frame);
+            }
+            cond.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 0; i < nThreads; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    // pairwise stages carry tracks from frame to frame and therefore run sequentially, in order
+    DataFrame prevFrame;
+    for (nextToPair = 0; nextToPair < nFrames;)
+    {
+        DataFrame currFrame;
+        {
+            unique_lock<mutex> lock(mtx);
+            cond.wait(lock, [&]() { return readyFrames.count(nextToPair) > 0; });
+            currFrame = std::move(readyFrames[nextToPair]);
+            readyFrames.erase(nextToPair);
+        }
+
+        if (nextToPair > 0)
+        {
+            processFramePair(config, prevFrame, currFrame, state, nextToPair, results);
+        }
+        prevFrame = std::move(currFrame);
+
+        {
+            lock_guard<mutex> lock(mtx);
+            ++nextToPair;
+        }
+        cond.notify_all();
+    }
+
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+}
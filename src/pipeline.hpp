@@ -0,0 +1,103 @@
+
+#ifndef pipeline_hpp
+#define pipeline_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "frameReader.hpp"
+#include "fusionPolicy.hpp"
+#include "sceneChange.hpp"
+#include "lidarIcp.hpp"
+#include "featureSelector.hpp"
+#include "costAttribution.hpp"
+#include "thresholdController.hpp"
+#include "trackMemory.hpp"
+
+struct PipelineConfig { // all settings of the processing pipeline
+
+    // data location
+    std::vector<FrameFiles> frameFiles; // image and Lidar file of every frame, in recording order
+    double sensorFrameRate = 10.0;      // frames per second for Lidar and camera
+
+    // object detection
+    std::string yoloBasePath, yoloClassesFile, yoloModelConfiguration, yoloModelWeights;
+    std::string yoloClassMapFile;         // COCO class of every class output of a pruned model (see usePrunedDetector), empty for the full model
+    float confThreshold = 0.2;
+    float nmsThreshold = 0.4;
+    int yoloInputSize = 416;              // network input resolution (multiple of 32)
+    bool bDetectObjects = true;           // false if the boxes are delivered by a separate detector process
+
+    // Lidar
+    float minZ = -1.5, maxZ = -0.9, minX = 2.0, maxX = 20.0, maxY = 2.0, minR = 0.1; // focus on ego lane
+    float shrinkFactor = 0.10; // shrinks each bounding box by the given percentage to avoid 3D object merging at the edges of an ROI
+
+    // calibration data for camera and lidar
+    cv::Mat P_rect_00, R_rect_00, RT;
+
+    // keypoints and matching
+    std::string detectorType = "AKAZE";   // SHITOMASI, HARRIS, FAST, BRISK, ORB, AKAZE, SIFT
+    std::string descriptorType = "AKAZE"; // BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT
+    std::string matcherType = "MAT_BF";   // MAT_BF, MAT_FLANN, MAT_GEMM (float descriptors)
+    std::string selectorType = "SEL_KNN"; // SEL_NN, SEL_KNN
+    bool bLimitKpts = false;              // limit number of keypoints (helpful for debugging and learning)
+    int maxKeypoints = 50;
+    bool bAdaptiveThreshold = false;      // adjust the detector threshold per frame to hold a keypoint count instead of limiting afterwards
+    ThresholdPolicy thresholdPolicy;
+    double minDistRatio = 0.8;            // ratio test threshold of the kNN selector
+    int descThreads = 1;                  // describe keypoint chunks on several threads, keep at 1 when frames run in parallel (runOffline)
+    bool bAdaptiveFeatures = false;       // switch between feature engines per scene instead of the fixed detector/descriptor
+    FeatureSelectorPolicy featurePolicy;
+    bool bMatchByBox = true;              // associate boxes first and only match keypoints between associated boxes
+    double matchMinIoU = 0.3;             // min. overlap between predicted previous box and current box for matching
+
+    // tracking and TTC
+    int minKptVotes = 5;                  // min. no. of keypoint matches before keypoint votes take part in the association
+    double trackMinIoU = 0.1;             // min. overlap between predicted previous box and current box for tracking
+    bool bReidentify = false;             // give new boxes the identity of a recently lost track with the same appearance
+    TrackMemoryPolicy trackMemoryPolicy;
+    bool bLidarICP = false;               // estimate Lidar TTC by scan-to-scan ICP instead of the median forward distance; ICP is more
+                                          // robust to outliers on the object edges but needs the points of every box copied out of the scan
+    bool bKeepLidarPoints = false;        // copy Lidar points into their boxes, always done for ICP and the TTC visualization
+    FusionPolicy fusionPolicy;            // decides for which objects camera TTC is computed next to Lidar TTC
+    bool bReuseStatic = true;             // reuse detections and features of the previous frame when the scene is near-static
+    StaticSceneConfig staticConfig;
+
+    bool bVis = false;                    // visualize intermediate results
+    bool bVisTTC = false;                 // show the TTC result of every object and wait for a key press
+    bool bRecordTrace = false;            // record the stage times of every frame in PipelineState::traces
+};
+
+struct PipelineState { // state carried from one frame pair to the next
+    int nextTrackID = 0;        // identifier assigned to the next newly created track
+    KdTree icpTree;             // kd-tree reused across all ICP alignments
+    FusionState fusionState;    // per-track fusion history and camera work statistics
+    SceneSignature prevSignature, currSignature;
+    int staticFrames = 0;       // no. of consecutive frames flagged as static
+    FeatureSelectorState featureSelector; // feature engine in use and its switching history
+    CostAttribution costs;      // most expensive objects of the run, if enabled
+    std::vector<FrameTrace> traces; // stage times of all frames, if recorded
+    ThresholdState detectorThreshold; // detector thresholds adjusted from frame to frame
+    TrackMemory trackMemory;    // recent descriptors of all tracks, if re-identification is enabled
+};
+
+struct TTCResult { // TTC estimates of one tracked object in one frame
+    int frameIndex;
+    int trackID;
+    double ttcLidar;
+    double ttcCamera;           // NAN if camera TTC has not been computed
+};
+
+PipelineConfig createDefaultConfig(std::string dataPath);
+bool keepLidarPoints(const PipelineConfig &config);
+void usePrunedDetector(PipelineConfig &config, std::string modelName);
+void detectFrameKeypoints(const PipelineConfig &config, cv::Mat &img, std::vector<cv::KeyPoint> &keypoints, ThresholdState *thresholdState=nullptr);
+bool loadFrame(const PipelineConfig &config, size_t frameIdx, DataFrame &frame, FrameReader *frameReader=nullptr);
+void processFrame(const PipelineConfig &config, DataFrame &frame, DataFrame *prevFrame=nullptr, PipelineState *state=nullptr);
+void processFramePair(const PipelineConfig &config, DataFrame &prevFrame, DataFrame &currFrame, PipelineState &state, int frameIndex, std::vector<TTCResult> &results);
+void runOffline(const PipelineConfig &config, int nThreads, PipelineState &state, std::vector<TTCResult> &results);
+
+#endif /* pipeline_hpp */
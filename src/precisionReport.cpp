@@ -0,0 +1,210 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "fusionKernels.hpp"
+#include "camFusion.hpp"
+#include "pipeline.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+template <typename T>
+struct KernelRun { // results of the fusion kernels in one precision on one frame
+    vector<LidarPointT<T>> points;                 // cropped point cloud
+    vector<cv::Point_<T>> imgPoints;
+    vector<int> boxIndices;
+    vector<vector<LidarPointT<T>>> clusters;       // Lidar points per bounding box
+    double timeMs = 0.0;                           // crop, projection and clustering
+};
+
+struct Deviation { // max. and mean absolute deviation of float against double
+    double max = 0.0, sum = 0.0;
+    int n = 0;
+    void add(double d)
+    {
+        max = std::max(max, d);
+        sum += d;
+        ++n;
+    }
+    double mean() const { return n > 0 ? sum / n : 0.0; }
+};
+
+template <typename T>
+static void runKernels(const PipelineConfig &config, const vector<LidarPoint> &rawPoints, const vector<BoundingBox> &boxes, KernelRun<T> &run)
+{
+    run.points.clear();
+    for (auto &pt : rawPoints)
+    {
+        run.points.push_back({(T)pt.x, (T)pt.y, (T)pt.z, (T)pt.r});
+    }
+    vector<cv::Rect> rois;
+    for (auto &box : boxes)
+    {
+        rois.push_back(box.roi);
+    }
+
+    double t = (double)cv::getTickCount();
+    cropLidarPointsT<T>(run.points, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ, config.minR);
+    cv::Matx<T, 3, 4> projection = combineProjection<T>(config.P_rect_00, config.R_rect_00, config.RT);
+    projectLidarPoints(run.points, projection, run.imgPoints);
+    assignPointsToBoxes(run.imgPoints, rois, (T)config.shrinkFactor, run.boxIndices);
+    run.clusters.assign(boxes.size(), vector<LidarPointT<T>>());
+    for (size_t i = 0; i < run.points.size(); ++i)
+    {
+        if (run.boxIndices[i] >= 0)
+        {
+            run.clusters[run.boxIndices[i]].push_back(run.points[i]);
+        }
+    }
+    run.timeMs = 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+}
+
+static double relativeDeviation(double ttcFloat, double ttcDouble)
+{
+    return fabs(ttcFloat - ttcDouble) / max(fabs(ttcDouble), 1e-6);
+}
+
+static void printDeviation(const string &name, const Deviation &dev, const string &unit)
+{
+    cout << "  " << left << setw(28) << name << right << " max " << setw(12) << dev.max << " " << unit
+         << ", mean " << setw(12) << dev.mean() << " " << unit << " (" << dev.n << " samples)" << endl;
+}
+
+/* PRECISION REPORT: numeric accuracy and speed of the float fusion kernels against the double reference on the recording */
+// usage: precision_report [max. relative TTC deviation]
+int main(int argc, const char *argv[])
+{
+    string dataPath = "../";
+    PipelineConfig config = createDefaultConfig(dataPath);
+    config.bVisTTC = false;
+    config.bReuseStatic = false;
+    setLogLevel(LOG_LEVEL_WARN);
+
+    double maxTTCDeviation = argc > 1 ? stod(argv[1]) : 1e-3;
+
+    Deviation pixelDev, ttcLidarDev, ttcCameraDev, ttcSketchDev;
+    int nPoints = 0, nCropMismatches = 0, nBoxMismatches = 0, nClusters = 0, nApproximateClusters = 0;
+    double timeFloat = 0.0, timeDouble = 0.0;
+
+    PipelineState state;
+    vector<TTCResult> results;
+    DataFrame prevFrame;
+    KernelRun<float> prevFloat, currFloat;
+    KernelRun<double> prevDouble, currDouble;
+    for (size_t frameIdx = 0; frameIdx < config.frameFiles.size(); ++frameIdx)
+    {
+        // boxes, keypoints and matches come from the regular pipeline, the kernels run again on the uncropped cloud
+        DataFrame frame;
+        loadFrame(config, frameIdx, frame);
+        vector<LidarPoint> rawPoints = frame.lidarPoints;
+        processFrame(config, frame);
+        if (frameIdx > 0)
+        {
+            processFramePair(config, prevFrame, frame, state, frameIdx, results);
+        }
+
+        runKernels(config, rawPoints, frame.boundingBoxes, currFloat);
+        runKernels(config, rawPoints, frame.boundingBoxes, currDouble);
+        timeFloat += currFloat.timeMs;
+        timeDouble += currDouble.timeMs;
+
+        // projection and box assignment, compared point by point if both precisions kept the same points
+        nPoints += currDouble.points.size();
+        if (currFloat.points.size() != currDouble.points.size())
+        {
+            nCropMismatches += abs((int)currFloat.points.size() - (int)currDouble.points.size());
+        }
+        else
+        {
+            for (size_t i = 0; i < currDouble.points.size(); ++i)
+            {
+                cv::Point2d diff((double)currFloat.imgPoints[i].x - currDouble.imgPoints[i].x, (double)currFloat.imgPoints[i].y - currDouble.imgPoints[i].y);
+                if (std::isfinite(diff.x) && std::isfinite(diff.y))
+                {
+                    pixelDev.add(cv::norm(diff));
+                }
+                nBoxMismatches += currFloat.boxIndices[i] != currDouble.boxIndices[i];
+            }
+        }
+
+        // Lidar and camera TTC of all tracked objects
+        for (auto &bbMatch : frame.bbMatches)
+        {
+            int prevIdx = -1, currIdx = -1;
+            for (size_t b = 0; b < prevFrame.boundingBoxes.size(); ++b)
+            {
+                prevIdx = prevFrame.boundingBoxes[b].boxID == bbMatch.first ? b : prevIdx;
+            }
+            for (size_t b = 0; b < frame.boundingBoxes.size(); ++b)
+            {
+                currIdx = frame.boundingBoxes[b].boxID == bbMatch.second ? b : currIdx;
+            }
+            if (prevIdx < 0 || currIdx < 0)
+            {
+                continue;
+            }
+
+            if (!prevFloat.clusters[prevIdx].empty() && !currFloat.clusters[currIdx].empty() &&
+                !prevDouble.clusters[prevIdx].empty() && !currDouble.clusters[currIdx].empty())
+            {
+                float ttcFloat = computeTTCLidarT<float>(prevFloat.clusters[prevIdx], currFloat.clusters[currIdx], config.sensorFrameRate);
+                double ttcDouble = computeTTCLidarT<double>(prevDouble.clusters[prevIdx], currDouble.clusters[currIdx], config.sensorFrameRate);
+                if (std::isfinite(ttcFloat) && std::isfinite(ttcDouble))
+                {
+                    ttcLidarDev.add(relativeDeviation(ttcFloat, ttcDouble));
+                }
+
+                // median of the quantile sketches filled by the pipeline against the exact median of the sorted points
+                const QuantileSketch &prevSketch = prevFrame.boundingBoxes[prevIdx].lidarSummary.xSketch;
+                const QuantileSketch &currSketch = frame.boundingBoxes[currIdx].lidarSummary.xSketch;
+                double ttcSketch;
+                computeTTCLidar(prevSketch, currSketch, config.sensorFrameRate, ttcSketch);
+                nClusters += 2;
+                nApproximateClusters += (prevSketch.n >= (uint64_t)prevSketch.k) + (currSketch.n >= (uint64_t)currSketch.k);
+                if (std::isfinite(ttcSketch) && std::isfinite(ttcDouble))
+                {
+                    ttcSketchDev.add(relativeDeviation(ttcSketch, ttcDouble));
+                }
+            }
+
+            KptMatchPartition &partition = frame.boxKptMatches;
+            vector<cv::DMatch> boxMatches(partition.matches.begin() + partition.offsets[currIdx], partition.matches.begin() + partition.offsets[currIdx + 1]);
+            float ttcFloat = computeTTCCameraT<float>(prevFrame.keypoints, frame.keypoints, boxMatches, config.sensorFrameRate);
+            double ttcDouble = computeTTCCameraT<double>(prevFrame.keypoints, frame.keypoints, boxMatches, config.sensorFrameRate);
+            if (std::isfinite(ttcFloat) && std::isfinite(ttcDouble))
+            {
+                ttcCameraDev.add(relativeDeviation(ttcFloat, ttcDouble));
+            }
+        }
+
+        prevFrame = std::move(frame);
+        std::swap(prevFloat, currFloat);
+        std::swap(prevDouble, currDouble);
+    }
+
+    size_t nFrames = config.frameFiles.size();
+    cout << "=== float against double fusion kernels, " << nFrames << " frames, " << nPoints << " Lidar points ===" << endl;
+    printDeviation("projection", pixelDev, "px");
+    cout << "  " << left << setw(28) << "crop / box assignment" << right << " " << nCropMismatches << " points cropped differently, "
+         << nBoxMismatches << " points assigned to a different box" << endl;
+    printDeviation("TTC Lidar", ttcLidarDev, "(rel.)");
+    printDeviation("TTC camera", ttcCameraDev, "(rel.)");
+    printDeviation("TTC Lidar sketch vs. exact", ttcSketchDev, "(rel.)");
+    cout << "  " << left << setw(28) << "approximate sketches" << right << " " << nApproximateClusters << " of " << nClusters
+         << " clusters exceed the exact capacity of the sketch" << endl;
+    cout << "  " << left << setw(28) << "crop, projection, clustering" << right << fixed << setprecision(3)
+         << " float " << timeFloat / nFrames << " ms, double " << timeDouble / nFrames << " ms per frame" << endl;
+
+    bool bPass = ttcLidarDev.max <= maxTTCDeviation && ttcCameraDev.max <= maxTTCDeviation;
+    cout << "TTC deviation " << (bPass ? "within" : "EXCEEDS") << " tolerance of " << maxTTCDeviation << endl;
+    flushLog();
+    return bPass ? 0 : 1;
+}
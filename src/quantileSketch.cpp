@@ -0,0 +1,152 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include "quantileSketch.hpp"
+
+using namespace std;
+
+// capacity of level h, shrinking by 2/3 per level below the top
+static size_t levelCapacity(const QuantileSketch &sketch, size_t h)
+{
+    size_t depth = sketch.compactors.size() - 1 - h;
+    return max<size_t>(2, (size_t)ceil(sketch.k * pow(2.0 / 3.0, (double)depth)));
+}
+
+static uint32_t flipCoin(QuantileSketch &sketch)
+{
+    uint32_t &x = sketch.coin;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x & 1;
+}
+
+// compact every full level: sort it and promote every other item to the next level with twice the weight
+static void compress(QuantileSketch &sketch)
+{
+    for (size_t h = 0; h < sketch.compactors.size(); ++h)
+    {
+        if (sketch.compactors[h].size() < levelCapacity(sketch, h))
+        {
+            continue;
+        }
+        if (h + 1 == sketch.compactors.size())
+        {
+            sketch.compactors.emplace_back(); // capacities of the lower levels shrink accordingly
+        }
+
+        vector<double> &level = sketch.compactors[h];
+        sort(level.begin(), level.end());
+        double leftover = level.back();
+        bool bOdd = level.size() % 2 == 1;
+        size_t end = bOdd ? level.size() - 1 : level.size();
+        vector<double> &next = sketch.compactors[h + 1];
+        for (size_t i = flipCoin(sketch); i < end; i += 2)
+        {
+            next.push_back(level[i]);
+        }
+        level.clear();
+        if (bOdd)
+        {
+            level.push_back(leftover);
+        }
+    }
+}
+
+void sketchInsert(QuantileSketch &sketch, double value)
+{
+    if (sketch.compactors.empty())
+    {
+        sketch.compactors.emplace_back();
+    }
+    sketch.compactors[0].push_back(value);
+    ++sketch.n;
+    sketch.bFinalized = false;
+    if (sketch.compactors[0].size() >= levelCapacity(sketch, 0))
+    {
+        compress(sketch);
+    }
+}
+
+void sketchMerge(QuantileSketch &sketch, const QuantileSketch &other)
+{
+    if (other.compactors.size() > sketch.compactors.size())
+    {
+        sketch.compactors.resize(other.compactors.size());
+    }
+    for (size_t h = 0; h < other.compactors.size(); ++h)
+    {
+        sketch.compactors[h].insert(sketch.compactors[h].end(), other.compactors[h].begin(), other.compactors[h].end());
+    }
+    sketch.n += other.n;
+    sketch.bFinalized = false;
+    compress(sketch);
+}
+
+static void buildCdf(const QuantileSketch &sketch, vector<pair<double, uint64_t>> &cdf)
+{
+    cdf.clear();
+    for (size_t h = 0; h < sketch.compactors.size(); ++h)
+    {
+        for (double value : sketch.compactors[h])
+        {
+            cdf.emplace_back(value, (uint64_t)1 << h);
+        }
+    }
+    sort(cdf.begin(), cdf.end());
+    uint64_t cumulative = 0;
+    for (auto &item : cdf)
+    {
+        cumulative += item.second;
+        item.second = cumulative;
+    }
+}
+
+// sort the retained items once, so quantile queries are a binary search over at most a few k items
+void finalizeSketch(QuantileSketch &sketch)
+{
+    if (!sketch.bFinalized)
+    {
+        buildCdf(sketch, sketch.cdf);
+        sketch.bFinalized = true;
+    }
+}
+
+// value at the given rank, i.e. the first item whose cumulative weight exceeds it
+static double valueAtRank(const vector<pair<double, uint64_t>> &cdf, uint64_t rank)
+{
+    auto it = upper_bound(cdf.begin(), cdf.end(), rank, [](uint64_t r, const pair<double, uint64_t> &item) { return r < item.second; });
+    return it != cdf.end() ? it->first : cdf.back().first;
+}
+
+// q-quantile interpolated between neighbouring ranks, identical to the sorted-array median while the sketch is exact; NAN if empty
+double sketchQuantile(const QuantileSketch &sketch, double q)
+{
+    vector<pair<double, uint64_t>> localCdf;
+    if (!sketch.bFinalized)
+    {
+        buildCdf(sketch, localCdf);
+    }
+    const vector<pair<double, uint64_t>> &cdf = sketch.bFinalized ? sketch.cdf : localCdf;
+    if (cdf.empty())
+    {
+        return NAN;
+    }
+
+    double rank = min(max(q, 0.0), 1.0) * (cdf.back().second - 1);
+    uint64_t lower = (uint64_t)floor(rank), upper = (uint64_t)ceil(rank);
+    double vLower = valueAtRank(cdf, lower), vUpper = valueAtRank(cdf, upper);
+    return vLower + (rank - lower) * (vUpper - vLower);
+}
+
+// no. of retained items
+size_t sketchSize(const QuantileSketch &sketch)
+{
+    size_t size = 0;
+    for (auto &level : sketch.compactors)
+    {
+        size += level.size();
+    }
+    return size;
+}
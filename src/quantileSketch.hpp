@@ -0,0 +1,30 @@
+
+#ifndef quantileSketch_hpp
+#define quantileSketch_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// KLL quantile sketch: compactors of geometrically decreasing capacity, items on level h weigh 2^h.
+// Exact for fewer than k values, afterwards the rank error is about 1.7 / k with high probability.
+// Sketches of several point sets merge into a sketch of their union with the same error bound.
+// Items are stored in double, so the quantiles of exact sketches equal the median of computeTTCLidar in either FUSION_SCALAR.
+struct QuantileSketch {
+    int k = 1024;                                  // capacity of the top level, larger than the Lidar clusters of vehicles up to 20 m
+    uint64_t n = 0;                                // no. of values inserted
+    std::vector<std::vector<double>> compactors;   // items per level
+    uint32_t coin = 0x9e3779b9;                    // xorshift state choosing the half kept on compaction
+
+    std::vector<std::pair<double, uint64_t>> cdf;  // sorted items with cumulative weights, built by finalizeSketch
+    bool bFinalized = false;
+};
+
+void sketchInsert(QuantileSketch &sketch, double value);
+void sketchMerge(QuantileSketch &sketch, const QuantileSketch &other);
+void finalizeSketch(QuantileSketch &sketch);
+double sketchQuantile(const QuantileSketch &sketch, double q);
+size_t sketchSize(const QuantileSketch &sketch);
+
+#endif /* quantileSketch_hpp */
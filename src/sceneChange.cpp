@@ -0,0 +1,108 @@
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "sceneChange.hpp"
+
+using namespace std;
+
+// summarize an image by a small grayscale thumbnail and a Lidar scan by a histogram of horizontal ranges
+// and the median distance of the points in the ego lane (same limits as cropLidarPoints)
+void computeSceneSignature(const StaticSceneConfig &config, cv::Mat &img, std::vector<LidarPoint> &lidarPoints,
+                           float minX, float maxX, float maxY, float minZ, float maxZ, float minR, SceneSignature &signature)
+{
+    cv::Mat imgGray;
+    cv::cvtColor(img, imgGray, cv::COLOR_BGR2GRAY);
+    cv::resize(imgGray, signature.thumbnail, config.thumbnailSize, 0, 0, cv::INTER_AREA);
+
+    int nBins = (int)ceil(config.histMaxRange / config.histBinSize);
+    signature.lidarHistogram.assign(nBins, 0.0f);
+    for (auto &pt : lidarPoints)
+    {
+        float range = sqrt(pt.x * pt.x + pt.y * pt.y);
+        int bin = (int)(range / config.histBinSize);
+        if (bin < nBins)
+        {
+            signature.lidarHistogram[bin] += 1.0f;
+        }
+    }
+    if (!lidarPoints.empty())
+    {
+        for (auto &count : signature.lidarHistogram)
+        {
+            count /= lidarPoints.size();
+        }
+    }
+
+    // the preceding vehicle dominates the ego lane but only moves a few percent of the histogram mass of the whole scan
+    vector<double> egoLaneX;
+    for (auto &pt : lidarPoints)
+    {
+        if (pt.x >= minX && pt.x <= maxX && pt.z >= minZ && pt.z <= maxZ && pt.z <= 0.0 && fabs(pt.y) <= maxY && pt.r >= minR)
+        {
+            egoLaneX.push_back(pt.x);
+        }
+    }
+    signature.egoLaneDistance = NAN;
+    if (!egoLaneX.empty())
+    {
+        auto med = egoLaneX.begin() + egoLaneX.size() / 2;
+        nth_element(egoLaneX.begin(), med, egoLaneX.end());
+        signature.egoLaneDistance = *med;
+    }
+}
+
+// A frame is static only if both camera and Lidar see (almost) no change. The ego-lane distance guards TTC:
+// an object in front which approaches or recedes changes it even if image and histogram barely change, so such frames are never reused.
+bool isStaticScene(const StaticSceneConfig &config, SceneSignature &prevSignature, SceneSignature &currSignature, int &staticFrames)
+{
+    bool bStatic = !prevSignature.thumbnail.empty() && prevSignature.lidarHistogram.size() == currSignature.lidarHistogram.size();
+    if (bStatic)
+    {
+        cv::Mat diff;
+        cv::absdiff(prevSignature.thumbnail, currSignature.thumbnail, diff);
+        double imageDiff = cv::mean(diff)[0];
+
+        double lidarDiff = 0.0;
+        for (size_t i = 0; i < currSignature.lidarHistogram.size(); ++i)
+        {
+            lidarDiff += fabs(currSignature.lidarHistogram[i] - prevSignature.lidarHistogram[i]);
+        }
+
+        double prevDist = prevSignature.egoLaneDistance, currDist = currSignature.egoLaneDistance;
+        bool bEgoLaneStatic = std::isnan(prevDist) ? std::isnan(currDist) : fabs(currDist - prevDist) <= config.maxEgoLaneShift;
+
+        bStatic = imageDiff <= config.maxImageDiff && lidarDiff <= config.maxLidarDiff && bEgoLaneStatic;
+    }
+
+    // refresh everything periodically, so errors cannot accumulate over long stops
+    if (bStatic && staticFrames < config.maxStaticFrames)
+    {
+        ++staticFrames;
+        return true;
+    }
+    staticFrames = 0;
+    return false;
+}
+
+// reuse object detections, keypoints and descriptors of the previous frame for a near-static current frame
+void reuseFrameResults(DataFrame &prevFrame, DataFrame &currFrame)
+{
+    currFrame.boundingBoxes.clear();
+    for (auto &prevBB : prevFrame.boundingBoxes)
+    {
+        BoundingBox bb;
+        bb.boxID = prevBB.boxID;
+        bb.roi = prevBB.roi;
+        bb.classID = prevBB.classID;
+        bb.confidence = prevBB.confidence;
+        currFrame.boundingBoxes.push_back(bb);
+    }
+
+    currFrame.keypoints = prevFrame.keypoints;
+    currFrame.descriptors = prevFrame.descriptors;
+    currFrame.featureEngine = prevFrame.featureEngine;
+    currFrame.bStatic = true;
+}
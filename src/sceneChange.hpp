@@ -0,0 +1,33 @@
+
+#ifndef sceneChange_hpp
+#define sceneChange_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <cmath>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+struct StaticSceneConfig { // thresholds for flagging a frame as near-identical to its predecessor
+
+    cv::Size thumbnailSize = cv::Size(64, 20); // size of the grayscale thumbnail compared between frames
+    double maxImageDiff = 2.0;                 // max. mean absolute thumbnail difference in gray levels
+    double maxLidarDiff = 0.05;                // max. L1 distance between normalized Lidar range histograms
+    float histBinSize = 0.5f, histMaxRange = 40.0f; // range histogram layout in [m]
+    double maxEgoLaneShift = 0.05;             // max. change of the median forward distance in the ego lane in [m]
+    int maxStaticFrames = 5;                   // force a full refresh after this many consecutive static frames
+};
+
+struct SceneSignature { // cheap summary of a frame used for change detection
+    cv::Mat thumbnail;                 // low-resolution grayscale image
+    std::vector<float> lidarHistogram; // normalized histogram of horizontal Lidar ranges
+    double egoLaneDistance = NAN;      // median forward distance of the Lidar points in the ego lane in [m], NAN if there are none
+};
+
+void computeSceneSignature(const StaticSceneConfig &config, cv::Mat &img, std::vector<LidarPoint> &lidarPoints,
+                           float minX, float maxX, float maxY, float minZ, float maxZ, float minR, SceneSignature &signature);
+bool isStaticScene(const StaticSceneConfig &config, SceneSignature &prevSignature, SceneSignature &currSignature, int &staticFrames);
+void reuseFrameResults(DataFrame &prevFrame, DataFrame &currFrame);
+
+#endif /* sceneChange_hpp */
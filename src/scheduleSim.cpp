@@ -0,0 +1,345 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <queue>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include "stageTrace.hpp"
+#include "latencyHistogram.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+struct SchedulePolicy { // scheduling alternative replayed by the simulator
+    string name;
+    int nThreads = 1;            // workers for the per-frame stages (and the pairwise stages without a dedicated thread)
+    int pipelineDepth = 1;       // max. no. of frames between admission and completion of their pairwise stages
+    bool bPairThread = false;    // pairwise stages run on an extra thread, as in runOffline
+    bool bPriorityTTC = false;   // ready pairwise stages are started before any per-frame work
+    int detectEvery = 1;         // run object detection on every n-th frame only, the others reuse the boxes
+    double maxQueueMs = 0.0;     // drop frames which waited longer for admission (0 = never drop)
+};
+
+struct SimResult {
+    LatencyHistogram latency;    // completion of the pairwise stages relative to frame arrival
+    int completed = 0;
+    int dropped = 0;
+    double makespanMs = 0.0;     // from the first arrival to the last completion
+    double throughput = 0.0;     // completed frames per second
+};
+
+struct SimJob {
+    int frame;
+    bool bPair;                  // pairwise stages, otherwise per-frame stages
+};
+
+struct SimEvent { // completion of a job
+    double timeMs;
+    SimJob job;
+    bool operator>(const SimEvent &other) const { return timeMs > other.timeMs; }
+};
+
+// Discrete-event replay of the recorded stage times under the given policy. Frames arrive at the sensor rate,
+// or on demand as soon as the pipeline depth admits them if the rate is 0. Per-frame stages of different frames
+// run in parallel, the pairwise stages of a frame need its per-frame stages and the pairwise stages of its predecessor.
+static void simulate(const vector<FrameTrace> &traces, const SchedulePolicy &policy, double sensorRate, double overheadMs, SimResult &result)
+{
+    int nFrames = traces.size();
+    vector<double> frameCost(nFrames), pairCost(nFrames), arrival(nFrames, 0.0);
+    for (int i = 0; i < nFrames; ++i)
+    {
+        frameCost[i] = frameStagesMs(traces[i]) + overheadMs;
+        if (policy.detectEvery > 1 && i % policy.detectEvery != 0)
+        {
+            frameCost[i] -= traces[i].stageMs[STAGE_DETECT];
+        }
+        pairCost[i] = pairStagesMs(traces[i]);
+        arrival[i] = sensorRate > 0.0 ? 1000.0 * i / sensorRate : 0.0;
+    }
+
+    vector<int> prevAdmitted(nFrames, -1), nextAdmitted(nFrames, -1);
+    vector<bool> frameDone(nFrames, false), pairDone(nFrames, false);
+    vector<double> latencyStart(nFrames, 0.0);
+    vector<SimJob> ready;
+    priority_queue<SimEvent, vector<SimEvent>, greater<SimEvent>> events;
+    int freeWorkers = max(1, policy.nThreads);
+    bool bPairThreadFree = policy.bPairThread;
+    int nextFrame = 0, inFlight = 0, lastAdmitted = -1;
+    double t = 0.0, firstArrival = -1.0, lastCompletion = 0.0;
+
+    result = SimResult();
+    auto complete = [&](int f) {
+        pairDone[f] = true;
+        --inFlight;
+        ++result.completed;
+        result.latency.record((uint64_t)(1000.0 * (t - latencyStart[f])));
+        lastCompletion = t;
+        int next = nextAdmitted[f];
+        if (next >= 0 && frameDone[next])
+        {
+            ready.push_back({next, true});
+        }
+    };
+
+    while (true)
+    {
+        // admit arrived frames while the pipeline depth allows
+        while (nextFrame < nFrames && inFlight < policy.pipelineDepth)
+        {
+            double arrived = sensorRate > 0.0 ? arrival[nextFrame] : t;
+            if (arrived > t)
+            {
+                break;
+            }
+            int f = nextFrame++;
+            if (policy.maxQueueMs > 0.0 && t - arrived > policy.maxQueueMs)
+            {
+                ++result.dropped;
+                continue;
+            }
+            latencyStart[f] = arrived;
+            firstArrival = firstArrival < 0.0 ? arrived : firstArrival;
+            prevAdmitted[f] = lastAdmitted;
+            if (lastAdmitted >= 0)
+            {
+                nextAdmitted[lastAdmitted] = f;
+            }
+            lastAdmitted = f;
+            ++inFlight;
+            ready.push_back({f, false});
+        }
+
+        // start ready jobs in priority order on free threads
+        stable_sort(ready.begin(), ready.end(), [&](const SimJob &a, const SimJob &b) {
+            if (policy.bPriorityTTC && a.bPair != b.bPair)
+            {
+                return a.bPair;
+            }
+            return a.frame < b.frame;
+        });
+        vector<SimJob> waiting;
+        for (auto &job : ready)
+        {
+            bool bOnPairThread = job.bPair && policy.bPairThread;
+            if (bOnPairThread ? !bPairThreadFree : freeWorkers == 0)
+            {
+                waiting.push_back(job);
+                continue;
+            }
+            if (bOnPairThread)
+            {
+                bPairThreadFree = false;
+            }
+            else
+            {
+                --freeWorkers;
+            }
+            events.push({t + (job.bPair ? pairCost[job.frame] : frameCost[job.frame]), job});
+        }
+        ready.swap(waiting);
+
+        // advance to the next completion or arrival
+        double next = events.empty() ? numeric_limits<double>::infinity() : events.top().timeMs;
+        if (sensorRate > 0.0 && nextFrame < nFrames && inFlight < policy.pipelineDepth)
+        {
+            next = min(next, max(arrival[nextFrame], t));
+        }
+        if (next == numeric_limits<double>::infinity())
+        {
+            break;
+        }
+        t = next;
+
+        while (!events.empty() && events.top().timeMs <= t)
+        {
+            SimJob job = events.top().job;
+            events.pop();
+            if (job.bPair && policy.bPairThread)
+            {
+                bPairThreadFree = true;
+            }
+            else
+            {
+                ++freeWorkers;
+            }
+
+            if (job.bPair)
+            {
+                complete(job.frame);
+            }
+            else
+            {
+                frameDone[job.frame] = true;
+                int prev = prevAdmitted[job.frame];
+                if (prev < 0)
+                { // the first frame has no pairwise stages
+                    complete(job.frame);
+                }
+                else if (pairDone[prev])
+                {
+                    ready.push_back({job.frame, true});
+                }
+            }
+        }
+    }
+
+    result.makespanMs = lastCompletion - max(firstArrival, 0.0);
+    result.throughput = result.makespanMs > 0.0 ? 1000.0 * result.completed / result.makespanMs : 0.0;
+}
+
+// per-frame overhead (I/O waits, allocation, cache effects between stages) which makes the simulated makespan of the
+// recorded schedule match the measured one, found by bisection since the makespan grows monotonically with it
+static double calibrateOverhead(const vector<FrameTrace> &traces, const SchedulePolicy &recorded, double measuredMs)
+{
+    SimResult result;
+    simulate(traces, recorded, 0.0, 0.0, result);
+    if (result.makespanMs >= measuredMs || traces.empty())
+    {
+        return 0.0;
+    }
+
+    // frames overlap on several workers, so the overhead can exceed the measured time per frame: widen the upper
+    // bound until it brackets the measured makespan
+    double low = 0.0, high = measuredMs / traces.size();
+    for (int i = 0; i < 30; ++i)
+    {
+        simulate(traces, recorded, 0.0, high, result);
+        if (result.makespanMs >= measuredMs)
+        {
+            break;
+        }
+        low = high;
+        high *= 2.0;
+    }
+    for (int i = 0; i < 40; ++i)
+    {
+        double mid = 0.5 * (low + high);
+        simulate(traces, recorded, 0.0, mid, result);
+        (result.makespanMs < measuredMs ? low : high) = mid;
+    }
+    return 0.5 * (low + high);
+}
+
+static void printResult(const string &name, const SimResult &result)
+{
+    cout << "  " << left << setw(34) << name << right << fixed << setprecision(2) << setw(9) << result.throughput << " fps"
+         << setw(6) << result.completed << " done" << setw(5) << result.dropped << " dropped"
+         << "  latency p50 " << setw(8) << result.latency.percentile(50) / 1000.0
+         << "  p99 " << setw(8) << result.latency.percentile(99) / 1000.0
+         << "  max " << setw(8) << result.latency.max() / 1000.0 << " ms" << endl;
+    cout.unsetf(ios::fixed | ios::left);
+}
+
+/* SCHEDULE SIMULATOR: throughput and latency of alternative schedules, replaying stage times recorded by 3D_object_tracking */
+// usage: schedule_sim [trace file] [sensor rate in Hz, 0 = offline] [no. of threads of the recorded run, 1 = sequential main loop]
+int main(int argc, const char *argv[])
+{
+    string traceFile = argc > 1 ? argv[1] : "../StageTrace.csv";
+    double sensorRate = argc > 2 ? stod(argv[2]) : 10.0;
+    int recordedThreads = argc > 3 ? stoi(argv[3]) : 1;
+
+    vector<FrameTrace> traces;
+    if (!readStageTrace(traces, traceFile))
+    {
+        flushLog();
+        cerr << "No stage trace in " << traceFile << ", run 3D_object_tracking with bRecordTrace first" << endl;
+        return 1;
+    }
+
+    // mean stage times of the recording
+    cout << "=== " << traces.size() << " frames from " << traceFile << " ===" << endl << "  mean stage times [ms] :";
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        double sum = 0.0;
+        for (auto &trace : traces)
+        {
+            sum += trace.stageMs[s];
+        }
+        cout << " " << stageName((PipelineStage)s) << " " << fixed << setprecision(2) << sum / traces.size();
+    }
+    cout.unsetf(ios::fixed);
+    cout << endl;
+
+    // calibration against the recorded run: the sequential main loop, or runOffline with the given no. of workers
+    SchedulePolicy recorded;
+    recorded.name = "recorded";
+    if (recordedThreads > 1)
+    {
+        recorded.nThreads = recordedThreads;
+        recorded.pipelineDepth = 2 * recordedThreads;
+        recorded.bPairThread = true;
+    }
+    double firstStart = traces.front().startMs, lastDone = traces.front().doneMs;
+    LatencyHistogram measuredLatency;
+    for (auto &trace : traces)
+    {
+        firstStart = min(firstStart, trace.startMs);
+        lastDone = max(lastDone, trace.doneMs);
+        measuredLatency.record((uint64_t)(1000.0 * max(trace.doneMs - trace.startMs, 0.0)));
+    }
+    double measuredMs = lastDone - firstStart;
+
+    SimResult uncalibrated, calibrated;
+    simulate(traces, recorded, 0.0, 0.0, uncalibrated);
+    double overheadMs = calibrateOverhead(traces, recorded, measuredMs);
+    simulate(traces, recorded, 0.0, overheadMs, calibrated);
+    cout << "=== calibration against the recorded run ===" << endl << fixed << setprecision(1);
+    cout << "  measured makespan " << measuredMs << " ms, simulated " << uncalibrated.makespanMs << " ms ("
+         << 100.0 * (uncalibrated.makespanMs - measuredMs) / measuredMs << " %), with " << overheadMs << " ms overhead per frame "
+         << calibrated.makespanMs << " ms (" << 100.0 * (calibrated.makespanMs - measuredMs) / measuredMs << " %)" << endl;
+    cout << "  measured latency p50 " << measuredLatency.percentile(50) / 1000.0 << " ms, p99 " << measuredLatency.percentile(99) / 1000.0
+         << " ms; simulated p50 " << calibrated.latency.percentile(50) / 1000.0 << " ms, p99 " << calibrated.latency.percentile(99) / 1000.0 << " ms" << endl;
+    cout.unsetf(ios::fixed);
+
+    // alternative schedules
+    double framePeriodMs = sensorRate > 0.0 ? 1000.0 / sensorRate : 0.0;
+    vector<SchedulePolicy> policies;
+    auto addPolicy = [&](const string &name, int nThreads, int depth, bool bPairThread, bool bPriorityTTC, int detectEvery, double maxQueueMs) {
+        SchedulePolicy policy;
+        policy.name = name;
+        policy.nThreads = nThreads;
+        policy.pipelineDepth = depth;
+        policy.bPairThread = bPairThread;
+        policy.bPriorityTTC = bPriorityTTC;
+        policy.detectEvery = detectEvery;
+        policy.maxQueueMs = maxQueueMs;
+        policies.push_back(policy);
+    };
+    addPolicy("sequential", 1, 1, false, false, 1, 0.0);
+    addPolicy("pipelined, 2 threads, depth 2", 2, 2, false, false, 1, 0.0);
+    for (int n : {2, 4, 8})
+    {
+        addPolicy("runOffline, " + to_string(n) + " workers", n, 2 * n, true, false, 1, 0.0);
+    }
+    addPolicy("4 threads, depth 8, TTC first", 4, 8, false, true, 1, 0.0);
+    addPolicy("2 threads, detect every 2nd frame", 2, 4, true, false, 2, 0.0);
+    addPolicy("2 threads, detect every 3rd frame", 2, 4, true, false, 3, 0.0);
+    if (sensorRate > 0.0)
+    {
+        addPolicy("sequential, drop after 1 period", 1, 1, false, false, 1, framePeriodMs);
+        addPolicy("2 threads, drop after 1 period", 2, 4, true, false, 1, framePeriodMs);
+    }
+
+    cout << "=== simulated schedules ";
+    if (sensorRate > 0.0)
+    {
+        cout << "at " << sensorRate << " Hz ===" << endl;
+    }
+    else
+    {
+        cout << "at full speed ===" << endl;
+    }
+    for (auto &policy : policies)
+    {
+        SimResult result;
+        simulate(traces, policy, sensorRate, overheadMs, result);
+        printResult(policy.name, result);
+    }
+
+    flushLog();
+    return 0;
+}
@@ -0,0 +1,113 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "dataStructures.h"
+#include "objectDetection2D.hpp"
+#include "shmTransport.hpp"
+#include "pipeline.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+// read a whole file into memory
+static bool readFile(const std::string &filename, std::vector<char> &data)
+{
+    ifstream file(filename, ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    return true;
+}
+
+/* DETECTOR PROCESS: loads frames, runs YOLO and publishes images, scans and boxes through shared memory */
+int main(int argc, const char *argv[])
+{
+    string dataPath = "../";
+    string shmName = argc > 1 ? argv[1] : "/sfnd_frames";
+    PipelineConfig config = createDefaultConfig(dataPath);
+    setLogLevel(LOG_LEVEL_INFO);
+
+    ShmRing ring;
+    if (!ring.create(shmName))
+    {
+        return 1;
+    }
+    LOG_INFO("Detector publishing " << config.frameFiles.size() << " frames on " << shmName);
+
+    int imgRows = 0, imgCols = 0; // image size of the previous frame, used to decode straight into shared memory
+    vector<char> encoded, scan;
+    for (size_t frameIdx = 0; frameIdx < config.frameFiles.size(); ++frameIdx)
+    {
+        if (!readFile(config.frameFiles[frameIdx].imgFile, encoded) || !readFile(config.frameFiles[frameIdx].lidarFile, scan))
+        {
+            LOG_ERROR("Cannot read frame " << frameIdx);
+            continue;
+        }
+
+        // blocks while the tracking process still holds all slots
+        if (!ring.beginWrite(frameIdx))
+        {
+            break;
+        }
+
+        // decode the image into the slot; the decoder only reallocates if the image size changed
+        cv::Mat img;
+        if (imgRows > 0)
+        {
+            img = ring.imageBuffer(imgRows, imgCols, CV_8UC3);
+        }
+        cv::Mat slotImg = img;
+        cv::imdecode(cv::Mat(1, (int)encoded.size(), CV_8U, encoded.data()), cv::IMREAD_COLOR, &img);
+        if (img.data != slotImg.data && !img.empty())
+        {
+            cv::Mat resized = ring.imageBuffer(img.rows, img.cols, img.type());
+            if (!resized.empty())
+            {
+                img.copyTo(resized);
+            }
+            img = resized;
+        }
+        imgRows = img.rows;
+        imgCols = img.cols;
+
+        // convert the raw scan (x, y, z, r as float) directly into the slot
+        size_t nPoints = scan.size() / (4 * sizeof(float));
+        LidarPoint *lidarPoints = ring.lidarBuffer(nPoints);
+        const float *values = (const float *)scan.data();
+        for (size_t i = 0; lidarPoints != nullptr && i < nPoints; ++i, values += 4)
+        {
+            lidarPoints[i] = {values[0], values[1], values[2], values[3]};
+        }
+
+        vector<BoundingBox> boundingBoxes;
+        if (!img.empty())
+        {
+            detectObjects(img, boundingBoxes, config.confThreshold, config.nmsThreshold,
+                          config.yoloBasePath, config.yoloClassesFile, config.yoloModelConfiguration, config.yoloModelWeights, false, config.yoloInputSize,
+                          config.yoloClassMapFile);
+        }
+
+        ShmBox *boxes = ring.boxBuffer(boundingBoxes.size());
+        for (size_t i = 0; boxes != nullptr && i < boundingBoxes.size(); ++i)
+        {
+            BoundingBox &bBox = boundingBoxes[i];
+            boxes[i] = {bBox.boxID, bBox.trackID, bBox.roi.x, bBox.roi.y, bBox.roi.width, bBox.roi.height, bBox.classID, (float)bBox.confidence};
+        }
+
+        ring.commitWrite();
+        LOG_DEBUG("Frame " << frameIdx << " published with " << boundingBoxes.size() << " objects");
+    }
+
+    ring.close();
+    flushLog();
+    return 0;
+}
@@ -0,0 +1,304 @@
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shmTransport.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+static const uint32_t SHM_MAGIC = 0x53464e44;
+static const size_t SHM_ALIGN = 64;
+
+// wait until the futex word differs from the expected value, returns false on timeout
+static bool futexWait(std::atomic<uint32_t> *word, uint32_t expected, chrono::steady_clock::time_point deadline, bool bTimeout)
+{
+    timespec ts, *pts = nullptr;
+    if (bTimeout)
+    {
+        auto remaining = chrono::duration_cast<chrono::nanoseconds>(deadline - chrono::steady_clock::now()).count();
+        if (remaining <= 0)
+        {
+            return false;
+        }
+        ts.tv_sec = remaining / 1000000000;
+        ts.tv_nsec = remaining % 1000000000;
+        pts = &ts;
+    }
+    // no FUTEX_PRIVATE_FLAG, the word is shared between processes
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, pts, nullptr, 0);
+    return true;
+}
+
+static void futexWake(std::atomic<uint32_t> *word)
+{
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+ShmRing::~ShmRing()
+{
+    close();
+}
+
+bool ShmRing::create(const std::string &name_, int nSlots, size_t slotSize)
+{
+    close();
+    name = name_;
+    slotSize = (slotSize + 4095) & ~(size_t)4095;
+    memSize = 4096 + nSlots * slotSize;
+
+    shm_unlink(name.c_str()); // remove a segment left behind by a crashed producer
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, memSize) != 0)
+    {
+        LOG_ERROR("Cannot create shared memory segment " << name);
+        close();
+        return false;
+    }
+    mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        mem = nullptr;
+        close();
+        return false;
+    }
+    bOwner = true;
+
+    header = (ShmRingHeader *)mem;
+    header->nSlots = nSlots;
+    header->slotSize = slotSize;
+    header->written.store(0);
+    header->released.store(0);
+    header->closed.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_MAGIC;
+    return true;
+}
+
+bool ShmRing::open(const std::string &name_, int timeoutMs)
+{
+    close();
+    name = name_;
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+    // the producer may not have created the segment yet
+    while (true)
+    {
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= 4096)
+        {
+            memSize = st.st_size;
+            mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mem != MAP_FAILED && ((ShmRingHeader *)mem)->magic == SHM_MAGIC)
+            {
+                break;
+            }
+            if (mem != MAP_FAILED)
+            {
+                munmap(mem, memSize);
+            }
+            mem = nullptr;
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        if (chrono::steady_clock::now() >= deadline)
+        {
+            LOG_ERROR("Shared memory segment " << name << " not available");
+            return false;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    header = (ShmRingHeader *)mem;
+    readCursor = header->released.load();
+    return true;
+}
+
+void ShmRing::close()
+{
+    if (header != nullptr)
+    { // wake up the other side so it does not wait for frames or slots that never come
+        header->closed.store(1);
+        futexWake(&header->written);
+        futexWake(&header->released);
+    }
+    if (mem != nullptr)
+    {
+        munmap(mem, memSize);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    if (bOwner)
+    {
+        shm_unlink(name.c_str());
+    }
+    mem = nullptr;
+    header = nullptr;
+    writeSlot = nullptr;
+    fd = -1;
+    bOwner = false;
+}
+
+ShmFrameHeader *ShmRing::slot(uint32_t seq)
+{
+    return (ShmFrameHeader *)((char *)mem + 4096 + (seq % header->nSlots) * header->slotSize);
+}
+
+// bump allocation within the slot being written
+void *ShmRing::allocate(size_t size)
+{
+    size_t offset = (writeSlot->used + SHM_ALIGN - 1) & ~(SHM_ALIGN - 1);
+    if (offset + size > header->slotSize)
+    {
+        LOG_ERROR("Shared memory slot too small for frame " << writeSlot->frameIndex);
+        return nullptr;
+    }
+    writeSlot->used = offset + size;
+    return (char *)writeSlot + offset;
+}
+
+// wait for a free slot and start a new frame in it
+bool ShmRing::beginWrite(long frameIndex, int timeoutMs)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    uint32_t written = header->written.load(std::memory_order_relaxed);
+    while (true)
+    {
+        uint32_t released = header->released.load(std::memory_order_acquire);
+        if (written - released < header->nSlots)
+        {
+            break;
+        }
+        if (header->closed.load() || !futexWait(&header->released, released, deadline, timeoutMs >= 0))
+        {
+            return false;
+        }
+    }
+
+    writeSlot = slot(written);
+    *writeSlot = ShmFrameHeader();
+    writeSlot->frameIndex = frameIndex;
+    writeSlot->used = sizeof(ShmFrameHeader);
+    return true;
+}
+
+// image stored in the slot, to be filled in place by the producer
+cv::Mat ShmRing::imageBuffer(int rows, int cols, int type)
+{
+    size_t step = cols * CV_ELEM_SIZE(type);
+    void *data = allocate(rows * step);
+    if (data == nullptr)
+    {
+        return cv::Mat();
+    }
+    writeSlot->imgRows = rows;
+    writeSlot->imgCols = cols;
+    writeSlot->imgType = type;
+    writeSlot->imgStep = step;
+    writeSlot->imgOffset = (char *)data - (char *)writeSlot;
+    return cv::Mat(rows, cols, type, data, step);
+}
+
+LidarPoint *ShmRing::lidarBuffer(size_t nPoints)
+{
+    void *data = allocate(nPoints * sizeof(LidarPoint));
+    if (data != nullptr)
+    {
+        writeSlot->nLidarPoints = nPoints;
+        writeSlot->lidarOffset = (char *)data - (char *)writeSlot;
+    }
+    return (LidarPoint *)data;
+}
+
+ShmBox *ShmRing::boxBuffer(size_t nBoxes)
+{
+    void *data = allocate(nBoxes * sizeof(ShmBox));
+    if (data != nullptr)
+    {
+        writeSlot->nBoxes = nBoxes;
+        writeSlot->boxesOffset = (char *)data - (char *)writeSlot;
+    }
+    return (ShmBox *)data;
+}
+
+// publish the current slot to the consumer
+void ShmRing::commitWrite()
+{
+    header->written.fetch_add(1, std::memory_order_release);
+    futexWake(&header->written);
+    writeSlot = nullptr;
+}
+
+// next frame in order; it stays valid until the consumer has released it and all frames before it
+bool ShmRing::read(ShmFrameView &view, int timeoutMs)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    while (true)
+    {
+        uint32_t written = header->written.load(std::memory_order_acquire);
+        if (written != readCursor)
+        {
+            break;
+        }
+        if (header->closed.load() || !futexWait(&header->written, written, deadline, timeoutMs >= 0))
+        {
+            return false;
+        }
+    }
+
+    ShmFrameHeader *frameSlot = slot(readCursor++);
+    char *base = (char *)frameSlot;
+    view.frameIndex = frameSlot->frameIndex;
+    view.img = frameSlot->imgRows > 0 ? cv::Mat(frameSlot->imgRows, frameSlot->imgCols, frameSlot->imgType, base + frameSlot->imgOffset, frameSlot->imgStep) : cv::Mat();
+    view.nLidarPoints = frameSlot->nLidarPoints;
+    view.lidarPoints = view.nLidarPoints > 0 ? (const LidarPoint *)(base + frameSlot->lidarOffset) : nullptr;
+    view.nBoxes = frameSlot->nBoxes;
+    view.boxes = view.nBoxes > 0 ? (const ShmBox *)(base + frameSlot->boxesOffset) : nullptr;
+    return true;
+}
+
+// hand the oldest frame held by the consumer back to the producer
+void ShmRing::release()
+{
+    if (header->released.load() == readCursor)
+    {
+        return;
+    }
+    header->released.fetch_add(1, std::memory_order_release);
+    futexWake(&header->released);
+}
+
+// Data frame referencing the image in shared memory. The scan is copied since cropping rewrites it,
+// the boxes are rebuilt as they own containers for the later stages.
+void unpackShmFrame(const ShmFrameView &view, DataFrame &frame)
+{
+    frame.cameraImg = view.img;
+    frame.lidarPoints.assign(view.lidarPoints, view.lidarPoints + view.nLidarPoints);
+    frame.boundingBoxes.clear();
+    for (size_t i = 0; i < view.nBoxes; ++i)
+    {
+        const ShmBox &shmBox = view.boxes[i];
+        BoundingBox bBox;
+        bBox.boxID = shmBox.boxID;
+        bBox.trackID = shmBox.trackID;
+        bBox.roi = cv::Rect(shmBox.x, shmBox.y, shmBox.width, shmBox.height);
+        bBox.classID = shmBox.classID;
+        bBox.confidence = shmBox.confidence;
+        frame.boundingBoxes.push_back(bBox);
+    }
+}
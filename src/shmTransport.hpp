@@ -0,0 +1,89 @@
+
+#ifndef shmTransport_hpp
+#define shmTransport_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+struct ShmBox { // bounding box as stored in shared memory, without the per-frame containers
+    int boxID;
+    int trackID;
+    int x, y, width, height;
+    int classID;
+    float confidence;
+};
+
+struct ShmRingHeader { // start of the shared segment, the futex words are shared between both processes
+    uint32_t magic;                 // set last by the producer once the segment is initialized
+    uint32_t nSlots;
+    uint64_t slotSize;
+    std::atomic<uint32_t> written;  // no. of frames committed by the producer
+    std::atomic<uint32_t> released; // no. of frames released by the consumer
+    std::atomic<uint32_t> closed;   // producer has finished or the consumer has gone away
+};
+
+struct ShmFrameHeader { // start of one slot, followed by image, Lidar scan and boxes
+    long frameIndex;
+    int imgRows, imgCols, imgType;
+    size_t imgStep;
+    size_t imgOffset, lidarOffset, boxesOffset; // relative to the start of the slot
+    size_t nLidarPoints, nBoxes;
+    size_t used;                                // no. of bytes allocated within the slot
+};
+
+struct ShmFrameView { // frame received by the consumer, all members point into the shared segment
+    long frameIndex = -1;
+    cv::Mat img;                              // header only, no pixel copy
+    const LidarPoint *lidarPoints = nullptr;
+    size_t nLidarPoints = 0;
+    const ShmBox *boxes = nullptr;
+    size_t nBoxes = 0;
+};
+
+// Single-producer / single-consumer ring of frame slots in a POSIX shared memory segment.
+// The producer writes images, scans and boxes directly into a slot, the consumer accesses them in place until it releases the slot.
+// Both sides block on futexes when the ring is full or empty.
+class ShmRing
+{
+public:
+    ShmRing() {}
+    ~ShmRing();
+
+    bool create(const std::string &name, int nSlots=4, size_t slotSize=8 << 20); // producer
+    bool open(const std::string &name, int timeoutMs=5000);                      // consumer, waits for the producer
+    void close();
+
+    // producer
+    bool beginWrite(long frameIndex, int timeoutMs=-1);
+    cv::Mat imageBuffer(int rows, int cols, int type);
+    LidarPoint *lidarBuffer(size_t nPoints);
+    ShmBox *boxBuffer(size_t nBoxes);
+    void commitWrite();
+
+    // consumer
+    bool read(ShmFrameView &view, int timeoutMs=-1);
+    void release();
+
+private:
+    ShmFrameHeader *slot(uint32_t seq);
+    void *allocate(size_t size);
+
+    std::string name;
+    bool bOwner = false;
+    int fd = -1;
+    void *mem = nullptr;
+    size_t memSize = 0;
+    ShmRingHeader *header = nullptr;
+    ShmFrameHeader *writeSlot = nullptr;
+    uint32_t readCursor = 0; // no. of frames handed out to the consumer
+};
+
+void unpackShmFrame(const ShmFrameView &view, DataFrame &frame);
+
+#endif /* shmTransport_hpp */
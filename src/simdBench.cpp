@@ -0,0 +1,205 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "simdDispatch.hpp"
+
+using namespace std;
+
+template <typename Kernel>
+static double measureUs(Kernel kernel, int repetitions)
+{
+    kernel(); // warm-up
+    double t = (double)cv::getTickCount();
+    for (int i = 0; i < repetitions; ++i)
+    {
+        kernel();
+    }
+    return 1e6 * ((double)cv::getTickCount() - t) / cv::getTickFrequency() / repetitions;
+}
+
+// largest deviation from the baseline output, NANs have to agree
+template <typename T>
+static double maxDeviation(const vector<T> &values, const vector<T> &reference)
+{
+    double deviation = 0.0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (std::isnan((double)values[i]) || std::isnan((double)reference[i]))
+        {
+            deviation = std::isnan((double)values[i]) == std::isnan((double)reference[i]) ? deviation : INFINITY;
+            continue;
+        }
+        deviation = max(deviation, fabs((double)values[i] - (double)reference[i]) / max(1.0, fabs((double)reference[i])));
+    }
+    return deviation;
+}
+
+static void printResult(const string &kernel, double us, double baselineUs, double deviation)
+{
+    cout << "  " << left << setw(18) << kernel << right << fixed << setprecision(1) << setw(10) << us << " us" << setw(8)
+         << setprecision(2) << baselineUs / us << " x" << setw(14) << scientific << setprecision(2) << deviation << " max. rel. deviation" << endl;
+    cout.unsetf(ios::fixed | ios::scientific | ios::left);
+}
+
+/* SIMD KERNEL BENCHMARK: every kernel variant supported by this CPU against the baseline variant */
+// usage: simd_bench [no. of points]
+int main(int argc, const char *argv[])
+{
+    int nPoints = argc > 1 ? stoi(argv[1]) : 120000; // about one 64-beam scan
+    int nDescriptors = 2000, nMatches = 300, nBoxes = 400;
+    int repetitions = 20;
+
+    // synthetic inputs in the value ranges of the pipeline
+    mt19937 rng(1);
+    uniform_real_distribution<float> coord(-20.0f, 20.0f), pixel(0.0f, 1242.0f), unit(0.0f, 1.0f);
+    vector<float> pointsF(4 * nPoints);
+    for (int i = 0; i < nPoints; ++i)
+    {
+        pointsF[4 * i] = coord(rng) + 20.0f;
+        pointsF[4 * i + 1] = coord(rng);
+        pointsF[4 * i + 2] = coord(rng) / 10.0f;
+        pointsF[4 * i + 3] = unit(rng);
+    }
+    vector<double> pointsD(pointsF.begin(), pointsF.end());
+    const float projF[12] = {700.0f, -600.0f, 0.0f, 50.0f, 180.0f, 0.0f, -700.0f, -60.0f, 1.0f, 0.0f, 0.0f, -0.3f};
+    const double projD[12] = {700.0, -600.0, 0.0, 50.0, 180.0, 0.0, -700.0, -60.0, 1.0, 0.0, 0.0, -0.3};
+    const float limitsF[6] = {2.0f, 20.0f, 2.0f, -1.5f, -0.9f, 0.1f};
+    const double limitsD[6] = {2.0, 20.0, 2.0, -1.5, -0.9, 0.1};
+
+    vector<uint8_t> binary(nDescriptors * 61);
+    for (auto &b : binary)
+    {
+        b = rng();
+    }
+    vector<float> sift(nDescriptors * 128);
+    for (auto &v : sift)
+    {
+        v = 255.0f * unit(rng);
+    }
+    vector<float> packed(128 * SIMD_GEMM_COLS);
+    for (auto &v : packed)
+    {
+        v = 255.0f * unit(rng);
+    }
+
+    vector<float> prevX(nMatches), prevY(nMatches), currX(nMatches), currY(nMatches);
+    for (int i = 0; i < nMatches; ++i)
+    {
+        prevX[i] = pixel(rng);
+        prevY[i] = pixel(rng) / 3.0f;
+        currX[i] = 640.0f + 1.02f * (prevX[i] - 640.0f);
+        currY[i] = 190.0f + 1.02f * (prevY[i] - 190.0f);
+    }
+    vector<double> prevXD(prevX.begin(), prevX.end()), prevYD(prevY.begin(), prevY.end()), currXD(currX.begin(), currX.end()), currYD(currY.begin(), currY.end());
+
+    vector<float> x1(nBoxes), y1(nBoxes), x2(nBoxes), y2(nBoxes);
+    for (int i = 0; i < nBoxes; ++i)
+    {
+        x1[i] = pixel(rng);
+        y1[i] = pixel(rng) / 3.0f;
+        x2[i] = x1[i] + 200.0f * unit(rng);
+        y2[i] = y1[i] + 100.0f * unit(rng);
+    }
+
+    // outputs of the baseline variant and their times, the reference for all other variants
+    struct Outputs {
+        vector<float> uvF, ratiosF, distances, tile, iou;
+        vector<double> uvD, ratiosD;
+        vector<uint8_t> keepF, keepD;
+    };
+    Outputs reference;
+    vector<double> baselineUs;
+
+    cout << "SIMD kernels supported up to " << simdLevelName(detectSimdLevel()) << ", " << nPoints << " points" << endl;
+    for (int level = SIMD_BASELINE; level <= detectSimdLevel(); ++level)
+    {
+        const SimdKernels &kernels = simdKernelsAt((SimdLevel)level);
+        Outputs out;
+        out.uvF.resize(2 * nPoints);
+        out.uvD.resize(2 * nPoints);
+        out.keepF.resize(nPoints);
+        out.keepD.resize(nPoints);
+        out.distances.resize(2 * nDescriptors);
+        out.tile.resize(SIMD_GEMM_ROWS * SIMD_GEMM_COLS);
+        out.ratiosF.resize(nMatches * nMatches);
+        out.ratiosD.resize(nMatches * nMatches);
+        out.iou.resize(nBoxes * nBoxes);
+
+        vector<double> us;
+        us.push_back(measureUs([&]() { kernels.projectPointsF(pointsF.data(), nPoints, projF, out.uvF.data()); }, repetitions));
+        us.push_back(measureUs([&]() { kernels.projectPointsD(pointsD.data(), nPoints, projD, out.uvD.data()); }, repetitions));
+        us.push_back(measureUs([&]() { kernels.cropMaskF(pointsF.data(), nPoints, limitsF, out.keepF.data()); }, repetitions));
+        us.push_back(measureUs([&]() { kernels.cropMaskD(pointsD.data(), nPoints, limitsD, out.keepD.data()); }, repetitions));
+        us.push_back(measureUs([&]() {
+            for (int i = 0; i < nDescriptors; ++i)
+            {
+                out.distances[i] = kernels.hammingDistance(&binary[0], &binary[i * 61], 61);
+            }
+        }, repetitions));
+        us.push_back(measureUs([&]() {
+            for (int i = 0; i < nDescriptors; ++i)
+            {
+                out.distances[nDescriptors + i] = kernels.l2SquaredDistance(&sift[0], &sift[i * 128], 128);
+            }
+        }, repetitions));
+        us.push_back(measureUs([&]() {
+            const float *rows[SIMD_GEMM_ROWS] = {&sift[0], &sift[128], &sift[256], &sift[384]};
+            for (int i = 0; i < 100; ++i)
+            {
+                kernels.gemmTile(rows, packed.data(), 128, out.tile.data());
+            }
+        }, repetitions));
+        us.push_back(measureUs([&]() {
+            for (int i = 0; i < nMatches; ++i)
+            {
+                const float outer[4] = {prevX[i], prevY[i], currX[i], currY[i]};
+                kernels.distanceRatiosF(outer, prevX.data(), prevY.data(), currX.data(), currY.data(), nMatches, 100.0f, 1e-7f, &out.ratiosF[i * nMatches]);
+            }
+        }, repetitions));
+        us.push_back(measureUs([&]() {
+            for (int i = 0; i < nMatches; ++i)
+            {
+                const double outer[4] = {prevXD[i], prevYD[i], currXD[i], currYD[i]};
+                kernels.distanceRatiosD(outer, prevXD.data(), prevYD.data(), currXD.data(), currYD.data(), nMatches, 100.0, 1e-15, &out.ratiosD[i * nMatches]);
+            }
+        }, repetitions));
+        us.push_back(measureUs([&]() {
+            for (int i = 0; i < nBoxes; ++i)
+            {
+                const float box[4] = {x1[i], y1[i], x2[i], y2[i]};
+                kernels.iouRow(box, x1.data(), y1.data(), x2.data(), y2.data(), nBoxes, &out.iou[i * nBoxes]);
+            }
+        }, repetitions));
+
+        if (level == SIMD_BASELINE)
+        {
+            reference = out;
+            baselineUs = us;
+        }
+        vector<double> deviations{maxDeviation(out.uvF, reference.uvF), maxDeviation(out.uvD, reference.uvD),
+                                  maxDeviation(out.keepF, reference.keepF), maxDeviation(out.keepD, reference.keepD),
+                                  maxDeviation(vector<float>(out.distances.begin(), out.distances.begin() + nDescriptors),
+                                               vector<float>(reference.distances.begin(), reference.distances.begin() + nDescriptors)),
+                                  maxDeviation(vector<float>(out.distances.begin() + nDescriptors, out.distances.end()),
+                                               vector<float>(reference.distances.begin() + nDescriptors, reference.distances.end())),
+                                  maxDeviation(out.tile, reference.tile), maxDeviation(out.ratiosF, reference.ratiosF),
+                                  maxDeviation(out.ratiosD, reference.ratiosD), maxDeviation(out.iou, reference.iou)};
+        vector<string> names{"project float", "project double", "crop float", "crop double", "Hamming", "L2", "GEMM tile x100",
+                             "ratios float", "ratios double", "IoU"};
+
+        cout << "=== " << simdLevelName((SimdLevel)level) << " ===" << endl;
+        for (size_t k = 0; k < names.size(); ++k)
+        {
+            printResult(names[k], us[k], baselineUs[k], deviations[k]);
+        }
+    }
+    return 0;
+}
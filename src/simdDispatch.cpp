@@ -0,0 +1,151 @@
+
+#include <iostream>
+#include <cstdlib>
+#include <atomic>
+
+#include "simdDispatch.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+static atomic<const SimdKernels *> forcedKernels{nullptr}; // set by setSimdLevel, takes precedence over the startup selection
+
+static bool cpuSupports(SimdLevel level)
+{
+#ifdef SIMD_DISPATCH_X86
+    __builtin_cpu_init();
+    switch (level)
+    {
+    case SIMD_AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")
+               && __builtin_cpu_supports("avx512vl") && cpuSupports(SIMD_AVX2);
+    case SIMD_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("popcnt");
+    case SIMD_SSE42:
+        return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+    default:
+        return true;
+    }
+#else
+    return level == SIMD_BASELINE;
+#endif
+}
+
+static const SimdKernels &variant(SimdLevel level)
+{
+#ifdef SIMD_DISPATCH_X86
+    switch (level)
+    {
+    case SIMD_AVX512:
+        return simdKernelsAvx512();
+    case SIMD_AVX2:
+        return simdKernelsAvx2();
+    case SIMD_SSE42:
+        return simdKernelsSse42();
+    default:
+        break;
+    }
+#endif
+    return simdKernelsBaseline();
+}
+
+static bool parseSimdLevel(const string &name, SimdLevel &level)
+{
+    for (int l = 0; l < SIMD_LEVELS; ++l)
+    {
+        if (name == simdLevelName((SimdLevel)l))
+        {
+            level = (SimdLevel)l;
+            return true;
+        }
+    }
+    return false;
+}
+
+// highest supported level, lowered by the environment variable SFND_SIMD (baseline, sse4.2, avx2, avx512) for testing
+static const SimdKernels *selectFromEnvironment()
+{
+    SimdLevel level = detectSimdLevel();
+    const char *requested = getenv("SFND_SIMD");
+    if (requested != nullptr)
+    {
+        SimdLevel requestedLevel;
+        if (!parseSimdLevel(requested, requestedLevel))
+        {
+            LOG_WARN("Unknown SFND_SIMD=" << requested << ", using " << simdLevelName(level) << " kernels");
+        }
+        else if (!simdLevelAvailable(requestedLevel))
+        {
+            LOG_WARN("SFND_SIMD=" << requested << " is not supported by this CPU or binary, using " << simdLevelName(level) << " kernels");
+        }
+        else
+        {
+            level = requestedLevel;
+        }
+    }
+    return &variant(level);
+}
+
+std::string simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE42:
+        return "sse4.2";
+    case SIMD_AVX2:
+        return "avx2";
+    case SIMD_AVX512:
+        return "avx512";
+    default:
+        return "baseline";
+    }
+}
+
+bool simdLevelAvailable(SimdLevel level)
+{
+    return level >= SIMD_BASELINE && level <= detectSimdLevel();
+}
+
+SimdLevel detectSimdLevel()
+{
+    static const SimdLevel detected = []() {
+        int level = SIMD_LEVELS - 1;
+        while (level > SIMD_BASELINE && !cpuSupports((SimdLevel)level))
+        {
+            --level;
+        }
+        return (SimdLevel)level;
+    }();
+    return detected;
+}
+
+const SimdKernels &simdKernels()
+{
+    static const SimdKernels *selected = selectFromEnvironment();
+    const SimdKernels *forced = forcedKernels.load(memory_order_acquire);
+    return forced != nullptr ? *forced : *selected;
+}
+
+const SimdKernels &simdKernelsAt(SimdLevel level)
+{
+    return variant(simdLevelAvailable(level) ? level : detectSimdLevel());
+}
+
+// levels above the detected one are capped, call before the pipeline starts
+SimdLevel setSimdLevel(SimdLevel level)
+{
+    level = simdLevelAvailable(level) ? level : detectSimdLevel();
+    forcedKernels.store(&variant(level), memory_order_release);
+    return level;
+}
+
+void printSimdReport()
+{
+    const char *requested = getenv("SFND_SIMD");
+    cout << "SIMD kernels : " << simdLevelName(simdKernels().level) << " (supported up to " << simdLevelName(detectSimdLevel());
+    if (requested != nullptr)
+    {
+        cout << ", SFND_SIMD=" << requested;
+    }
+    cout << ") for projection, crop, Hamming and L2 distance, GEMM matching, distance ratios and NMS" << endl;
+}
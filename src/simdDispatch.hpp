@@ -0,0 +1,61 @@
+
+#ifndef simdDispatch_hpp
+#define simdDispatch_hpp
+
+#include <stdio.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// instruction set levels for which the kernels are compiled, in increasing order
+enum SimdLevel { SIMD_BASELINE, SIMD_SSE42, SIMD_AVX2, SIMD_AVX512, SIMD_LEVELS };
+
+// shape of the tile computed by gemmTile
+const int SIMD_GEMM_ROWS = 4;
+const int SIMD_GEMM_COLS = 64;
+
+// Vectorizable kernels of the pipeline, compiled once per instruction set (simdKernels*.cpp) and selected at startup.
+// Points are laid out as x, y, z, r like LidarPointT, image points as u, v like cv::Point_.
+struct SimdKernels {
+    SimdLevel level;
+
+    // pixel coordinates of n points with the 3x4 row-major projection P, NAN for points behind the image plane
+    void (*projectPointsF)(const float *xyzr, size_t n, const float *P, float *uv);
+    void (*projectPointsD)(const double *xyzr, size_t n, const double *P, double *uv);
+
+    // keep[i] = 1 for points inside the limits minX, maxX, maxY, minZ, maxZ, minR
+    void (*cropMaskF)(const float *xyzr, size_t n, const float *limits, uint8_t *keep);
+    void (*cropMaskD)(const double *xyzr, size_t n, const double *limits, uint8_t *keep);
+
+    uint32_t (*hammingDistance)(const uint8_t *a, const uint8_t *b, size_t bytes);
+    float (*l2SquaredDistance)(const float *a, const float *b, size_t n);
+
+    // acc[r][j] = dot(rows[r], column j of the packed block), block holds dims rows of SIMD_GEMM_COLS values
+    void (*gemmTile)(const float *const *rows, const float *block, int dims, float *acc);
+
+    // distance ratio curr / prev between one outer keypoint pair (prevX, prevY, currX, currY) and n inner pairs,
+    // NAN where the current distance is below minDist or the previous distance is not above eps
+    void (*distanceRatiosF)(const float *outer, const float *prevX, const float *prevY, const float *currX, const float *currY, size_t n,
+                            float minDist, float eps, float *ratios);
+    void (*distanceRatiosD)(const double *outer, const double *prevX, const double *prevY, const double *currX, const double *currY, size_t n,
+                            double minDist, double eps, double *ratios);
+
+    // intersection over union of one box (x1, y1, x2, y2) with n boxes, rounded exactly as in cv::dnn::NMSBoxes (1 if both areas are empty)
+    void (*iouRow)(const float *box, const float *x1, const float *y1, const float *x2, const float *y2, size_t n, float *iou);
+};
+
+const SimdKernels &simdKernels();      // kernels of the selected level, selected on first use
+SimdLevel detectSimdLevel();           // highest level supported by the CPU and compiled into the binary
+SimdLevel setSimdLevel(SimdLevel level); // select a lower level for testing, returns the level actually selected
+bool simdLevelAvailable(SimdLevel level);
+const SimdKernels &simdKernelsAt(SimdLevel level); // kernels of an available level, e.g. to compare variants
+std::string simdLevelName(SimdLevel level);
+void printSimdReport();
+
+// kernel tables of the individual variants, only x86-64 builds contain more than the baseline
+const SimdKernels &simdKernelsBaseline();
+const SimdKernels &simdKernelsSse42();
+const SimdKernels &simdKernelsAvx2();
+const SimdKernels &simdKernelsAvx512();
+
+#endif /* simdDispatch_hpp */
@@ -0,0 +1,6 @@
+
+// AVX2 variant of the pipeline kernels, compiled with -mavx2 -mfma -mpopcnt (see CMakeLists.txt)
+#define SIMD_KERNELS_LEVEL SIMD_AVX2
+#define SIMD_KERNELS_TABLE simdKernelsAvx2
+
+#include "simdKernelsImpl.hpp"
@@ -0,0 +1,6 @@
+
+// AVX-512 variant of the pipeline kernels, compiled with -mavx512f -mavx512bw -mavx512dq -mavx512vl (see CMakeLists.txt)
+#define SIMD_KERNELS_LEVEL SIMD_AVX512
+#define SIMD_KERNELS_TABLE simdKernelsAvx512
+
+#include "simdKernelsImpl.hpp"
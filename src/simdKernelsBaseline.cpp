@@ -0,0 +1,6 @@
+
+// baseline variant of the pipeline kernels: SSE2 on x86-64, the only variant on other architectures
+#define SIMD_KERNELS_LEVEL SIMD_BASELINE
+#define SIMD_KERNELS_TABLE simdKernelsBaseline
+
+#include "simdKernelsImpl.hpp"
@@ -0,0 +1,152 @@
+
+// Kernel bodies shared by all instruction set variants. Every simdKernels*.cpp includes this file once after defining
+// SIMD_KERNELS_LEVEL and SIMD_KERNELS_TABLE (name of the table accessor) and is compiled with the matching -m flags,
+// so the compiler vectorizes the same loops for each instruction set. Multiply-adds are neither contracted nor reassociated
+// (see SIMD_KERNEL_FLAGS), all variants therefore produce bit-identical results.
+//
+// All kernels have internal linkage and only use compiler builtins. Inline functions from standard headers would be
+// emitted once per variant and the linker could pick e.g. the AVX-512 copy for every caller.
+
+#ifndef simdKernelsImpl_hpp
+#define simdKernelsImpl_hpp
+
+#include "simdDispatch.hpp"
+
+static inline float kernelSqrt(float x) { return __builtin_sqrtf(x); }
+static inline double kernelSqrt(double x) { return __builtin_sqrt(x); }
+template <typename T> static inline T kernelNan() { return T(__builtin_nan("")); }
+
+template <typename T>
+static void projectPoints(const T *xyzr, size_t n, const T *P, T *uv)
+{
+    const T nan = kernelNan<T>();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const T *pt = xyzr + 4 * i;
+        T u = P[0] * pt[0] + P[1] * pt[1] + P[2] * pt[2] + P[3];
+        T v = P[4] * pt[0] + P[5] * pt[1] + P[6] * pt[2] + P[7];
+        T w = P[8] * pt[0] + P[9] * pt[1] + P[10] * pt[2] + P[11];
+        T uNorm = u / w, vNorm = v / w; // divided unconditionally and selected afterwards, so the loop has no branch
+        uv[2 * i] = w > T(0) ? uNorm : nan;
+        uv[2 * i + 1] = w > T(0) ? vNorm : nan;
+    }
+}
+
+template <typename T>
+static void cropMask(const T *xyzr, size_t n, const T *limits, uint8_t *keep)
+{
+    T minX = limits[0], maxX = limits[1], maxY = limits[2], minZ = limits[3], maxZ = limits[4], minR = limits[5];
+    for (size_t i = 0; i < n; ++i)
+    {
+        const T *pt = xyzr + 4 * i;
+        T absY = pt[1] < T(0) ? -pt[1] : pt[1];
+        keep[i] = (pt[0] >= minX) & (pt[0] <= maxX) & (pt[2] >= minZ) & (pt[2] <= maxZ) & (pt[2] <= T(0)) & (absY <= maxY) & (pt[3] >= minR);
+    }
+}
+
+static uint32_t hammingDistance(const uint8_t *a, const uint8_t *b, size_t bytes)
+{
+    uint32_t bits = 0;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t wa, wb;
+        __builtin_memcpy(&wa, a + i, 8);
+        __builtin_memcpy(&wb, b + i, 8);
+        bits += __builtin_popcountll(wa ^ wb);
+    }
+    for (; i < bytes; ++i)
+    {
+        bits += __builtin_popcount(a[i] ^ b[i]);
+    }
+    return bits;
+}
+
+// 16 partial sums, so the reduction vectorizes without reassociation flags and all variants add in the same order
+static float l2SquaredDistance(const float *a, const float *b, size_t n)
+{
+    const int PARTIAL_SUMS = 16;
+    float partial[PARTIAL_SUMS] = {};
+    size_t i = 0;
+    for (; i + PARTIAL_SUMS <= n; i += PARTIAL_SUMS)
+    {
+        for (int k = 0; k < PARTIAL_SUMS; ++k)
+        {
+            float diff = a[i + k] - b[i + k];
+            partial[k] += diff * diff;
+        }
+    }
+    float sum = 0.0f;
+    for (int k = 0; k < PARTIAL_SUMS; ++k)
+    {
+        sum += partial[k];
+    }
+    for (; i < n; ++i)
+    {
+        sum += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return sum;
+}
+
+// rank-1 updates: each packed column is loaded once for all rows of the tile
+static void gemmTile(const float *const *rows, const float *block, int dims, float *acc)
+{
+    float tile[SIMD_GEMM_ROWS][SIMD_GEMM_COLS] = {};
+    for (int d = 0; d < dims; ++d)
+    {
+        const float *col = block + d * SIMD_GEMM_COLS;
+        float a0 = rows[0][d], a1 = rows[1][d], a2 = rows[2][d], a3 = rows[3][d];
+        for (int j = 0; j < SIMD_GEMM_COLS; ++j)
+        {
+            tile[0][j] += a0 * col[j];
+            tile[1][j] += a1 * col[j];
+            tile[2][j] += a2 * col[j];
+            tile[3][j] += a3 * col[j];
+        }
+    }
+    __builtin_memcpy(acc, tile, sizeof(tile));
+}
+
+template <typename T>
+static void distanceRatios(const T *outer, const T *prevX, const T *prevY, const T *currX, const T *currY, size_t n, T minDist, T eps, T *ratios)
+{
+    const T nan = kernelNan<T>();
+    for (size_t i = 0; i < n; ++i)
+    {
+        T dxCurr = outer[2] - currX[i], dyCurr = outer[3] - currY[i];
+        T dxPrev = outer[0] - prevX[i], dyPrev = outer[1] - prevY[i];
+        T distCurr = kernelSqrt(dxCurr * dxCurr + dyCurr * dyCurr);
+        T distPrev = kernelSqrt(dxPrev * dxPrev + dyPrev * dyPrev);
+        T ratio = distCurr / distPrev;
+        ratios[i] = (distPrev > eps) & (distCurr >= minDist) ? ratio : nan;
+    }
+}
+
+static void iouRow(const float *box, const float *x1, const float *y1, const float *x2, const float *y2, size_t n, float *iou)
+{
+    double area = (double)(box[2] - box[0]) * (box[3] - box[1]);
+    for (size_t i = 0; i < n; ++i)
+    {
+        float w = (box[2] < x2[i] ? box[2] : x2[i]) - (box[0] > x1[i] ? box[0] : x1[i]);
+        float h = (box[3] < y2[i] ? box[3] : y2[i]) - (box[1] > y1[i] ? box[1] : y1[i]);
+        double intersection = (double)(w > 0.0f ? w : 0.0f) * (h > 0.0f ? h : 0.0f);
+        double areaSum = area + (double)(x2[i] - x1[i]) * (y2[i] - y1[i]);
+        // ratio in double and rounded to float as 1 - Jaccard distance like cv::dnn::NMSBoxes, boxes at the threshold are kept alike
+        iou[i] = areaSum <= 0.0 ? 1.0f : 1.0f - (float)(1.0 - intersection / (areaSum - intersection));
+    }
+}
+
+const SimdKernels &SIMD_KERNELS_TABLE()
+{
+    static const SimdKernels kernels = {
+        SIMD_KERNELS_LEVEL,
+        projectPoints<float>, projectPoints<double>,
+        cropMask<float>, cropMask<double>,
+        hammingDistance, l2SquaredDistance,
+        gemmTile,
+        distanceRatios<float>, distanceRatios<double>,
+        iouRow};
+    return kernels;
+}
+
+#endif /* simdKernelsImpl_hpp */
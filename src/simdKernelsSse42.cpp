@@ -0,0 +1,6 @@
+
+// SSE4.2 variant of the pipeline kernels, compiled with -msse4.2 -mpopcnt (see CMakeLists.txt)
+#define SIMD_KERNELS_LEVEL SIMD_SSE42
+#define SIMD_KERNELS_TABLE simdKernelsSse42
+
+#include "simdKernelsImpl.hpp"
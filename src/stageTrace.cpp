@@ -0,0 +1,115 @@
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <sstream>
+#include <opencv2/core.hpp>
+
+#include "stageTrace.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+static const char *kStageNames[] = {"load", "scene", "detect", "crop", "cluster", "keypoints", "descriptors", "match", "track", "ttc"};
+
+double traceClockMs()
+{
+    return 1000.0 * (double)cv::getTickCount() / cv::getTickFrequency();
+}
+
+const char *stageName(PipelineStage stage)
+{
+    return kStageNames[stage];
+}
+
+double frameStagesMs(const FrameTrace &trace)
+{
+    double sum = 0.0;
+    for (int s = STAGE_LOAD; s < STAGE_MATCH; ++s)
+    {
+        sum += trace.stageMs[s];
+    }
+    return sum;
+}
+
+double pairStagesMs(const FrameTrace &trace)
+{
+    double sum = 0.0;
+    for (int s = STAGE_MATCH; s < STAGE_COUNT; ++s)
+    {
+        sum += trace.stageMs[s];
+    }
+    return sum;
+}
+
+// one line per frame: index, stage times, wall-clock start and end, no. of boxes and static flag
+bool writeStageTrace(const std::vector<FrameTrace> &traces, const std::string &filename)
+{
+    ofstream file(filename);
+    if (!file)
+    {
+        LOG_ERROR("Cannot write stage trace to " << filename);
+        return false;
+    }
+    file << "frame";
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        file << "," << kStageNames[s] << "_ms";
+    }
+    file << ",start_ms,done_ms,boxes,static" << endl;
+    file.precision(15);
+    for (auto &trace : traces)
+    {
+        file << trace.frameIndex;
+        for (int s = 0; s < STAGE_COUNT; ++s)
+        {
+            file << "," << trace.stageMs[s];
+        }
+        file << "," << trace.startMs << "," << trace.doneMs << "," << trace.nBoxes << "," << (int)trace.bStatic << endl;
+    }
+    return true;
+}
+
+bool readStageTrace(std::vector<FrameTrace> &traces, const std::string &filename)
+{
+    ifstream file(filename);
+    string line;
+    if (!getline(file, line))
+    {
+        LOG_ERROR("Cannot read stage trace from " << filename);
+        return false;
+    }
+
+    traces.clear();
+    while (getline(file, line))
+    {
+        stringstream fields(line);
+        string field;
+        vector<double> values;
+        bool bNumeric = true;
+        while (bNumeric && getline(fields, field, ','))
+        {
+            char *end;
+            values.push_back(strtod(field.c_str(), &end));
+            bNumeric = end != field.c_str() && *end == '\0';
+        }
+        if (!bNumeric || values.size() != STAGE_COUNT + 5)
+        {
+            LOG_WARN("Skipping malformed stage trace line : " << line);
+            continue;
+        }
+
+        FrameTrace trace;
+        trace.frameIndex = (int)values[0];
+        for (int s = 0; s < STAGE_COUNT; ++s)
+        {
+            trace.stageMs[s] = values[1 + s];
+        }
+        trace.startMs = values[STAGE_COUNT + 1];
+        trace.doneMs = values[STAGE_COUNT + 2];
+        trace.nBoxes = (int)values[STAGE_COUNT + 3];
+        trace.bStatic = values[STAGE_COUNT + 4] != 0.0;
+        traces.push_back(trace);
+    }
+    return !traces.empty();
+}
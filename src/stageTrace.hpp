@@ -0,0 +1,32 @@
+
+#ifndef stageTrace_hpp
+#define stageTrace_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+// pipeline stages in execution order; the stages before STAGE_MATCH only need their own frame,
+// the later ones also need the previous frame and run in recording order
+enum PipelineStage {
+    STAGE_LOAD, STAGE_SCENE, STAGE_DETECT, STAGE_CROP, STAGE_CLUSTER, STAGE_KEYPOINTS, STAGE_DESCRIPTORS,
+    STAGE_MATCH, STAGE_TRACK, STAGE_TTC, STAGE_COUNT
+};
+
+struct FrameTrace { // measured cost of one frame
+    int frameIndex = -1;
+    double stageMs[STAGE_COUNT] = {};
+    double startMs = 0.0;      // wall-clock time when loading started [ms]
+    double doneMs = 0.0;       // wall-clock time when the last stage of the frame finished [ms]
+    int nBoxes = 0;
+    bool bStatic = false;      // detections and features were reused from the previous frame
+};
+
+double traceClockMs();
+const char *stageName(PipelineStage stage);
+double frameStagesMs(const FrameTrace &trace);   // stages which only need their own frame
+double pairStagesMs(const FrameTrace &trace);    // stages which need the previous frame
+bool writeStageTrace(const std::vector<FrameTrace> &traces, const std::string &filename);
+bool readStageTrace(std::vector<FrameTrace> &traces, const std::string &filename);
+
+#endif /* stageTrace_hpp */
@@ -0,0 +1,129 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include "thresholdController.hpp"
+#include "matching2D.hpp"
+#include "logging.hpp"
+
+using namespace std;
+
+struct ThresholdRange { // default and limits of the controlled detector parameter
+    double initial, min, max;
+};
+
+static bool thresholdRange(const std::string &detectorType, ThresholdRange &range)
+{
+    if (detectorType == "FAST" || detectorType == "BRISK")
+    {
+        range = {30.0, 5.0, 150.0};
+    }
+    else if (detectorType == "ORB")
+    {
+        range = {20.0, 2.0, 100.0};
+    }
+    else if (detectorType == "AKAZE")
+    {
+        range = {0.001, 1e-5, 0.05};
+    }
+    else if (detectorType == "SIFT")
+    {
+        range = {0.04, 0.002, 0.2};
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// SHITOMASI and HARRIS are not controlled, they already limit the number of corners themselves
+bool hasAdaptiveThreshold(const std::string &detectorType)
+{
+    ThresholdRange range;
+    return thresholdRange(detectorType, range);
+}
+
+// Detect keypoints per grid cell with the current thresholds, then move every threshold towards the value which yields the
+// target count. The count of all detectors falls with the threshold, roughly by a power law, so the correction is multiplicative.
+void detectKeypointsAdaptive(const ThresholdPolicy &policy, ThresholdState &state, const std::string &detectorType, cv::Mat &imgGray,
+                             std::vector<cv::KeyPoint> &keypoints)
+{
+    ThresholdRange range;
+    if (!thresholdRange(detectorType, range))
+    {
+        return;
+    }
+    int nCells = max(1, policy.gridRows) * max(1, policy.gridCols);
+    if (state.detectorType != detectorType || (int)state.thresholds.size() != nCells)
+    {
+        state.detectorType = detectorType;
+        state.thresholds.assign(nCells, range.initial);
+    }
+    state.counts.assign(nCells, 0);
+    double cellTarget = (double)policy.targetKeypoints / nCells;
+
+    // cells are detected with a margin, so detectors see the same neighbourhood as on the full image,
+    // and only keypoints inside the cell itself are kept
+    int margin = nCells > 1 ? 32 : 0;
+    cv::Rect imageRect(0, 0, imgGray.cols, imgGray.rows);
+    double t = (double)cv::getTickCount();
+    for (int r = 0; r < max(1, policy.gridRows); ++r)
+    {
+        for (int c = 0; c < max(1, policy.gridCols); ++c)
+        {
+            int cell = r * max(1, policy.gridCols) + c;
+            cv::Rect core(imgGray.cols * c / max(1, policy.gridCols), imgGray.rows * r / max(1, policy.gridRows), 0, 0);
+            core.width = imgGray.cols * (c + 1) / max(1, policy.gridCols) - core.x;
+            core.height = imgGray.rows * (r + 1) / max(1, policy.gridRows) - core.y;
+            cv::Rect expanded = cv::Rect(core.x - margin, core.y - margin, core.width + 2 * margin, core.height + 2 * margin) & imageRect;
+
+            vector<cv::KeyPoint> cellKeypoints;
+            cv::Ptr<cv::FeatureDetector> detector = createKeypointDetector(detectorType, state.thresholds[cell], (int)(2 * cellTarget));
+            detector->detect(imgGray(expanded), cellKeypoints);
+            for (auto &kp : cellKeypoints)
+            {
+                kp.pt.x += expanded.x;
+                kp.pt.y += expanded.y;
+                if (core.contains(kp.pt))
+                {
+                    keypoints.push_back(kp);
+                    ++state.counts[cell];
+                }
+            }
+        }
+    }
+    state.detectMs = 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+
+    // over the latency budget, all thresholds rise by at least the relative overrun
+    double minFactor = 1.0 / (1.0 + policy.maxStep), maxFactor = 1.0 + policy.maxStep;
+    double budgetFactor = policy.maxDetectMs > 0.0 && state.detectMs > policy.maxDetectMs ? pow(state.detectMs / policy.maxDetectMs, policy.gain) : 1.0;
+
+    bool bAdjusted = false;
+    double before = state.thresholds[0];
+    for (int cell = 0; cell < nCells; ++cell)
+    {
+        double ratio = state.counts[cell] / cellTarget;
+        double factor = 1.0;
+        if (state.counts[cell] == 0)
+        {
+            factor = minFactor;
+        }
+        else if (fabs(ratio - 1.0) > policy.tolerance)
+        {
+            factor = pow(ratio, policy.gain);
+        }
+        factor = min(max(max(factor, budgetFactor), minFactor), maxFactor);
+
+        double threshold = min(max(state.thresholds[cell] * factor, range.min), range.max);
+        bAdjusted = bAdjusted || fabs(threshold - state.thresholds[cell]) > 0.01 * state.thresholds[cell];
+        state.thresholds[cell] = threshold;
+    }
+
+    if (bAdjusted)
+    {
+        ++state.adjustments;
+        LOG_INFO("Threshold " << detectorType << " : " << keypoints.size() << " keypoints (target " << policy.targetKeypoints << ") in "
+                 << state.detectMs << " ms, threshold " << before << " -> " << state.thresholds[0] << (nCells > 1 ? " (first cell)" : ""));
+    }
+}
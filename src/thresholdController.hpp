@@ -0,0 +1,32 @@
+
+#ifndef thresholdController_hpp
+#define thresholdController_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <opencv2/core.hpp>
+
+struct ThresholdPolicy { // adjusts the detector threshold from frame to frame to hold a keypoint count
+
+    int targetKeypoints = 1500;    // per frame, split evenly among the grid cells
+    int gridRows = 1, gridCols = 1; // image regions with their own threshold, e.g. 2 x 4 to spread keypoints over the image
+    double tolerance = 0.15;       // relative deviation from the target which is left alone
+    double gain = 0.5;             // exponent applied to the count ratio, i.e. the fraction of the error corrected per frame
+    double maxStep = 0.5;          // max. relative threshold change per frame
+    double maxDetectMs = 0.0;      // raise thresholds whenever detection takes longer (0 = no latency budget)
+};
+
+struct ThresholdState {
+    std::string detectorType;      // thresholds are reset when the detector changes
+    std::vector<double> thresholds; // current threshold per grid cell, in the units of the detector
+    std::vector<int> counts;       // keypoints found per grid cell in the last frame
+    double detectMs = 0.0;         // detection time of the last frame
+    int adjustments = 0;           // no. of frames in which a threshold was changed
+};
+
+bool hasAdaptiveThreshold(const std::string &detectorType);
+void detectKeypointsAdaptive(const ThresholdPolicy &policy, ThresholdState &state, const std::string &detectorType, cv::Mat &imgGray,
+                             std::vector<cv::KeyPoint> &keypoints);
+
+#endif /* thresholdController_hpp */
@@ -0,0 +1,510 @@
+
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+
+#include "trackMemory.hpp"
+#include "logging.hpp"
+#include "simdDispatch.hpp"
+
+using namespace std;
+
+typedef pair<float, int> Neighbour; // distance and slot
+
+static const int MAX_LEVEL = 8;
+
+// Hamming distance for binary descriptors, Euclidean distance for float descriptors
+static float descriptorDistance(const TrackIndex &index, const uchar *a, const uchar *b)
+{
+    if (index.descType == CV_32F)
+    {
+        return std::sqrt(simdKernels().l2SquaredDistance((const float *)a, (const float *)b, index.descCols));
+    }
+    return (float)simdKernels().hammingDistance(a, b, index.rowBytes);
+}
+
+static const uchar *slotData(const TrackIndex &index, int slot)
+{
+    return &index.data[slot * index.rowBytes];
+}
+
+// best-first search of one graph layer starting from the given nodes, returns the ef nearest nodes found, nearest first
+static vector<Neighbour> searchLayer(TrackIndex &index, const uchar *query, const vector<Neighbour> &entry, int ef, int level)
+{
+    if (++index.visitEpoch == 0)
+    {
+        fill(index.visited.begin(), index.visited.end(), 0);
+        index.visitEpoch = 1;
+    }
+    index.visited.resize(index.nodes.size(), 0);
+
+    priority_queue<Neighbour, vector<Neighbour>, greater<Neighbour>> candidates; // nearest on top
+    priority_queue<Neighbour> results; // farthest on top
+    for (auto &e : entry)
+    {
+        index.visited[e.second] = index.visitEpoch;
+        candidates.push(e);
+        results.push(e);
+    }
+    while ((int)results.size() > ef)
+    {
+        results.pop();
+    }
+
+    while (!candidates.empty())
+    {
+        Neighbour closest = candidates.top();
+        if ((int)results.size() >= ef && closest.first > results.top().first)
+        {
+            break; // all remaining candidates are farther than the worst result
+        }
+        candidates.pop();
+        for (int n : index.nodes[closest.second].links[level])
+        {
+            if (index.visited[n] == index.visitEpoch)
+            {
+                continue;
+            }
+            index.visited[n] = index.visitEpoch;
+            float d = descriptorDistance(index, query, slotData(index, n));
+            if ((int)results.size() < ef || d < results.top().first)
+            {
+                candidates.push({d, n});
+                results.push({d, n});
+                if ((int)results.size() > ef)
+                {
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    vector<Neighbour> nearest(results.size());
+    for (int i = (int)nearest.size() - 1; i >= 0; --i)
+    {
+        nearest[i] = results.top();
+        results.pop();
+    }
+    return nearest;
+}
+
+// greedy descent through the upper layers down to the given level
+static vector<Neighbour> descend(TrackIndex &index, const uchar *query, int level)
+{
+    vector<Neighbour> entry{{descriptorDistance(index, query, slotData(index, index.entryPoint)), index.entryPoint}};
+    for (int l = index.maxLevel; l > level; --l)
+    {
+        entry = searchLayer(index, query, entry, 1, l);
+    }
+    return entry;
+}
+
+static void unlink(TrackIndex &index, int a, int b, int level)
+{
+    auto &links = index.nodes[a].links[level];
+    links.erase(remove(links.begin(), links.end(), b), links.end());
+}
+
+// Choose up to maxCount neighbours from candidates sorted by distance. A candidate closer to an already chosen
+// neighbour than to the node is skipped at first, so links also reach nearby clusters instead of only the nearest
+// members of the own one (similar descriptors of the same keypoint over several frames); skipped candidates fill
+// the remaining links.
+static vector<int> selectNeighbours(const TrackIndex &index, const vector<Neighbour> &candidates, int maxCount)
+{
+    vector<int> selected, skipped;
+    for (auto &c : candidates)
+    {
+        if ((int)selected.size() >= maxCount)
+        {
+            break;
+        }
+        bool bDiverse = true;
+        for (int s : selected)
+        {
+            if (descriptorDistance(index, slotData(index, c.second), slotData(index, s)) < c.first)
+            {
+                bDiverse = false;
+                break;
+            }
+        }
+        (bDiverse ? selected : skipped).push_back(c.second);
+    }
+    for (size_t i = 0; i < skipped.size() && (int)selected.size() < maxCount; ++i)
+    {
+        selected.push_back(skipped[i]);
+    }
+    return selected;
+}
+
+// keep maxLinks neighbours of a node, dropped links are removed in both directions so the graph stays symmetric
+static void shrinkLinks(TrackIndex &index, int slot, int level, int maxLinks)
+{
+    auto &links = index.nodes[slot].links[level];
+    if ((int)links.size() <= maxLinks)
+    {
+        return;
+    }
+    vector<Neighbour> neighbours;
+    for (int n : links)
+    {
+        neighbours.push_back({descriptorDistance(index, slotData(index, slot), slotData(index, n)), n});
+    }
+    sort(neighbours.begin(), neighbours.end());
+    vector<int> kept = selectNeighbours(index, neighbours, maxLinks);
+    for (auto &n : neighbours)
+    {
+        if (find(kept.begin(), kept.end(), n.second) == kept.end())
+        {
+            unlink(index, n.second, slot, level);
+        }
+    }
+    links = kept;
+}
+
+// store a descriptor in a free or new slot and link it into the graph, returns the slot
+int insertDescriptor(const TrackMemoryPolicy &policy, TrackIndex &index, const uchar *desc, int trackID, int frameIndex)
+{
+    int slot;
+    if (!index.freeSlots.empty())
+    {
+        slot = index.freeSlots.back();
+        index.freeSlots.pop_back();
+    }
+    else
+    {
+        slot = index.nodes.size();
+        index.nodes.push_back(TrackMemoryNode());
+        index.data.resize(index.nodes.size() * index.rowBytes);
+    }
+    memcpy(&index.data[slot * index.rowBytes], desc, index.rowBytes);
+
+    // exponentially decaying layer distribution, on average one in M nodes reaches the next layer
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    int level = min(MAX_LEVEL, (int)(-log(1.0 - uniform(index.rng)) / log((double)policy.M)));
+    TrackMemoryNode &node = index.nodes[slot];
+    node.trackID = trackID;
+    node.frameIndex = frameIndex;
+    node.links.assign(level + 1, vector<int>());
+
+    if (index.entryPoint < 0)
+    {
+        index.entryPoint = slot;
+        index.maxLevel = level;
+        return slot;
+    }
+
+    vector<Neighbour> entry = descend(index, desc, level);
+    for (int l = min(level, index.maxLevel); l >= 0; --l)
+    {
+        vector<Neighbour> found = searchLayer(index, desc, entry, policy.efConstruction, l);
+        int maxLinks = l == 0 ? 2 * policy.M : policy.M;
+        for (int n : selectNeighbours(index, found, policy.M))
+        {
+            index.nodes[slot].links[l].push_back(n);
+            index.nodes[n].links[l].push_back(slot);
+            shrinkLinks(index, n, l, maxLinks);
+        }
+        entry = found;
+    }
+
+    if (level > index.maxLevel)
+    {
+        index.maxLevel = level;
+        index.entryPoint = slot;
+    }
+    return slot;
+}
+
+// unlink a node and reconnect each former neighbour to the nearest of the other former neighbours
+void removeDescriptor(const TrackMemoryPolicy &policy, TrackIndex &index, int slot)
+{
+    TrackMemoryNode &node = index.nodes[slot];
+    int level = node.links.size() - 1;
+    for (int l = 0; l <= level; ++l)
+    {
+        vector<int> neighbours = node.links[l];
+        int maxLinks = l == 0 ? 2 * policy.M : policy.M;
+        for (int n : neighbours)
+        {
+            unlink(index, n, slot, l);
+        }
+        for (int n : neighbours)
+        {
+            auto &links = index.nodes[n].links[l];
+            Neighbour best{numeric_limits<float>::max(), -1};
+            for (int c : neighbours)
+            {
+                if (c == n || (int)index.nodes[c].links[l].size() >= maxLinks || find(links.begin(), links.end(), c) != links.end())
+                {
+                    continue;
+                }
+                best = min(best, Neighbour(descriptorDistance(index, slotData(index, n), slotData(index, c)), c));
+            }
+            if (best.second >= 0 && (int)links.size() < maxLinks)
+            {
+                links.push_back(best.second);
+                index.nodes[best.second].links[l].push_back(n);
+            }
+        }
+    }
+    node.links.clear();
+    node.trackID = -1;
+    index.freeSlots.push_back(slot);
+
+    if (index.entryPoint == slot)
+    { // the node with the highest layer becomes the new entry point
+        index.entryPoint = -1;
+        index.maxLevel = -1;
+        for (int i = 0; i < (int)index.nodes.size(); ++i)
+        {
+            if (index.nodes[i].trackID >= 0 && (int)index.nodes[i].links.size() - 1 > index.maxLevel)
+            {
+                index.entryPoint = i;
+                index.maxLevel = index.nodes[i].links.size() - 1;
+            }
+        }
+    }
+}
+
+// the ef nearest descriptors of a query as (distance, slot) pairs, nearest first
+std::vector<std::pair<float, int>> searchDescriptors(TrackIndex &index, const uchar *query, int ef)
+{
+    if (index.entryPoint < 0)
+    {
+        return vector<Neighbour>();
+    }
+    return searchLayer(index, query, descend(index, query, 0), ef, 0);
+}
+
+// remove the descriptors of a track from the indices of all feature engines
+static void forgetTrack(const TrackMemoryPolicy &policy, TrackMemory &memory, map<int, RememberedTrack>::iterator track)
+{
+    for (auto &engineSlots : track->second.slots)
+    {
+        TrackIndex &index = memory.indices[engineSlots.first];
+        for (int slot : engineSlots.second)
+        {
+            removeDescriptor(policy, index, slot);
+        }
+    }
+    memory.tracks.erase(track);
+}
+
+void resetTrackIndex(TrackIndex &index, int descType, int descCols)
+{
+    index.descType = descType;
+    index.descCols = descCols;
+    index.rowBytes = descCols * CV_ELEM_SIZE(descType);
+    index.data.clear();
+    index.nodes.clear();
+    index.freeSlots.clear();
+    index.entryPoint = index.maxLevel = -1;
+}
+
+static bool sameLayout(const TrackIndex &index, const cv::Mat &descriptors)
+{
+    return index.descType == descriptors.type() && index.descCols == descriptors.cols;
+}
+
+static size_t engineSlotCount(const RememberedTrack &track, int featureEngine)
+{
+    auto slots = track.slots.find(featureEngine);
+    return slots != track.slots.end() ? slots->second.size() : 0;
+}
+
+// indices of the strongest keypoints enclosed by the given region
+static vector<int> strongestKeypoints(const vector<cv::KeyPoint> &keypoints, const cv::Rect &roi, int maxCount)
+{
+    vector<int> indices;
+    for (int i = 0; i < (int)keypoints.size(); ++i)
+    {
+        if (roi.contains(keypoints[i].pt))
+        {
+            indices.push_back(i);
+        }
+    }
+    if ((int)indices.size() > maxCount)
+    {
+        nth_element(indices.begin(), indices.begin() + maxCount, indices.end(),
+                    [&](int i1, int i2) { return keypoints[i1].response > keypoints[i2].response; });
+        indices.resize(maxCount);
+    }
+    return indices;
+}
+
+// Give boxes which started a new track in this frame the identity of a lost track with the same class and appearance,
+// including its motion model. Appearance is compared with the descriptors of the feature engine of this frame.
+// The fusion history is kept per trackID and therefore carries over as well. Returns the no. of re-identified boxes.
+int reidentifyTracks(const TrackMemoryPolicy &policy, TrackMemory &memory, DataFrame &currFrame, int firstNewTrackID, int frameIndex)
+{
+    auto engineIndex = memory.indices.find(currFrame.featureEngine);
+    if (engineIndex == memory.indices.end() || engineIndex->second.entryPoint < 0 || currFrame.descriptors.empty() ||
+        !sameLayout(engineIndex->second, currFrame.descriptors))
+    {
+        return 0;
+    }
+    TrackIndex &index = engineIndex->second;
+
+    set<int> present;
+    for (auto &bb : currFrame.boundingBoxes)
+    {
+        if (bb.trackID >= 0 && bb.trackID < firstNewTrackID)
+        {
+            present.insert(bb.trackID);
+        }
+    }
+
+    int nReidentified = 0;
+    for (auto &bb : currFrame.boundingBoxes)
+    {
+        if (bb.trackID < firstNewTrackID)
+        {
+            continue;
+        }
+
+        // each query descriptor votes for the track of its nearest remembered descriptor if that is distinctive
+        double t = (double)cv::getTickCount();
+        vector<int> queries = strongestKeypoints(currFrame.keypoints, bb.roi, policy.queryDescriptors);
+        map<int, int> votes;
+        for (int idx : queries)
+        {
+            const uchar *query = currFrame.descriptors.ptr(idx);
+            vector<Neighbour> found = searchDescriptors(index, query, policy.efSearch);
+            if (found.empty())
+            {
+                continue;
+            }
+            int trackID = index.nodes[found[0].second].trackID;
+            auto other = find_if(found.begin(), found.end(), [&](const Neighbour &n) { return index.nodes[n.second].trackID != trackID; });
+            if (other == found.end() || found[0].first < policy.maxDistRatio * other->first)
+            {
+                ++votes[trackID];
+            }
+        }
+        memory.queryMs += 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+        memory.nQueries += queries.size();
+
+        // the lost track of the same class with most votes
+        int bestTrack = -1, bestVotes = 0;
+        for (auto &vote : votes)
+        {
+            auto track = memory.tracks.find(vote.first);
+            if (track == memory.tracks.end() || present.count(vote.first) > 0 || track->second.classID != bb.classID)
+            {
+                continue;
+            }
+            if (vote.second > bestVotes)
+            {
+                bestTrack = vote.first;
+                bestVotes = vote.second;
+            }
+        }
+        if (bestTrack < 0 || bestVotes < policy.minVotes || bestVotes < policy.minVoteFraction * queries.size())
+        {
+            continue;
+        }
+
+        RememberedTrack &track = memory.tracks[bestTrack];
+        LOG_INFO("Track " << bb.trackID << " re-identified as track " << bestTrack << " after " << frameIndex - track.lastSeen << " frames ("
+                 << bestVotes << " of " << queries.size() << " votes)");
+        bb.trackID = bestTrack;
+        bb.velocity = track.velocity;
+        bb.scaleRate = track.scaleRate;
+        present.insert(bestTrack);
+        ++nReidentified;
+    }
+    memory.nReidentified += nReidentified;
+    return nReidentified;
+}
+
+// add the strongest descriptors of all tracked boxes of this frame to the index of its feature engine and evict old
+// descriptors and lost tracks
+void rememberTracks(const TrackMemoryPolicy &policy, TrackMemory &memory, const DataFrame &currFrame, int frameIndex)
+{
+    const cv::Mat &descriptors = currFrame.descriptors;
+    if (descriptors.empty() || (descriptors.type() != CV_8U && descriptors.type() != CV_32F))
+    {
+        return;
+    }
+    int engine = currFrame.featureEngine;
+    TrackIndex &index = memory.indices[engine];
+    if (!sameLayout(index, descriptors))
+    { // another descriptor type of the same engine replaces its descriptors, other engines keep theirs
+        resetTrackIndex(index, descriptors.type(), descriptors.cols);
+        for (auto &track : memory.tracks)
+        {
+            track.second.slots.erase(engine);
+        }
+    }
+
+    double t = (double)cv::getTickCount();
+    for (auto &bb : currFrame.boundingBoxes)
+    {
+        if (bb.trackID < 0)
+        {
+            continue;
+        }
+        RememberedTrack &track = memory.tracks[bb.trackID];
+        track.classID = bb.classID;
+        track.lastSeen = frameIndex;
+        track.velocity = bb.velocity;
+        track.scaleRate = bb.scaleRate;
+        if (currFrame.bStatic)
+        {
+            continue; // reused features add no new appearance
+        }
+
+        deque<int> &slots = track.slots[engine];
+        for (int idx : strongestKeypoints(currFrame.keypoints, bb.roi, policy.descriptorsPerBox))
+        {
+            slots.push_back(insertDescriptor(policy, index, descriptors.ptr(idx), bb.trackID, frameIndex));
+            ++memory.nInserted;
+        }
+        while ((int)slots.size() > policy.maxPerTrack)
+        {
+            removeDescriptor(policy, index, slots.front());
+            slots.pop_front();
+        }
+    }
+
+    // forget tracks which have been lost for too long
+    for (auto track = memory.tracks.begin(); track != memory.tracks.end();)
+    {
+        auto next = std::next(track);
+        if (frameIndex - track->second.lastSeen > policy.maxAbsentFrames)
+        {
+            forgetTrack(policy, memory, track);
+        }
+        track = next;
+    }
+
+    // over capacity, the oldest descriptors of the largest tracks go first
+    while ((int)(index.nodes.size() - index.freeSlots.size()) > policy.maxEntries)
+    {
+        auto largest = max_element(memory.tracks.begin(), memory.tracks.end(),
+                                   [engine](const pair<const int, RememberedTrack> &t1, const pair<const int, RememberedTrack> &t2) { return engineSlotCount(t1.second, engine) < engineSlotCount(t2.second, engine); });
+        deque<int> &slots = largest->second.slots[engine];
+        removeDescriptor(policy, index, slots.front());
+        slots.pop_front();
+    }
+    memory.insertMs += 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+}
+
+void printTrackMemoryStats(const TrackMemory &memory)
+{
+    size_t nDescriptors = 0;
+    for (auto &index : memory.indices)
+    {
+        nDescriptors += index.second.nodes.size() - index.second.freeSlots.size();
+    }
+    cout << "Track memory : " << memory.nReidentified << " tracks re-identified, " << memory.tracks.size() << " tracks and "
+         << nDescriptors << " descriptors of " << memory.indices.size() << " feature engines remembered, "
+         << (memory.nQueries > 0 ? 1000.0 * memory.queryMs / memory.nQueries : 0.0) << " us per query, "
+         << (memory.nInserted > 0 ? 1000.0 * memory.insertMs / memory.nInserted : 0.0) << " us per insertion incl. eviction" << endl;
+}
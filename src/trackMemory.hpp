@@ -0,0 +1,75 @@
+
+#ifndef trackMemory_hpp
+#define trackMemory_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <random>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+struct TrackMemoryPolicy { // re-identification of tracks lost for a few frames, e.g. during an occlusion
+
+    int descriptorsPerBox = 16;      // strongest keypoint descriptors of a box remembered per frame
+    int maxPerTrack = 64;            // most recent descriptors kept per track and feature engine
+    int maxEntries = 4096;           // descriptors kept over all tracks, per feature engine
+    int maxAbsentFrames = 20;        // tracks unseen for longer are forgotten
+    int queryDescriptors = 32;       // strongest keypoint descriptors of a new box used as queries
+    int minVotes = 6;                // min. no. of query descriptors voting for the same lost track
+    double minVoteFraction = 0.3;    // min. share of all query descriptors voting for it
+    double maxDistRatio = 0.8;       // ratio test against the nearest descriptor of any other track
+
+    // HNSW graph
+    int M = 8;                       // links per node on the upper layers, twice as many on layer 0
+    int efConstruction = 32;         // candidate list size when linking a new node
+    int efSearch = 24;               // candidate list size of a query
+};
+
+struct TrackMemoryNode { // one remembered descriptor
+    int trackID = -1;                // -1 for a free slot
+    int frameIndex = -1;
+    std::vector<std::vector<int>> links; // neighbours per graph layer, links[0] is the base layer
+};
+
+struct TrackIndex { // descriptors of one feature engine, indexed by a hierarchical navigable small-world graph
+    int descType = -1, descCols = 0; // layout of the stored descriptors, the index is reset when it changes
+    size_t rowBytes = 0;
+    std::vector<uchar> data;         // descriptor of slot i at [i * rowBytes, (i + 1) * rowBytes)
+    std::vector<TrackMemoryNode> nodes;
+    std::vector<int> freeSlots;
+    int entryPoint = -1, maxLevel = -1;
+    std::vector<int> visited;        // visit marks of the current search, compared against visitEpoch
+    int visitEpoch = 0;
+    std::mt19937 rng{7};
+};
+
+struct RememberedTrack {
+    std::map<int, std::deque<int>> slots; // nodes of the track per feature engine, oldest first
+    int classID = -1;
+    int lastSeen = -1;               // last frame in which the track was observed
+    cv::Point2f velocity;            // motion model when last observed
+    float scaleRate = 1.0f;
+};
+
+struct TrackMemory { // bounded appearance memory of recent tracks
+    std::map<int, TrackIndex> indices; // per feature engine (-1 for the configured detector/descriptor), kept across engine switches
+    std::map<int, RememberedTrack> tracks;
+
+    // statistics
+    int nQueries = 0, nReidentified = 0;
+    double queryMs = 0.0, insertMs = 0.0;
+    int nInserted = 0;
+};
+
+void resetTrackIndex(TrackIndex &index, int descType, int descCols);
+int insertDescriptor(const TrackMemoryPolicy &policy, TrackIndex &index, const uchar *desc, int trackID, int frameIndex);
+void removeDescriptor(const TrackMemoryPolicy &policy, TrackIndex &index, int slot);
+std::vector<std::pair<float, int>> searchDescriptors(TrackIndex &index, const uchar *query, int ef);
+int reidentifyTracks(const TrackMemoryPolicy &policy, TrackMemory &memory, DataFrame &currFrame, int firstNewTrackID, int frameIndex);
+void rememberTracks(const TrackMemoryPolicy &policy, TrackMemory &memory, const DataFrame &currFrame, int frameIndex);
+void printTrackMemoryStats(const TrackMemory &memory);
+
+#endif /* trackMemory_hpp */
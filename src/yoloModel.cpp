@@ -0,0 +1,321 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <cstdint>
+
+#include "yoloModel.hpp"
+
+using namespace std;
+
+static string trim(const string &s)
+{
+    size_t begin = s.find_first_not_of(" \t\r");
+    size_t end = s.find_last_not_of(" \t\r");
+    return begin == string::npos ? "" : s.substr(begin, end - begin + 1);
+}
+
+// class names, one per line; blank lines (e.g. a trailing one) are not classes
+bool readClassNames(const std::string &file, std::vector<std::string> &classes)
+{
+    ifstream ifs(file);
+    string line;
+    while (getline(ifs, line))
+    {
+        if (!trim(line).empty())
+        {
+            classes.push_back(trim(line));
+        }
+    }
+    return !classes.empty();
+}
+
+bool readCfg(const std::string &file, std::vector<CfgSection> &sections)
+{
+    ifstream ifs(file);
+    if (!ifs)
+    {
+        return false;
+    }
+    string line;
+    while (getline(ifs, line))
+    {
+        string content = trim(line);
+        if (!content.empty() && content[0] == '[')
+        {
+            sections.push_back({trim(content.substr(1, content.find(']') - 1)), {}});
+        }
+        else if (sections.empty())
+        {
+            continue; // comments before the first section
+        }
+        sections.back().lines.push_back(line);
+    }
+    return !sections.empty();
+}
+
+bool writeCfg(const std::string &file, const std::vector<CfgSection> &sections)
+{
+    ofstream ofs(file);
+    for (auto &section : sections)
+    {
+        for (auto &line : section.lines)
+        {
+            ofs << line << "\n";
+        }
+    }
+    return (bool)ofs;
+}
+
+std::string cfgValue(const CfgSection &section, const std::string &key, const std::string &defaultValue)
+{
+    for (auto &line : section.lines)
+    {
+        string content = trim(line.substr(0, line.find('#')));
+        size_t eq = content.find('=');
+        if (eq != string::npos && trim(content.substr(0, eq)) == key)
+        {
+            return trim(content.substr(eq + 1));
+        }
+    }
+    return defaultValue;
+}
+
+static void setCfgValue(CfgSection &section, const string &key, const string &value)
+{
+    for (auto &line : section.lines)
+    {
+        string content = trim(line.substr(0, line.find('#')));
+        size_t eq = content.find('=');
+        if (eq != string::npos && trim(content.substr(0, eq)) == key)
+        {
+            line = key + "=" + value;
+            return;
+        }
+    }
+    section.lines.insert(section.lines.begin() + 1, key + "=" + value);
+}
+
+static vector<int> parseList(const string &value)
+{
+    vector<int> values;
+    stringstream ss(value);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        if (!trim(item).empty())
+        {
+            values.push_back(stoi(item));
+        }
+    }
+    return values;
+}
+
+// absolute indices of the layers read by a route or shortcut layer
+static vector<int> referencedLayers(const CfgSection &layer, int index)
+{
+    vector<int> refs = parseList(layer.type == "route" ? cfgValue(layer, "layers", "") : cfgValue(layer, "from", ""));
+    for (auto &ref : refs)
+    {
+        ref = ref < 0 ? index + ref : ref;
+    }
+    return refs;
+}
+
+// input and output channels of every layer, needed to walk the weights file
+bool inferShapes(const std::vector<CfgSection> &layers, int netChannels, std::vector<LayerShape> &shapes)
+{
+    shapes.resize(layers.size());
+    for (int i = 0; i < (int)layers.size(); ++i)
+    {
+        const CfgSection &layer = layers[i];
+        int in = i == 0 ? netChannels : shapes[i - 1].outChannels;
+        shapes[i].inChannels = in;
+        if (layer.type == "convolutional")
+        {
+            shapes[i].outChannels = stoi(cfgValue(layer, "filters", "1"));
+        }
+        else if (layer.type == "route")
+        {
+            if (cfgValue(layer, "groups", "1") != "1")
+            {
+                cerr << "Grouped route layers are not supported (layer " << i << ")" << endl;
+                return false;
+            }
+            shapes[i].outChannels = 0;
+            for (int ref : referencedLayers(layer, i))
+            {
+                if (ref < 0 || ref >= i)
+                {
+                    cerr << "Invalid route in layer " << i << endl;
+                    return false;
+                }
+                shapes[i].outChannels += shapes[ref].outChannels;
+            }
+        }
+        else if (layer.type == "shortcut" || layer.type == "upsample" || layer.type == "maxpool" || layer.type == "yolo")
+        {
+            shapes[i].outChannels = in;
+        }
+        else
+        {
+            cerr << "Layer type [" << layer.type << "] is not supported (layer " << i << ")" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static bool readValues(ifstream &ifs, size_t n, vector<T> &values)
+{
+    values.resize(n);
+    return (bool)ifs.read((char *)values.data(), n * sizeof(T));
+}
+
+template <typename T>
+static void writeValues(ofstream &ofs, const vector<T> &values)
+{
+    ofs.write((const char *)values.data(), values.size() * sizeof(T));
+}
+
+// rows of a per-filter array (biases, batch norm statistics or filter weights) for the kept output channels
+static vector<float> selectRows(const vector<float> &values, const vector<int> &keptChannels, size_t rowSize)
+{
+    vector<float> selected;
+    selected.reserve(keptChannels.size() * rowSize);
+    for (int c : keptChannels)
+    {
+        selected.insert(selected.end(), values.begin() + c * rowSize, values.begin() + (c + 1) * rowSize);
+    }
+    return selected;
+}
+
+// The convolution in front of every [yolo] layer outputs (5 + classes) channels per anchor: box, objectness, class scores.
+// Keeps the box, objectness and kept class channels of these heads and updates filters and classes in the model description.
+bool pruneDetectionHeads(std::vector<CfgSection> &layers, const std::vector<LayerShape> &shapes, int nClasses, const std::vector<int> &keptClasses,
+                         std::map<int, std::vector<int>> &prunedChannels)
+{
+    prunedChannels.clear();
+    set<int> heads;
+    for (int i = 0; i < (int)layers.size(); ++i)
+    {
+        if (layers[i].type != "yolo")
+        {
+            continue;
+        }
+        int nAnchors = parseList(cfgValue(layers[i], "mask", "")).size();
+        if (i == 0 || layers[i - 1].type != "convolutional" || shapes[i - 1].outChannels != nAnchors * (5 + nClasses) ||
+            stoi(cfgValue(layers[i], "classes", "0")) != nClasses)
+        {
+            cerr << "Layer " << i - 1 << " is not a detection head with " << nAnchors << " x (5 + " << nClasses << ") outputs" << endl;
+            return false;
+        }
+        vector<int> &channels = prunedChannels[i - 1];
+        for (int a = 0; a < nAnchors; ++a)
+        {
+            for (int c = 0; c < 5; ++c)
+            {
+                channels.push_back(a * (5 + nClasses) + c);
+            }
+            for (int cls : keptClasses)
+            {
+                channels.push_back(a * (5 + nClasses) + 5 + cls);
+            }
+        }
+        heads.insert(i - 1);
+        heads.insert(i);
+        setCfgValue(layers[i - 1], "filters", to_string(channels.size()));
+        setCfgValue(layers[i], "classes", to_string(keptClasses.size()));
+    }
+    if (prunedChannels.empty())
+    {
+        cerr << "No [yolo] layers found" << endl;
+        return false;
+    }
+
+    // the heads may only feed their [yolo] layer, other consumers would see fewer channels
+    for (int i = 0; i < (int)layers.size(); ++i)
+    {
+        if (layers[i].type == "route" || layers[i].type == "shortcut")
+        {
+            for (int ref : referencedLayers(layers[i], i))
+            {
+                if (heads.count(ref) > 0)
+                {
+                    cerr << "Layer " << i << " reads the detection head " << ref << ", which cannot be pruned" << endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Copy the weights layer by layer, keeping only the given output channels of the pruned convolutions.
+// Darknet stores per convolution: biases, [scales, rolling means, rolling variances,] weights (filters x channels x k x k).
+bool pruneWeights(const std::string &inFile, const std::string &outFile, const std::vector<CfgSection> &layers, const std::vector<LayerShape> &shapes,
+                  const std::map<int, std::vector<int>> &prunedChannels)
+{
+    ifstream ifs(inFile, ios::binary);
+    ofstream ofs(outFile, ios::binary);
+    if (!ifs || !ofs)
+    {
+        cerr << "Cannot open " << (!ifs ? inFile : outFile) << endl;
+        return false;
+    }
+
+    // header: major, minor, revision, no. of images seen during training (64 bit from version 0.2 on)
+    vector<int32_t> version;
+    readValues(ifs, 3, version);
+    writeValues(ofs, version);
+    bool bWideSeen = version[0] * 10 + version[1] >= 2 && version[0] < 1000 && version[1] < 1000;
+    vector<char> seen;
+    readValues(ifs, bWideSeen ? 8 : 4, seen);
+    writeValues(ofs, seen);
+
+    for (int i = 0; i < (int)layers.size(); ++i)
+    {
+        if (layers[i].type != "convolutional")
+        {
+            continue;
+        }
+        int filters = shapes[i].outChannels;
+        int size = stoi(cfgValue(layers[i], "size", "1"));
+        int groups = stoi(cfgValue(layers[i], "groups", "1"));
+        bool bBatchNorm = cfgValue(layers[i], "batch_normalize", "0") != "0";
+        size_t filterSize = (size_t)(shapes[i].inChannels / groups) * size * size;
+
+        vector<vector<float>> arrays(bBatchNorm ? 5 : 2);
+        for (size_t a = 0; a + 1 < arrays.size(); ++a)
+        {
+            if (!readValues(ifs, filters, arrays[a]))
+            {
+                cerr << "Weights file ends in layer " << i << endl;
+                return false;
+            }
+        }
+        if (!readValues(ifs, filters * filterSize, arrays.back()))
+        {
+            cerr << "Weights file ends in layer " << i << endl;
+            return false;
+        }
+
+        auto pruned = prunedChannels.find(i);
+        for (size_t a = 0; a < arrays.size(); ++a)
+        {
+            writeValues(ofs, pruned == prunedChannels.end() ? arrays[a] : selectRows(arrays[a], pruned->second, a + 1 < arrays.size() ? 1 : filterSize));
+        }
+    }
+
+    if (ifs.peek() != EOF)
+    {
+        cerr << "Warning: weights file has data beyond the last layer of the model description" << endl;
+    }
+    return (bool)ofs;
+}
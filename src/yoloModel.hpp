@@ -0,0 +1,30 @@
+
+#ifndef yoloModel_hpp
+#define yoloModel_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <string>
+
+struct CfgSection { // one [section] of a Darknet model description, kept as written
+    std::string type;           // e.g. "convolutional", without brackets
+    std::vector<std::string> lines; // all lines including the header, comments and blank lines
+};
+
+struct LayerShape {
+    int inChannels = 0;
+    int outChannels = 0;
+};
+
+bool readClassNames(const std::string &file, std::vector<std::string> &classes);
+bool readCfg(const std::string &file, std::vector<CfgSection> &sections);
+bool writeCfg(const std::string &file, const std::vector<CfgSection> &sections);
+std::string cfgValue(const CfgSection &section, const std::string &key, const std::string &defaultValue);
+bool inferShapes(const std::vector<CfgSection> &layers, int netChannels, std::vector<LayerShape> &shapes);
+bool pruneDetectionHeads(std::vector<CfgSection> &layers, const std::vector<LayerShape> &shapes, int nClasses, const std::vector<int> &keptClasses,
+                         std::map<int, std::vector<int>> &prunedChannels);
+bool pruneWeights(const std::string &inFile, const std::string &outFile, const std::vector<CfgSection> &layers, const std::vector<LayerShape> &shapes,
+                  const std::map<int, std::vector<int>> &prunedChannels);
+
+#endif /* yoloModel_hpp */
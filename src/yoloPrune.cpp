@@ -0,0 +1,172 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/dnn.hpp>
+
+#include "yoloModel.hpp"
+
+using namespace std;
+
+// run both models on an image and compare the box, objectness and kept class outputs of all detection heads
+static bool verifyPrunedModel(const string &fullCfg, const string &fullWeights, const string &prunedCfg, const string &prunedWeights,
+                              const string &imageFile, const vector<int> &keptClasses)
+{
+    cv::Mat img = cv::imread(imageFile);
+    if (img.empty())
+    {
+        cerr << "Cannot read " << imageFile << endl;
+        return false;
+    }
+    cv::Mat blob;
+    cv::dnn::blobFromImage(img, blob, 1 / 255.0, cv::Size(416, 416), cv::Scalar(0, 0, 0), false, false);
+
+    vector<vector<cv::Mat>> outputs(2);
+    vector<double> forwardMs(2);
+    vector<pair<string, string>> models{{fullCfg, fullWeights}, {prunedCfg, prunedWeights}};
+    for (int m = 0; m < 2; ++m)
+    {
+        cv::dnn::Net net = cv::dnn::readNetFromDarknet(models[m].first, models[m].second);
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+
+        vector<int> outLayers = net.getUnconnectedOutLayers();
+        vector<cv::String> layersNames = net.getLayerNames(), names(outLayers.size());
+        for (size_t i = 0; i < outLayers.size(); ++i)
+        {
+            names[i] = layersNames[outLayers[i] - 1];
+        }
+        net.setInput(blob);
+        net.forward(outputs[m], names); // warm-up
+        double t = (double)cv::getTickCount();
+        net.setInput(blob);
+        net.forward(outputs[m], names);
+        forwardMs[m] = 1000.0 * ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+    }
+
+    double maxDeviation = 0.0;
+    for (size_t o = 0; o < outputs[0].size(); ++o)
+    {
+        const cv::Mat &full = outputs[0][o], &pruned = outputs[1][o];
+        if (o >= outputs[1].size() || full.rows != pruned.rows || pruned.cols != 5 + (int)keptClasses.size())
+        {
+            cerr << "Output " << o << " of the pruned model has an unexpected layout" << endl;
+            return false;
+        }
+        for (int r = 0; r < full.rows; ++r)
+        {
+            for (int c = 0; c < pruned.cols; ++c)
+            {
+                int fullCol = c < 5 ? c : 5 + keptClasses[c - 5];
+                maxDeviation = max(maxDeviation, (double)fabs(full.at<float>(r, fullCol) - pruned.at<float>(r, c)));
+            }
+        }
+    }
+    cout << "Forward pass: " << fixed << setprecision(1) << forwardMs[0] << " ms full, " << forwardMs[1] << " ms pruned" << endl;
+    cout << "Max. deviation of the kept outputs: " << scientific << maxDeviation << endl;
+    return maxDeviation <= 1e-5;
+}
+
+/* YOLO CLASS PRUNING: strip the scores of unused classes from the detection heads of a Darknet model */
+// usage: yolo_prune <model.cfg> <model.weights> <classes.names> <output prefix> <class> [<class> ...] [--verify <image>]
+// writes <output prefix>.cfg, .weights, .names (kept class names) and .classmap (original index of every kept class)
+int main(int argc, const char *argv[])
+{
+    if (argc < 6)
+    {
+        cerr << "usage: yolo_prune <model.cfg> <model.weights> <classes.names> <output prefix> <class> [<class> ...] [--verify <image>]" << endl;
+        return 1;
+    }
+    string cfgFile = argv[1], weightsFile = argv[2], namesFile = argv[3], outPrefix = argv[4], verifyImage;
+    vector<string> keptNames;
+    for (int i = 5; i < argc; ++i)
+    {
+        if (string(argv[i]) == "--verify" && i + 1 < argc)
+        {
+            verifyImage = argv[++i];
+        }
+        else
+        {
+            keptNames.push_back(argv[i]);
+        }
+    }
+
+    // kept classes by index, in the order of the original model
+    vector<string> classes;
+    if (!readClassNames(namesFile, classes))
+    {
+        cerr << "Cannot read class names from " << namesFile << endl;
+        return 1;
+    }
+    set<int> keptSet;
+    for (auto &name : keptNames)
+    {
+        auto it = find(classes.begin(), classes.end(), name);
+        if (it == classes.end())
+        {
+            cerr << "Unknown class " << name << " (not in " << namesFile << ")" << endl;
+            return 1;
+        }
+        keptSet.insert(it - classes.begin());
+    }
+    vector<int> keptClasses(keptSet.begin(), keptSet.end());
+
+    vector<CfgSection> sections;
+    if (!readCfg(cfgFile, sections) || (sections[0].type != "net" && sections[0].type != "network"))
+    {
+        cerr << "Cannot read model description " << cfgFile << endl;
+        return 1;
+    }
+    vector<CfgSection> layers(sections.begin() + 1, sections.end());
+    vector<LayerShape> shapes;
+    if (!inferShapes(layers, stoi(cfgValue(sections[0], "channels", "3")), shapes))
+    {
+        return 1;
+    }
+
+    map<int, vector<int>> prunedChannels;
+    if (!pruneDetectionHeads(layers, shapes, classes.size(), keptClasses, prunedChannels))
+    {
+        cerr << "Cannot prune the detection heads of " << cfgFile << endl;
+        return 1;
+    }
+
+    if (!pruneWeights(weightsFile, outPrefix + ".weights", layers, shapes, prunedChannels))
+    {
+        return 1;
+    }
+    layers.insert(layers.begin(), sections[0]);
+    writeCfg(outPrefix + ".cfg", layers);
+    ofstream names(outPrefix + ".names"), classMap(outPrefix + ".classmap");
+    for (int cls : keptClasses)
+    {
+        names << classes[cls] << "\n";
+        classMap << cls << "\n";
+    }
+
+    int fullChannels = 0, keptChannels = 0;
+    for (auto &head : prunedChannels)
+    {
+        fullChannels += shapes[head.first].outChannels;
+        keptChannels += head.second.size();
+    }
+    cout << "Pruned " << prunedChannels.size() << " detection heads from " << fullChannels << " to " << keptChannels << " output channels, "
+         << keptClasses.size() << " of " << classes.size() << " classes kept" << endl;
+
+    if (!verifyImage.empty())
+    {
+        bool bIdentical = verifyPrunedModel(cfgFile, weightsFile, outPrefix + ".cfg", outPrefix + ".weights", verifyImage, keptClasses);
+        cout << (bIdentical ? "Kept outputs are identical" : "Kept outputs differ") << endl;
+        return bIdentical ? 0 : 2;
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <map>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "camFusion.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static BoundingBox createBox(int boxID, int classID, const cv::Rect &roi)
+{
+    BoundingBox box;
+    box.boxID = boxID;
+    box.classID = classID;
+    box.roi = roi;
+    return box;
+}
+
+// associations of a single previous box with the given current boxes, by overlap alone (no keypoint matches)
+static map<int, int> associate(const BoundingBox &prevBox, const vector<BoundingBox> &currBoxes)
+{
+    DataFrame prevFrame, currFrame;
+    prevFrame.boundingBoxes.push_back(prevBox);
+    currFrame.boundingBoxes = currBoxes;
+    vector<cv::DMatch> matches;
+    map<int, int> bbBestMatches;
+    matchBoundingBoxes(matches, bbBestMatches, prevFrame, currFrame, 5, 0.3);
+    return bbBestMatches;
+}
+
+/* BOX ASSOCIATION TEST: boxes are only associated with boxes of the same class */
+int main()
+{
+    const int CAR = 2, TRUCK = 7;
+    BoundingBox car = createBox(0, CAR, cv::Rect(400, 150, 200, 120));
+
+    // a truck at the predicted position of the car is not its continuation
+    map<int, int> truckOnly = associate(car, {createBox(0, TRUCK, cv::Rect(405, 152, 200, 120))});
+    CHECK(truckOnly.empty(), "car associated with a truck box");
+
+    // the car is found next to a better overlapping truck
+    map<int, int> carAndTruck = associate(car, {createBox(0, TRUCK, cv::Rect(401, 150, 200, 120)), createBox(1, CAR, cv::Rect(430, 160, 200, 120))});
+    CHECK(carAndTruck.size() == 1 && carAndTruck.count(0) == 1 && carAndTruck[0] == 1, "car not associated with the car box of the current frame");
+
+    return testResult("box_association_test");
+}
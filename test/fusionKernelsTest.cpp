@@ -0,0 +1,126 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "fusionKernels.hpp"
+#include "pipeline.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+// tolerances of the float kernels against the double reference
+static const double MAX_PIXEL_DEVIATION = 0.01;     // [px], projection of points between 2 m and 20 m
+static const double MAX_BOX_MISMATCH_RATE = 1e-3;   // points on a box edge may be truncated into the neighbouring pixel
+static const double MAX_TTC_LIDAR_DEVIATION = 1e-4; // relative, median distance of a vehicle 8 m ahead closing at 0.5 m/s
+static const double MAX_TTC_CAMERA_DEVIATION = 1e-4; // relative, keypoint distance ratios of a box growing by 1 % per frame
+
+template <typename T>
+static vector<LidarPointT<T>> convertPoints(const vector<LidarPointT<float>> &points)
+{
+    vector<LidarPointT<T>> converted;
+    for (auto &pt : points)
+    {
+        converted.push_back({(T)pt.x, (T)pt.y, (T)pt.z, (T)pt.r});
+    }
+    return converted;
+}
+
+static double relativeDeviation(double value, double reference)
+{
+    return fabs(value - reference) / max(fabs(reference), 1e-6);
+}
+
+/* FUSION KERNEL TEST: float instantiation of crop, projection, box assignment and TTC against the double reference */
+// inputs are float like the KITTI recording, so both precisions see identical points and only the arithmetic differs
+int main()
+{
+    PipelineConfig config = createDefaultConfig("");
+    mt19937 rng(7);
+
+    // scan of the scene around the vehicle
+    uniform_real_distribution<float> x(-10.0f, 40.0f), y(-15.0f, 15.0f), z(-2.0f, 1.0f), r(0.0f, 1.0f);
+    vector<LidarPointT<float>> scan(100000);
+    for (auto &pt : scan)
+    {
+        pt = {x(rng), y(rng), z(rng), r(rng)};
+    }
+
+    // crop: comparisons of float inputs against float limits are exact in both precisions
+    vector<LidarPointT<float>> croppedF = scan;
+    vector<LidarPointT<double>> croppedD = convertPoints<double>(scan);
+    cropLidarPointsT<float>(croppedF, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ, config.minR);
+    cropLidarPointsT<double>(croppedD, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ, config.minR);
+    CHECK(!croppedD.empty(), "no points in the ego lane");
+    CHECK(croppedF.size() == croppedD.size(), croppedF.size() << " float and " << croppedD.size() << " double points kept");
+    for (size_t i = 0; i < min(croppedF.size(), croppedD.size()); ++i)
+    {
+        CHECK(croppedF[i].x == croppedD[i].x && croppedF[i].y == croppedD[i].y, "point " << i << " differs after cropping");
+    }
+
+    // projection and box assignment of the cropped points
+    vector<LidarPointT<float>> projectedF(croppedF.begin(), croppedF.begin() + min(croppedF.size(), croppedD.size()));
+    vector<LidarPointT<double>> projectedD = convertPoints<double>(projectedF);
+    vector<cv::Point_<float>> imgPointsF;
+    vector<cv::Point_<double>> imgPointsD;
+    projectLidarPoints(projectedF, combineProjection<float>(config.P_rect_00, config.R_rect_00, config.RT), imgPointsF);
+    projectLidarPoints(projectedD, combineProjection<double>(config.P_rect_00, config.R_rect_00, config.RT), imgPointsD);
+    double maxPixelDeviation = 0.0;
+    for (size_t i = 0; i < imgPointsD.size(); ++i)
+    {
+        maxPixelDeviation = max(maxPixelDeviation, hypot(imgPointsF[i].x - imgPointsD[i].x, imgPointsF[i].y - imgPointsD[i].y));
+    }
+    CHECK(maxPixelDeviation <= MAX_PIXEL_DEVIATION, "projection deviates by " << maxPixelDeviation << " px");
+
+    vector<cv::Rect> rois{cv::Rect(500, 150, 240, 120), cv::Rect(300, 160, 180, 100), cv::Rect(700, 140, 200, 140)};
+    vector<int> boxIndicesF, boxIndicesD;
+    assignPointsToBoxes(imgPointsF, rois, (float)config.shrinkFactor, boxIndicesF);
+    assignPointsToBoxes(imgPointsD, rois, (double)config.shrinkFactor, boxIndicesD);
+    int nAssigned = 0, nMismatches = 0;
+    for (size_t i = 0; i < boxIndicesD.size(); ++i)
+    {
+        nAssigned += boxIndicesD[i] >= 0;
+        nMismatches += boxIndicesF[i] != boxIndicesD[i];
+    }
+    CHECK(nAssigned > 0, "no points inside the boxes");
+    CHECK(nMismatches <= MAX_BOX_MISMATCH_RATE * boxIndicesD.size(), nMismatches << " of " << boxIndicesD.size() << " points assigned to another box");
+
+    // Lidar TTC of the rear of a preceding vehicle
+    normal_distribution<float> noise(0.0f, 0.02f);
+    uniform_real_distribution<float> rear(-0.8f, 0.8f);
+    vector<LidarPointT<float>> prevF(400), currF(400);
+    for (size_t i = 0; i < prevF.size(); ++i)
+    {
+        prevF[i] = {8.0f + noise(rng), rear(rng), -1.0f + 0.1f * rear(rng), 0.5f};
+        currF[i] = {7.95f + noise(rng), rear(rng), -1.0f + 0.1f * rear(rng), 0.5f};
+    }
+    vector<LidarPointT<double>> prevD = convertPoints<double>(prevF), currD = convertPoints<double>(currF);
+    float ttcLidarF = computeTTCLidarT<float>(prevF, currF, (float)config.sensorFrameRate);
+    double ttcLidarD = computeTTCLidarT<double>(prevD, currD, config.sensorFrameRate);
+    CHECK(std::isfinite(ttcLidarD) && ttcLidarD > 0.0, "reference Lidar TTC is " << ttcLidarD);
+    CHECK(relativeDeviation(ttcLidarF, ttcLidarD) <= MAX_TTC_LIDAR_DEVIATION, "Lidar TTC " << ttcLidarF << " s in float, " << ttcLidarD << " s in double");
+
+    // camera TTC of a box whose keypoints move away from its center by 1 % per frame
+    uniform_real_distribution<float> u(500.0f, 740.0f), v(150.0f, 270.0f);
+    vector<cv::KeyPoint> kptsPrev, kptsCurr;
+    vector<cv::DMatch> kptMatches;
+    for (int i = 0; i < 300; ++i)
+    {
+        cv::Point2f prev(u(rng), v(rng));
+        cv::Point2f curr(620.0f + 1.01f * (prev.x - 620.0f) + noise(rng), 210.0f + 1.01f * (prev.y - 210.0f) + noise(rng));
+        kptsPrev.push_back(cv::KeyPoint(prev, 7.0f));
+        kptsCurr.push_back(cv::KeyPoint(curr, 7.0f));
+        kptMatches.push_back(cv::DMatch(i, i, 0.0f));
+    }
+    float ttcCameraF = computeTTCCameraT<float>(kptsPrev, kptsCurr, kptMatches, (float)config.sensorFrameRate);
+    double ttcCameraD = computeTTCCameraT<double>(kptsPrev, kptsCurr, kptMatches, config.sensorFrameRate);
+    CHECK(std::isfinite(ttcCameraD) && ttcCameraD > 0.0, "reference camera TTC is " << ttcCameraD);
+    CHECK(relativeDeviation(ttcCameraF, ttcCameraD) <= MAX_TTC_CAMERA_DEVIATION, "camera TTC " << ttcCameraF << " s in float, " << ttcCameraD << " s in double");
+
+    return testResult("fusion_kernels_test");
+}
@@ -0,0 +1,84 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "gemmMatcher.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static const double MAX_DIST_ERROR = 1e-3; // relative, the expanded |a|^2 + |b|^2 - 2 a.b loses digits to cancellation in float
+
+static cv::Mat randomDescriptors(mt19937 &rng, int rows, int cols)
+{
+    uniform_real_distribution<float> value(0.0f, 1.0f);
+    cv::Mat desc(rows, cols, CV_32F);
+    for (int i = 0; i < rows; ++i)
+    {
+        float *row = desc.ptr<float>(i);
+        for (int d = 0; d < cols; ++d)
+        {
+            row[d] = value(rng);
+        }
+    }
+    return desc;
+}
+
+static double exactDistance(const cv::Mat &descSource, int i, const cv::Mat &descRef, int j)
+{
+    double sum = 0.0;
+    for (int d = 0; d < descSource.cols; ++d)
+    {
+        double diff = (double)descSource.ptr<float>(i)[d] - descRef.ptr<float>(j)[d];
+        sum += diff * diff;
+    }
+    return sqrt(sum);
+}
+
+/* GEMM MATCHER TEST: top-2 neighbours of the blocked GEMM matcher against cv::BFMatcher with NORM_L2 */
+int main()
+{
+    // row counts which are not multiples of the source block or of the thread count, and fewer references than neighbours
+    struct MatchCase { int nSource, nRef, nThreads; };
+    vector<MatchCase> cases{{1, 1, 1}, {5, 3, 4}, {130, 2, 1}, {1000, 700, 3}, {1531, 1000, 7}, {2049, 517, 0}};
+    mt19937 rng(3);
+    cv::Ptr<cv::DescriptorMatcher> matcher = cv::BFMatcher::create(cv::NORM_L2, false);
+
+    for (auto &c : cases)
+    {
+        cv::Mat descSource = randomDescriptors(rng, c.nSource, 128), descRef = randomDescriptors(rng, c.nRef, 128);
+        vector<vector<cv::DMatch>> bfMatches, gemmMatches;
+        matcher->knnMatch(descSource, descRef, bfMatches, 2);
+        knnMatchGemm(descSource, descRef, gemmMatches, c.nThreads);
+
+        int nLayout = 0, nIndex = 0, nDistance = 0;
+        for (size_t i = 0; i < bfMatches.size() && bfMatches.size() == gemmMatches.size(); ++i)
+        {
+            if (bfMatches[i].size() != gemmMatches[i].size())
+            {
+                ++nLayout;
+                continue;
+            }
+            for (size_t k = 0; k < bfMatches[i].size(); ++k)
+            {
+                const cv::DMatch &bf = bfMatches[i][k], &gemm = gemmMatches[i][k];
+                double tolerance = MAX_DIST_ERROR * max(1.0, (double)bf.distance);
+                nLayout += gemm.queryIdx != bf.queryIdx;
+                // a different neighbour is only acceptable in a tie within the distance tolerance
+                nIndex += gemm.trainIdx != bf.trainIdx && fabs(exactDistance(descSource, i, descRef, gemm.trainIdx) - bf.distance) > tolerance;
+                nDistance += fabs(gemm.distance - bf.distance) > tolerance;
+            }
+        }
+        CHECK(bfMatches.size() == gemmMatches.size() && nLayout == 0,
+              c.nSource << " x " << c.nRef << " : " << gemmMatches.size() << " rows instead of " << bfMatches.size() << ", " << nLayout << " with other layouts");
+        CHECK(nIndex == 0 && nDistance == 0,
+              c.nSource << " x " << c.nRef << ", " << c.nThreads << " threads : " << nIndex << " other neighbours, " << nDistance << " other distances");
+    }
+
+    return testResult("gemm_matcher_test");
+}
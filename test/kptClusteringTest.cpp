@@ -0,0 +1,75 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "camFusion.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+/* KEYPOINT CLUSTERING TEST: the grid-based assignment of all boxes gives the same matches as the per-box loop */
+int main()
+{
+    // adjacent and overlapping boxes with edges on the 32 px grid cells, so points within half a pixel of a cell border
+    // round into the neighbouring cell
+    vector<BoundingBox> boxes(4);
+    boxes[0].roi = cv::Rect(0, 0, 64, 64);
+    boxes[1].roi = cv::Rect(64, 0, 64, 64);
+    boxes[2].roi = cv::Rect(32, 32, 96, 64);
+    boxes[3].roi = cv::Rect(200, 10, 50, 40);
+    for (size_t b = 0; b < boxes.size(); ++b)
+    {
+        boxes[b].boxID = b;
+    }
+
+    mt19937 rng(5);
+    uniform_real_distribution<float> x(-10.0f, 260.0f), y(-10.0f, 110.0f), offset(-0.5f, 0.5f), distance(10.0f, 100.0f);
+    vector<cv::KeyPoint> kptsCurr;
+    for (int i = 0; i < 2000; ++i)
+    {
+        kptsCurr.push_back(cv::KeyPoint(cv::Point2f(x(rng), y(rng)), 7.0f));
+    }
+    for (float border : {31.0f, 32.0f, 63.0f, 64.0f, 95.0f, 96.0f, 127.0f, 128.0f})
+    { // keypoints on both sides of cell and box borders
+        for (int i = 0; i < 50; ++i)
+        {
+            kptsCurr.push_back(cv::KeyPoint(cv::Point2f(border + offset(rng), y(rng)), 7.0f));
+            kptsCurr.push_back(cv::KeyPoint(cv::Point2f(x(rng), border + offset(rng)), 7.0f));
+        }
+    }
+    vector<cv::KeyPoint> kptsPrev = kptsCurr;
+    vector<cv::DMatch> kptMatches;
+    for (size_t i = 0; i < kptsCurr.size(); ++i)
+    {
+        kptMatches.push_back(cv::DMatch(i, i, distance(rng)));
+    }
+
+    KptMatchPartition partition;
+    clusterKptMatchesWithROIs(boxes, kptsCurr, kptMatches, partition);
+    CHECK(partition.offsets.size() == boxes.size() + 1, partition.offsets.size() << " partition offsets for " << boxes.size() << " boxes");
+
+    for (size_t b = 0; b < boxes.size() && partition.offsets.size() == boxes.size() + 1; ++b)
+    {
+        BoundingBox reference = boxes[b];
+        clusterKptMatchesWithROI(reference, kptsPrev, kptsCurr, kptMatches);
+        vector<int> expected, actual;
+        for (auto &match : reference.kptMatches)
+        {
+            expected.push_back(match.trainIdx);
+        }
+        for (size_t k = partition.offsets[b]; k < partition.offsets[b + 1]; ++k)
+        {
+            actual.push_back(partition.matches[k].trainIdx);
+        }
+        sort(expected.begin(), expected.end());
+        sort(actual.begin(), actual.end());
+        CHECK(actual == expected, "box " << b << " holds " << actual.size() << " matches instead of " << expected.size());
+    }
+
+    return testResult("kpt_clustering_test");
+}
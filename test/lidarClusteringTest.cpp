@@ -0,0 +1,69 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "camFusion.hpp"
+#include "pipeline.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static vector<BoundingBox> createBoxes()
+{
+    vector<BoundingBox> boxes(2);
+    boxes[0].boxID = 0;
+    boxes[0].roi = cv::Rect(450, 120, 330, 160); // preceding vehicle in the ego lane
+    boxes[1].boxID = 1;
+    boxes[1].roi = cv::Rect(100, 150, 200, 100);
+    return boxes;
+}
+
+/* LIDAR CLUSTERING TEST: the default configuration only fills the per-box summaries and never copies points */
+int main()
+{
+    PipelineConfig config = createDefaultConfig("");
+    CHECK(!config.bLidarICP, "ICP is enabled by default");
+    CHECK(!keepLidarPoints(config), "the default configuration copies Lidar points into their boxes");
+
+    // rear of a vehicle 8 m ahead, all inside the ego-lane crop
+    mt19937 rng(3);
+    uniform_real_distribution<float> y(-0.8f, 0.8f), z(-1.4f, -1.0f);
+    normal_distribution<float> x(8.0f, 0.02f);
+    vector<LidarPoint> lidarPoints(500);
+    for (auto &pt : lidarPoints)
+    {
+        pt = {x(rng), y(rng), z(rng), 0.5f};
+    }
+
+    vector<BoundingBox> summaryBoxes = createBoxes(), copyBoxes = createBoxes();
+    clusterLidarWithROI(summaryBoxes, lidarPoints, config.shrinkFactor, config.P_rect_00, config.R_rect_00, config.RT, keepLidarPoints(config));
+    clusterLidarWithROI(copyBoxes, lidarPoints, config.shrinkFactor, config.P_rect_00, config.R_rect_00, config.RT, true);
+
+    CHECK(summaryBoxes[0].lidarSummary.count > 0, "no Lidar points on the preceding vehicle");
+    for (size_t b = 0; b < summaryBoxes.size(); ++b)
+    {
+        const LidarBoxSummary &summary = summaryBoxes[b].lidarSummary;
+        CHECK(summaryBoxes[b].lidarPoints.empty(), "box " << b << " holds " << summaryBoxes[b].lidarPoints.size() << " copied points");
+        CHECK(summary.count == (int)copyBoxes[b].lidarPoints.size(), "box " << b << " summarizes " << summary.count << " of "
+              << copyBoxes[b].lidarPoints.size() << " points");
+        CHECK(summary.count == copyBoxes[b].lidarSummary.count, "summaries of box " << b << " differ with and without copies");
+    }
+
+    // median Lidar TTC from the summaries alone
+    vector<LidarPoint> closerPoints = lidarPoints;
+    for (auto &pt : closerPoints)
+    {
+        pt.x -= 0.05;
+    }
+    vector<BoundingBox> closerBoxes = createBoxes();
+    clusterLidarWithROI(closerBoxes, closerPoints, config.shrinkFactor, config.P_rect_00, config.R_rect_00, config.RT, keepLidarPoints(config));
+    double ttc;
+    computeTTCLidar(summaryBoxes[0].lidarSummary.xSketch, closerBoxes[0].lidarSummary.xSketch, config.sensorFrameRate, ttc);
+    CHECK(ttc > 15.0 && ttc < 17.0, "TTC from the summaries is " << ttc << " s instead of about 15.9 s");
+
+    return testResult("lidar_clustering_test");
+}
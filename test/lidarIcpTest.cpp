@@ -0,0 +1,79 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+#include "dataStructures.h"
+#include "camFusion.hpp"
+#include "lidarIcp.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static const double FRAME_RATE = 10.0;       // [Hz]
+static const double MAX_TTC_DEVIATION = 0.05; // relative TTC error of ICP against the true TTC
+
+// rear and left side of a vehicle whose rear is at the given distance and lateral offset, sampled anew for every scan
+static vector<LidarPoint> vehicleScan(mt19937 &rng, double distance, double offsetY)
+{
+    normal_distribution<double> noise(0.0, 0.01);
+    uniform_real_distribution<double> y(-0.8, 0.8), z(-1.4, -0.9), depth(0.0, 1.5);
+    vector<LidarPoint> points;
+    for (int i = 0; i < 300; ++i)
+    {
+        points.push_back({distance + noise(rng), offsetY + y(rng), z(rng), 0.5});
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        points.push_back({distance + depth(rng), offsetY + 0.8 + noise(rng), z(rng), 0.5});
+    }
+    return points;
+}
+
+/* LIDAR ICP TEST: ICP TTC against the true TTC and the median estimator, for closing speeds beyond the correspondence distance */
+int main()
+{
+    mt19937 rng(13);
+    KdTree tree;
+    double icpMs = 0.0, medianMs = 0.0;
+    int nRuns = 0;
+
+    cout << "  closing speed   lateral   TTC true   TTC ICP   TTC median" << endl;
+    for (double speed : {1.0, 5.0, 10.0, 20.0})
+    {
+        for (double lateral : {0.0, 0.3})
+        {
+            double distance = 12.0, step = speed / FRAME_RATE;
+            vector<LidarPoint> prev = vehicleScan(rng, distance, 0.0), curr = vehicleScan(rng, distance - step, lateral);
+            double ttcTrue = (distance - step) / speed;
+
+            double ttcIcp, closingVelocity, ttcMedian;
+            auto t0 = chrono::steady_clock::now();
+            computeTTCLidarICP(prev, curr, FRAME_RATE, ttcIcp, closingVelocity, tree);
+            auto t1 = chrono::steady_clock::now();
+            computeTTCLidar(prev, curr, FRAME_RATE, ttcMedian);
+            auto t2 = chrono::steady_clock::now();
+            icpMs += chrono::duration<double, milli>(t1 - t0).count();
+            medianMs += chrono::duration<double, milli>(t2 - t1).count();
+            ++nRuns;
+
+            cout << fixed << setprecision(2) << setw(10) << speed << " m/s" << setw(8) << lateral << " m" << setw(11) << ttcTrue
+                 << setw(10) << ttcIcp << setw(13) << ttcMedian << endl;
+            CHECK(std::isfinite(ttcIcp) && fabs(ttcIcp - ttcTrue) <= MAX_TTC_DEVIATION * ttcTrue,
+                  speed << " m/s, " << lateral << " m lateral : ICP TTC " << ttcIcp << " s instead of " << ttcTrue << " s");
+        }
+    }
+    cout << "  mean time per object : ICP " << setprecision(3) << icpMs / nRuns << " ms, median " << medianMs / nRuns << " ms" << endl;
+
+    // receding objects have no TTC
+    vector<LidarPoint> prev = vehicleScan(rng, 10.0, 0.0), curr = vehicleScan(rng, 10.5, 0.0);
+    double ttc, closingVelocity;
+    computeTTCLidarICP(prev, curr, FRAME_RATE, ttc, closingVelocity, tree);
+    CHECK(std::isnan(ttc), "receding object has TTC " << ttc << " s");
+
+    return testResult("lidar_icp_test");
+}
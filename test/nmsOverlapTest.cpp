@@ -0,0 +1,64 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <opencv2/core.hpp>
+
+#include "simdDispatch.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+// overlap as computed by cv::dnn::NMSBoxes for integer boxes
+static float openCvOverlap(const cv::Rect &a, const cv::Rect &b)
+{
+    return 1.0f - (float)cv::jaccardDistance(a, b);
+}
+
+/* NMS OVERLAP TEST: the IoU kernel of the non-maximum suppression gives exactly the overlaps of cv::dnn::NMSBoxes */
+int main()
+{
+    // small boxes hit ratios like 2/5 exactly, large boxes have areas beyond the float mantissa
+    mt19937 rng(7);
+    vector<cv::Rect> boxes;
+    for (int scale : {1, 37, 1500})
+    {
+        uniform_int_distribution<int> pos(0, 4 * scale), size(0, 5 * scale);
+        for (int i = 0; i < 150; ++i)
+        {
+            boxes.push_back(cv::Rect(pos(rng), pos(rng), size(rng), size(rng)));
+        }
+    }
+    vector<float> x1, y1, x2, y2;
+    for (auto &b : boxes)
+    {
+        x1.push_back(b.x);
+        y1.push_back(b.y);
+        x2.push_back(b.x + b.width);
+        y2.push_back(b.y + b.height);
+    }
+
+    for (int level = SIMD_BASELINE; level < SIMD_LEVELS; ++level)
+    {
+        if (!simdLevelAvailable((SimdLevel)level))
+        {
+            continue;
+        }
+        const SimdKernels &kernels = simdKernelsAt((SimdLevel)level);
+        int nDifferent = 0;
+        vector<float> iou(boxes.size());
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            const float box[4] = {x1[i], y1[i], x2[i], y2[i]};
+            kernels.iouRow(box, x1.data(), y1.data(), x2.data(), y2.data(), boxes.size(), iou.data());
+            for (size_t j = 0; j < boxes.size(); ++j)
+            {
+                nDifferent += iou[j] != openCvOverlap(boxes[i], boxes[j]);
+            }
+        }
+        CHECK(nDifferent == 0, simdLevelName((SimdLevel)level) << " : " << nDifferent << " overlaps differ from cv::dnn::NMSBoxes");
+    }
+
+    return testResult("nms_overlap_test");
+}
@@ -0,0 +1,94 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "dataStructures.h"
+#include "quantileSketch.hpp"
+#include "fusionKernels.hpp"
+#include "camFusion.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static const double MAX_EXACT_DEVIATION = sizeof(FusionScalar) == sizeof(double) ? 0.0 : 1e-4; // float builds average the middle values in float
+static const double MAX_RANK_ERROR = 3.0 / 1024;   // rank error of an approximate median, about twice the expected bound 1.7 / k
+static const double MAX_TTC_DEVIATION = 5e-3;      // relative TTC deviation of approximate sketches from the exact median
+
+// rear of a vehicle at the given distance with Lidar noise
+static vector<LidarPoint> vehiclePoints(mt19937 &rng, int n, double distance)
+{
+    normal_distribution<FusionScalar> x(distance, 0.02);
+    uniform_real_distribution<FusionScalar> y(-0.8, 0.8);
+    vector<LidarPoint> points(n);
+    for (auto &pt : points)
+    {
+        pt = {x(rng), y(rng), -1.0, 0.5};
+    }
+    return points;
+}
+
+static QuantileSketch sketchOf(const vector<LidarPoint> &points)
+{
+    QuantileSketch sketch;
+    for (auto &pt : points)
+    {
+        sketchInsert(sketch, pt.x);
+    }
+    finalizeSketch(sketch);
+    return sketch;
+}
+
+// TTC from the sketches against computeTTCLidar, which sorts all points
+static double ttcDeviation(vector<LidarPoint> prev, vector<LidarPoint> curr, double frameRate)
+{
+    double ttcSketch, ttcExact;
+    computeTTCLidar(sketchOf(prev), sketchOf(curr), frameRate, ttcSketch);
+    computeTTCLidar(prev, curr, frameRate, ttcExact);
+    return fabs(ttcSketch - ttcExact) / fabs(ttcExact);
+}
+
+/* QUANTILE SKETCH TEST: exact medians below k values, bounded rank and TTC error above */
+int main()
+{
+    mt19937 rng(11);
+    QuantileSketch defaults;
+
+    // typical vehicle clusters stay below k and give exactly the median of computeTTCLidar
+    for (int n : {1, 2, 301, 800, defaults.k - 1})
+    {
+        vector<LidarPoint> prev = vehiclePoints(rng, n, 8.0), curr = vehiclePoints(rng, n, 7.95);
+        double deviation = ttcDeviation(prev, curr, 10.0);
+        CHECK(deviation <= MAX_EXACT_DEVIATION, n << " points : TTC deviates by " << deviation);
+    }
+
+    // larger clusters: rank of the approximate median and its effect on the TTC
+    int n = 20 * defaults.k;
+    vector<LidarPoint> prev = vehiclePoints(rng, n, 8.0), curr = vehiclePoints(rng, n, 7.95);
+    QuantileSketch sketch = sketchOf(prev);
+    CHECK(sketchSize(sketch) < (size_t)(4 * defaults.k), sketchSize(sketch) << " items retained for " << n << " values");
+    double median = sketchQuantile(sketch, 0.5);
+    vector<double> sorted;
+    for (auto &pt : prev)
+    {
+        sorted.push_back(pt.x);
+    }
+    sort(sorted.begin(), sorted.end());
+    double rank = (double)(lower_bound(sorted.begin(), sorted.end(), median) - sorted.begin()) / n;
+    CHECK(fabs(rank - 0.5) <= MAX_RANK_ERROR, "approximate median has rank " << rank);
+    double deviation = ttcDeviation(prev, curr, 10.0);
+    CHECK(deviation <= MAX_TTC_DEVIATION, n << " points : TTC deviates by " << deviation);
+
+    // merged sketches of two halves have the same bound as the sketch of the whole set
+    QuantileSketch merged = sketchOf(vector<LidarPoint>(prev.begin(), prev.begin() + n / 2));
+    sketchMerge(merged, sketchOf(vector<LidarPoint>(prev.begin() + n / 2, prev.end())));
+    finalizeSketch(merged);
+    CHECK(merged.n == (uint64_t)n, "merged sketch counts " << merged.n << " values");
+    double mergedRank = (double)(lower_bound(sorted.begin(), sorted.end(), sketchQuantile(merged, 0.5)) - sorted.begin()) / n;
+    CHECK(fabs(mergedRank - 0.5) <= MAX_RANK_ERROR, "median of the merged sketch has rank " << mergedRank);
+
+    return testResult("quantile_sketch_test");
+}
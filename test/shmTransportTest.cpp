@@ -0,0 +1,130 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "shmTransport.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static const int N_FRAMES = 20;
+static const int N_SLOTS = 2;
+static const int HOLD_MS = 300;   // the reader holds the first two frames this long, so the ring is full
+static const int TIMEOUT_MS = 50; // timeout of the calls which are expected to fail
+
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// reader process: frames in order with the content written for them, then a timeout on the empty ring
+static void readFrames(const string &name)
+{
+    ShmRing ring;
+    CHECK(ring.open(name), "reader cannot open " << name);
+    ShmFrameView view;
+    for (int f = 0; f < N_FRAMES; ++f)
+    {
+        if (!ring.read(view, 5000))
+        {
+            CHECK(false, "frame " << f << " not received");
+            break;
+        }
+        bool bContent = view.img.rows == 8 && view.img.cols == 16 && view.img.at<uchar>(7, 15) == f && view.nLidarPoints == 3 &&
+                        view.lidarPoints[2].x == f && view.nBoxes == 1 && view.boxes[0].boxID == f;
+        CHECK(view.frameIndex == f && bContent, "frame " << view.frameIndex << " received instead of frame " << f << " or with other content");
+
+        // both slots stay in use until the writer has timed out once
+        if (f == N_SLOTS - 1)
+        {
+            this_thread::sleep_for(chrono::milliseconds(HOLD_MS));
+            for (int s = 0; s < N_SLOTS; ++s)
+            {
+                ring.release();
+            }
+        }
+        else if (f >= N_SLOTS)
+        {
+            ring.release();
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    CHECK(!ring.read(view, TIMEOUT_MS), "frame " << view.frameIndex << " read beyond the last frame");
+    CHECK(elapsedMs(start) >= 0.9 * TIMEOUT_MS, "read returned after " << elapsedMs(start) << " ms instead of the " << TIMEOUT_MS << " ms timeout");
+    ring.close();
+}
+
+/* SHM TRANSPORT TEST: frames pass from a writer to a reader process in order, slots are reused once released
+   and both sides time out instead of blocking */
+int main()
+{
+    string name = "/sfnd_shm_test_" + to_string(getpid());
+    ShmRing ring;
+    if (!ring.create(name, N_SLOTS, 1 << 20))
+    {
+        CHECK(false, "cannot create " << name);
+        return testResult("shm_transport_test");
+    }
+
+    pid_t reader = fork();
+    if (reader == 0)
+    {
+        readFrames(name);
+        _exit(testFailures);
+    }
+
+    vector<const uchar *> slotImages;
+    for (int f = 0; f < N_FRAMES; ++f)
+    {
+        // the reader holds both slots, so the ring is full until it releases them
+        if (f == N_SLOTS)
+        {
+            auto start = chrono::steady_clock::now();
+            CHECK(!ring.beginWrite(f, TIMEOUT_MS), "frame " << f << " written into a full ring");
+            CHECK(elapsedMs(start) >= 0.9 * TIMEOUT_MS, "beginWrite returned after " << elapsedMs(start) << " ms instead of the " << TIMEOUT_MS << " ms timeout");
+        }
+        if (!ring.beginWrite(f, 5000))
+        {
+            CHECK(false, "no free slot for frame " << f);
+            break;
+        }
+        cv::Mat img = ring.imageBuffer(8, 16, CV_8U);
+        img.setTo(cv::Scalar(f));
+        slotImages.push_back(img.data);
+        LidarPoint *points = ring.lidarBuffer(3);
+        for (int i = 0; i < 3; ++i)
+        {
+            points[i].x = f;
+            points[i].y = points[i].z = 0.0;
+            points[i].r = 1.0;
+        }
+        ShmBox *box = ring.boxBuffer(1);
+        box->boxID = f;
+        ring.commitWrite();
+    }
+
+    // released slots are reused in ring order
+    int nReused = 0;
+    for (size_t f = N_SLOTS; f < slotImages.size(); ++f)
+    {
+        nReused += slotImages[f] == slotImages[f % N_SLOTS];
+    }
+    CHECK((int)slotImages.size() == N_FRAMES && slotImages[0] != slotImages[1] && nReused == N_FRAMES - N_SLOTS,
+          nReused << " of " << N_FRAMES - N_SLOTS << " frames written into the slot of their ring position");
+
+    // the ring stays open until the reader has timed out on it
+    int status = 0;
+    waitpid(reader, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "reader process failed");
+    ring.close();
+    return testResult("shm_transport_test");
+}
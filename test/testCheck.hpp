@@ -0,0 +1,27 @@
+
+#ifndef testCheck_hpp
+#define testCheck_hpp
+
+#include <iostream>
+
+// Minimal assertions for the ctest executables: a failed check is reported with its location and
+// the test returns testResult() = 1 at the end, so all failures of one run are listed.
+static int testFailures = 0;
+
+#define CHECK(condition, message) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << " (" << message << ")" << std::endl; \
+            ++testFailures; \
+        } \
+    } while (0)
+
+static int testResult(const char *testName)
+{
+    std::cout << testName << (testFailures == 0 ? " passed" : " FAILED") << std::endl;
+    return testFailures == 0 ? 0 : 1;
+}
+
+#endif /* testCheck_hpp */
@@ -0,0 +1,198 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "trackMemory.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+static const int DESC_BYTES = 61; // AKAZE descriptor size
+static const int CAR = 2, TRUCK = 7;
+
+typedef vector<uchar> Descriptor;
+
+static Descriptor randomDescriptor(mt19937 &rng)
+{
+    uniform_int_distribution<int> byte(0, 255);
+    Descriptor desc(DESC_BYTES);
+    for (auto &b : desc)
+    {
+        b = byte(rng);
+    }
+    return desc;
+}
+
+// copy of a descriptor with the given no. of random bits flipped
+static Descriptor perturb(mt19937 &rng, const Descriptor &desc, int nBits)
+{
+    uniform_int_distribution<int> bit(0, 8 * DESC_BYTES - 1);
+    Descriptor result = desc;
+    for (int i = 0; i < nBits; ++i)
+    {
+        int b = bit(rng);
+        result[b / 8] ^= 1 << (b % 8);
+    }
+    return result;
+}
+
+static int hamming(const uchar *a, const uchar *b)
+{
+    int d = 0;
+    for (int i = 0; i < DESC_BYTES; ++i)
+    {
+        d += __builtin_popcount(a[i] ^ b[i]);
+    }
+    return d;
+}
+
+// frame with a single box whose keypoints carry the given appearance, each descriptor perturbed anew
+static DataFrame boxFrame(mt19937 &rng, const vector<Descriptor> &appearance, int trackID, int classID, int featureEngine)
+{
+    DataFrame frame;
+    frame.featureEngine = featureEngine;
+    frame.descriptors = cv::Mat(appearance.size(), DESC_BYTES, CV_8U);
+    for (size_t i = 0; i < appearance.size(); ++i)
+    {
+        cv::KeyPoint kpt(cv::Point2f(110.0f + (i % 16) * 10.0f, 110.0f + (i / 16) * 10.0f), 7.0f);
+        kpt.response = 1.0f + i;
+        frame.keypoints.push_back(kpt);
+        Descriptor desc = perturb(rng, appearance[i], 10);
+        memcpy(frame.descriptors.ptr(i), desc.data(), DESC_BYTES);
+    }
+    BoundingBox box;
+    box.boxID = 0;
+    box.trackID = trackID;
+    box.classID = classID;
+    box.roi = cv::Rect(100, 100, 200, 100);
+    frame.boundingBoxes.push_back(box);
+    return frame;
+}
+
+static vector<Descriptor> randomAppearance(mt19937 &rng)
+{
+    vector<Descriptor> appearance;
+    for (int i = 0; i < 32; ++i)
+    {
+        appearance.push_back(randomDescriptor(rng));
+    }
+    return appearance;
+}
+
+// box of a new track (trackID 100) with the given appearance and class, returns its trackID after re-identification
+static int reidentify(mt19937 &rng, const TrackMemoryPolicy &policy, TrackMemory memory, const vector<Descriptor> &appearance, int classID,
+                      int featureEngine, int frameIndex)
+{
+    DataFrame frame = boxFrame(rng, appearance, 100, classID, featureEngine);
+    reidentifyTracks(policy, memory, frame, 100, frameIndex);
+    return frame.boundingBoxes[0].trackID;
+}
+
+/* TRACK MEMORY TEST: HNSW search against brute force after insertions and removals, and re-identification within the
+   time and class gate and across feature engine switches */
+int main()
+{
+    mt19937 rng(11);
+    TrackMemoryPolicy policy;
+
+    // clustered descriptors, like the keypoints of an object over several frames
+    vector<Descriptor> centers;
+    for (int c = 0; c < 100; ++c)
+    {
+        centers.push_back(randomDescriptor(rng));
+    }
+    TrackIndex index;
+    resetTrackIndex(index, CV_8U, DESC_BYTES);
+    vector<int> slots;
+    for (int i = 0; i < 2000; ++i)
+    {
+        Descriptor desc = perturb(rng, centers[i % centers.size()], 30);
+        slots.push_back(insertDescriptor(policy, index, desc.data(), i % centers.size(), 0));
+    }
+
+    // remove a quarter of the descriptors, then refill part of the freed slots
+    shuffle(slots.begin(), slots.end(), rng);
+    for (int i = 0; i < 500; ++i)
+    {
+        removeDescriptor(policy, index, slots.back());
+        slots.pop_back();
+    }
+    for (int i = 0; i < 300; ++i)
+    {
+        Descriptor desc = perturb(rng, centers[i % centers.size()], 30);
+        slots.push_back(insertDescriptor(policy, index, desc.data(), i % centers.size(), 1));
+    }
+    CHECK(index.nodes.size() == 2000 && index.nodes.size() - index.freeSlots.size() == slots.size(),
+          index.nodes.size() << " slots, " << index.freeSlots.size() << " free, " << slots.size() << " stored");
+
+    // links only between stored nodes, in both directions
+    int nBadLinks = 0;
+    for (int slot : slots)
+    {
+        for (size_t l = 0; l < index.nodes[slot].links.size(); ++l)
+        {
+            for (int n : index.nodes[slot].links[l])
+            {
+                auto &back = index.nodes[n].links;
+                nBadLinks += index.nodes[n].trackID < 0 || l >= back.size() || find(back[l].begin(), back[l].end(), slot) == back[l].end();
+            }
+        }
+    }
+    CHECK(nBadLinks == 0, nBadLinks << " links to removed or unlinked nodes");
+
+    int nQueries = 200, nExact = 0, nRemovedFound = 0;
+    for (int q = 0; q < nQueries; ++q)
+    {
+        Descriptor query = perturb(rng, centers[q % centers.size()], 30);
+        int bruteForce = 8 * DESC_BYTES;
+        for (int slot : slots)
+        {
+            bruteForce = min(bruteForce, hamming(query.data(), &index.data[slot * index.rowBytes]));
+        }
+        vector<pair<float, int>> found = searchDescriptors(index, query.data(), policy.efSearch);
+        for (auto &n : found)
+        {
+            nRemovedFound += index.nodes[n.second].trackID < 0;
+        }
+        nExact += !found.empty() && found[0].first == bruteForce;
+    }
+    CHECK(nRemovedFound == 0, nRemovedFound << " removed descriptors returned by the search");
+    CHECK(nExact >= 0.95 * nQueries, "nearest descriptor found for " << nExact << " of " << nQueries << " queries");
+
+    // a car (track 0) seen in frames 0-2 next to a truck (track 1) which stays in view
+    vector<Descriptor> car = randomAppearance(rng), truck = randomAppearance(rng);
+    TrackMemory memory;
+    for (int f = 0; f <= 2; ++f)
+    {
+        rememberTracks(policy, memory, boxFrame(rng, car, 0, CAR, -1), f);
+        rememberTracks(policy, memory, boxFrame(rng, truck, 1, TRUCK, -1), f);
+    }
+    CHECK(reidentify(rng, policy, memory, car, CAR, -1, 10) == 0, "car not re-identified after 8 frames");
+    CHECK(reidentify(rng, policy, memory, car, TRUCK, -1, 10) == 100, "car appearance re-identified as a truck");
+    CHECK(reidentify(rng, policy, memory, randomAppearance(rng), CAR, -1, 10) == 100, "unknown car re-identified");
+
+    // the descriptors of another feature engine are kept apart and leave those of the first engine in place
+    TrackMemory switched = memory;
+    for (int f = 3; f <= 5; ++f)
+    {
+        rememberTracks(policy, switched, boxFrame(rng, truck, 1, TRUCK, 1), f);
+    }
+    CHECK(reidentify(rng, policy, switched, car, CAR, -1, 10) == 0, "car not re-identified after a feature engine switch");
+    CHECK(reidentify(rng, policy, switched, car, CAR, 1, 10) == 100, "car re-identified from descriptors of another feature engine");
+
+    // tracks lost for longer than maxAbsentFrames are forgotten
+    for (int f = 3; f <= 2 + policy.maxAbsentFrames + 1; ++f)
+    {
+        rememberTracks(policy, memory, boxFrame(rng, truck, 1, TRUCK, -1), f);
+    }
+    CHECK(memory.tracks.count(0) == 0, "car still remembered after " << policy.maxAbsentFrames + 1 << " absent frames");
+    CHECK(reidentify(rng, policy, memory, car, CAR, -1, policy.maxAbsentFrames + 4) == 100, "forgotten car re-identified");
+
+    return testResult("track_memory_test");
+}
@@ -0,0 +1,153 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+#include "yoloModel.hpp"
+#include "testCheck.hpp"
+
+using namespace std;
+
+// a 3x3 convolution with batch norm feeding a detection head of 2 anchors x (5 + 3 classes)
+static const char *MODEL_CFG =
+    "[net]\n"
+    "channels=3\n"
+    "\n"
+    "[convolutional]\n"
+    "batch_normalize=1\n"
+    "filters=4\n"
+    "size=3\n"
+    "activation=leaky\n"
+    "\n"
+    "[convolutional]\n"
+    "size=1\n"
+    "filters=16 # anchors x (5 + classes)\n"
+    "activation=linear\n"
+    "\n"
+    "[yolo]\n"
+    "mask=0,1\n"
+    "anchors=10,14, 23,27, 37,58\n"
+    "classes=3\n"
+    "num=3\n";
+
+// the value of every weight encodes its layer, array and position, so misplaced rows cannot compare equal
+static vector<float> weightArray(int layer, int array, size_t n)
+{
+    vector<float> values(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        values[i] = layer * 100000.0f + array * 1000.0f + i;
+    }
+    return values;
+}
+
+template <typename T>
+static void append(string &bytes, const vector<T> &values)
+{
+    bytes.append((const char *)values.data(), values.size() * sizeof(T));
+}
+
+static vector<float> rows(const vector<float> &values, const vector<int> &kept, size_t rowSize)
+{
+    vector<float> selected;
+    for (int r : kept)
+    {
+        selected.insert(selected.end(), values.begin() + r * rowSize, values.begin() + (r + 1) * rowSize);
+    }
+    return selected;
+}
+
+static void writeFile(const string &file, const string &content)
+{
+    ofstream ofs(file, ios::binary);
+    ofs << content;
+}
+
+static string readFile(const string &file)
+{
+    ifstream ifs(file, ios::binary);
+    return string(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+}
+
+/* YOLO PRUNE TEST: class pruning of a tiny model with known weights keeps exactly the rows of the kept channels */
+int main()
+{
+    char dirTemplate[] = "/tmp/yolo_prune_testXXXXXX";
+    string dir = mkdtemp(dirTemplate);
+    string cfgFile = dir + "/tiny.cfg", weightsFile = dir + "/tiny.weights", namesFile = dir + "/tiny.names", prunedFile = dir + "/pruned.weights";
+
+    // weights version 0.2.0 with a 64 bit counter of seen images, then biases, [scales, means, variances,] filter weights per convolution
+    vector<int32_t> version{0, 2, 0};
+    vector<int64_t> seen{123456};
+    vector<vector<float>> conv1{weightArray(1, 0, 4), weightArray(1, 1, 4), weightArray(1, 2, 4), weightArray(1, 3, 4), weightArray(1, 4, 4 * 3 * 3 * 3)};
+    vector<vector<float>> head{weightArray(2, 0, 16), weightArray(2, 1, 16 * 4)};
+    string weights;
+    append(weights, version);
+    append(weights, seen);
+    for (auto &values : conv1)
+    {
+        append(weights, values);
+    }
+    for (auto &values : head)
+    {
+        append(weights, values);
+    }
+    writeFile(cfgFile, MODEL_CFG);
+    writeFile(weightsFile, weights);
+    writeFile(namesFile, "car\ntruck\nperson\n\n\n");
+
+    // trailing blank lines of the names file are not classes
+    vector<string> classes;
+    CHECK(readClassNames(namesFile, classes) && classes.size() == 3, classes.size() << " classes read instead of 3");
+
+    vector<CfgSection> sections;
+    CHECK(readCfg(cfgFile, sections) && sections.size() == 4, "model description read as " << sections.size() << " sections");
+    vector<CfgSection> layers(sections.begin() + 1, sections.end());
+    vector<LayerShape> shapes;
+    CHECK(inferShapes(layers, stoi(cfgValue(sections[0], "channels", "3")), shapes), "shapes not inferred");
+    CHECK(shapes.size() == 3 && shapes[0].inChannels == 3 && shapes[0].outChannels == 4 && shapes[1].inChannels == 4 &&
+          shapes[1].outChannels == 16 && shapes[2].outChannels == 16, "unexpected layer shapes");
+
+    // keep car and person: box and objectness plus class channels 0 and 2 of each anchor
+    vector<int> keptClasses{0, 2}, keptChannels{0, 1, 2, 3, 4, 5, 7, 8, 9, 10, 11, 12, 13, 15};
+    map<int, vector<int>> prunedChannels;
+    CHECK(pruneDetectionHeads(layers, shapes, classes.size(), keptClasses, prunedChannels), "detection heads not pruned");
+    CHECK(prunedChannels.size() == 1 && prunedChannels[1] == keptChannels, "unexpected channels kept in the detection head");
+    CHECK(cfgValue(layers[1], "filters", "") == "14" && cfgValue(layers[2], "classes", "") == "2",
+          "head has filters=" << cfgValue(layers[1], "filters", "") << ", classes=" << cfgValue(layers[2], "classes", ""));
+
+    // header and first convolution unchanged, rows of the kept channels of the head
+    CHECK(pruneWeights(weightsFile, prunedFile, layers, shapes, prunedChannels), "weights not pruned");
+    string expected;
+    append(expected, version);
+    append(expected, seen);
+    for (auto &values : conv1)
+    {
+        append(expected, values);
+    }
+    append(expected, rows(head[0], keptChannels, 1));
+    append(expected, rows(head[1], keptChannels, 4));
+    string pruned = readFile(prunedFile);
+    CHECK(pruned == expected, "pruned weights differ (" << pruned.size() << " bytes instead of " << expected.size() << ")");
+
+    // a head which also feeds a route cannot be pruned
+    CfgSection route{"route", {"[route]", "layers=-2"}};
+    layers = vector<CfgSection>(sections.begin() + 1, sections.end());
+    layers.push_back(route);
+    CHECK(inferShapes(layers, 3, shapes) && !pruneDetectionHeads(layers, shapes, classes.size(), keptClasses, prunedChannels),
+          "detection head read by a route layer pruned");
+
+    for (auto &file : {cfgFile, weightsFile, namesFile, prunedFile})
+    {
+        remove(file.c_str());
+    }
+    rmdir(dir.c_str());
+    return testResult("yolo_prune_test");
+}